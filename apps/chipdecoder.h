@@ -0,0 +1,154 @@
+#ifndef APPS_CHIPDECODER_H_
+#define APPS_CHIPDECODER_H_
+
+// Oregon V2 frames out of the SX1231 FIFO, for receiving in packet mode
+//
+// In continuous mode the radio only slices the carrier and every edge on DIO2 is an interrupt and a
+// pulse width for the decoder to classify. In packet mode the radio's bit synchroniser does that:
+// with the bit rate at OREGON_CHIPRATE each Manchester chip is one bit, it looks for the sync word
+// in them, and then clocks a fixed number of bytes into the FIFO and raises PayloadReady. So the
+// Pico gets one interrupt per transmission and a block of chips that are already in step.
+//
+// The sync word is the end of the preamble and the sync nibble, as chips:
+//   ...10 01 10 01 10 01 10 01 | 01 10 10 01 01 10 10 01
+//      preamble (1 bits, sent as 1 0)   sync 0xA (0 1 0 1, each followed by its complement)
+// 32 chips, 0x99996969, ending on a chip pair boundary, so the block starts at the first data bit.
+// A chip pair 10 is a 1 and 01 a 0, and V2 sends each bit twice, the second time inverted; the first
+// is kept, like OregonDecoderV2 does. Where the first pair is not Manchester (00 or 11, a chip the
+// slicer got wrong) the bit is taken from the second instead. Where neither is, the frame has ended.
+//
+// The bytes come out the way OregonDecoderV2 has them, with the sync nibble in the low nibble of data[0],
+// so oregon.h works on them unchanged. The block is sized for the longest frame's checksum,
+// THGR122N at 9 bytes: 72 bits less the sync nibble, at 4 chips a bit, is 34 bytes.
+//
+// OregonChipStream is the same thing in software, for continuous mode with the bit synchroniser on
+// (apps/oregon-dclk): the radio only recovers the chip clock, PIO samples DIO2 on it into 32 bit words,
+// and the sync word is looked for in those at every chip offset, then a block is collected and decoded.
+// No SDK dependency, host/yield-bench runs the same code.
+
+#include <stdint.h>
+#include <string.h>
+
+#define OREGON_SYNC_BYTES 4
+#define OREGON_BLOCK_BYTES 34
+#define CHIP_DECODER_MAX_BYTES 12
+
+// First chip in the top bit, as the SX1231 sends and receives them
+static const uint8_t OREGON_SYNC_CHIPS[OREGON_SYNC_BYTES] = { 0x99, 0x99, 0x69, 0x69 };
+static const uint32_t OREGON_SYNC_WORD = 0x99996969;
+
+class OregonChipDecoder {
+public:
+    struct Stats {
+        uint32_t blocks;
+        uint32_t repaired;      // bits taken from the second, inverted, copy
+        uint32_t mismatched;    // both copies Manchester but not complements, the first was kept
+        uint32_t shortFrames;   // ran into non Manchester chips before there was a whole byte after the sync
+    };
+
+private:
+    uint8_t data[CHIP_DECODER_MAX_BYTES];
+    Stats st = {};
+
+public:
+    const Stats& stats() const { return st; }
+
+    // A block as it came out of the FIFO; returns the bytes, len is how many whole ones there are
+    const uint8_t* decode(const uint8_t* block, int bytes, uint8_t& len) {
+        st.blocks++;
+        memset(data, 0, sizeof data);
+        // The sync word had the sync nibble
+        data[0] = 0x0a;
+        int n = 4;
+        // Each bit is one byte's nibble: two chip pairs
+        for (int i = 0; i < bytes * 2 && n < CHIP_DECODER_MAX_BYTES * 8; i++) {
+            uint8_t q = (i & 1) ? block[i >> 1] & 0x0f : block[i >> 1] >> 4;
+            uint8_t first = q >> 2;
+            uint8_t second = q & 3;
+            bool firstOk = first == 1 || first == 2;
+            bool secondOk = second == 1 || second == 2;
+            int bit;
+            if (firstOk) {
+                bit = first == 2;
+                if (secondOk && second == first) st.mismatched++;
+            } else if (secondOk) {
+                bit = second == 1;
+                st.repaired++;
+            } else {
+                break;
+            }
+            if (bit) data[n >> 3] |= uint8_t(1 << (n & 7));
+            n++;
+        }
+        len = uint8_t(n / 8);
+        if (len < 2) st.shortFrames++;
+        return data;
+    }
+};
+
+// Chips 32 at a time, first chip in the top bit, as the PIO in oregon-dclk shifts them in
+class OregonChipStream {
+public:
+    struct Stats {
+        uint32_t words;
+        uint32_t syncs;
+    };
+
+private:
+    OregonChipDecoder decoder;
+    Stats st = {};
+    int tolerance;
+    uint32_t prev = 0;      // so a sync word can straddle two words
+    bool inBlock = false;
+    int nchips = 0;
+    uint8_t block[OREGON_BLOCK_BYTES];
+
+    // Chips from bit 'from' (0 is the top) to the end of the word into the block; true when it is full
+    bool collect(uint32_t w, int from) {
+        for (int i = from; i < 32; i++) {
+            if (w & (0x80000000u >> i)) block[nchips >> 3] |= uint8_t(0x80 >> (nchips & 7));
+            if (++nchips == OREGON_BLOCK_BYTES * 8) return true;
+        }
+        return false;
+    }
+
+public:
+    // tolerance is chips of the sync word allowed to be wrong, as RegSyncConfig's SyncTol
+    explicit OregonChipStream(int tolerance) : tolerance(tolerance) {}
+
+    const Stats& stats() const { return st; }
+    const OregonChipDecoder::Stats& decoderStats() const { return decoder.stats(); }
+    // Between a sync and the end of its block, i.e. a transmission is on the air
+    bool collecting() const { return inBlock; }
+
+    // One word; returns the frame's bytes when a block has just been completed, otherwise nullptr.
+    // The rest of a word that finished a block is not searched; the next transmission is 10ms away at least
+    const uint8_t* word(uint32_t w, uint8_t& len) {
+        st.words++;
+        uint64_t window = uint64_t(prev) << 32 | w;
+        prev = w;
+        if (inBlock) {
+            if (!collect(w, 0)) return nullptr;
+            inBlock = false;
+            return decoder.decode(block, OREGON_BLOCK_BYTES, len);
+        }
+        // Most words are the quiet between transmissions, all one level, and can't hold the sync
+        if ((w == 0 || w == ~0u) && uint32_t(window >> 32) == w) return nullptr;
+        // k chips of this word in the 32 compared, so a match leaves the block starting at bit k
+        for (int k = 1; k <= 32; k++) {
+            if (__builtin_popcount(uint32_t(window >> (32 - k)) ^ OREGON_SYNC_WORD) > tolerance) continue;
+            st.syncs++;
+            inBlock = true;
+            nchips = 0;
+            memset(block, 0, sizeof block);
+            if (k < 32 && collect(w, k)) {
+                inBlock = false;
+                return decoder.decode(block, OREGON_BLOCK_BYTES, len);
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+};
+
+#endif
@@ -0,0 +1,579 @@
+#ifndef APPS_COLLISION_H_
+#define APPS_COLLISION_H_
+
+// Getting readings out of overlapping Oregon transmissions
+//
+// With a couple of dozen sensors on ~39s cycles some transmissions overlap, and since sensors on
+// the same channel have almost the same period, the same two keep overlapping for several cycles
+// in a row. The decoder sees one carrier cutting into the other and loses both. What the
+// SX1231 actually does with two carriers is let the stronger one through (the OOK peak
+// threshold sits just under it) and lose the weaker one under it, plus a few ms after it ends
+// while the threshold comes back down.
+//
+// So, for the bursts of DIO2 activity the normal decoder got nothing from, or which look like
+// more than one transmission:
+//   - detect: widths that are neither one nor two chips, an RSSI step inside the burst, or
+//     a burst longer than one frame
+//   - the stronger frame: decode the burst again with glitches (slivers of the other carrier)
+//     merged into their neighbours, using OregonDecoderPLL, which also finds a preamble that
+//     starts part way through a burst, and taking the frame as soon as its checksum byte is in,
+//     since one that runs straight into the other carrier never gets the gap that ends it
+//   - the weaker frame: turn the burst into chips, and find where the bits of a sensor we have
+//     seen before line up, by its known header (type, channel, rolling code) or by where the
+//     burst ends. Each bit is sent as four chips (b, !b, !b, b), so a bit is either clearly there
+//     or unknown. The bits from both transmissions of a pair are merged, the header filled in
+//     from what we know of the sensor, and at most two missing nibbles solved for from the
+//     checksum, taking the candidate nearest that sensor's last reading
+// Which sensors to try comes from each sensor's cadence: when it was last heard and its period.
+// Everything recovered has passed the checksum. That is only an 8 bit sum, so anything put together
+// from pieces also has to be within a degree and 3% of the sensor's last reading, and the ones with
+// nibbles solved for are reported as such.
+//
+// Fixed size, no allocation. No SDK dependency, host/collision-sim runs the same code.
+// Needs DecodeOOK.h (and Arduino.h, or host/arduinohost.h, before it), for OregonDecoderPLL.
+
+#include <stdint.h>
+#include <string.h>
+#include "oregon.h"
+#include "oregonpll.h"
+
+#define COLLISION_CHIP_US 488
+// Widths between gaps this long are one burst; the decoder ends a frame on 2500us as well
+#define BURST_GAP_US 2500
+// A frame is about 220 widths, so this is room for three overlapping
+#define BURST_MAX_WIDTHS 768
+// Anything shorter is not worth looking at (a frame is > 200)
+#define BURST_MIN_WIDTHS 48
+// One frame, preamble included, is about 190ms
+#define BURST_ONE_FRAME_US 200000
+// RSSI step inside a burst that says a second transmitter came or went, in RSSI register units (0.5dB)
+#define COLLISION_RSSI_STEP 12
+// More than this many percent of the widths not one or two chips says collision
+#define COLLISION_BAD_WIDTH_PERCENT 5
+// Slivers of the other carrier, merged into their neighbours before decoding again
+#define COLLISION_GLITCH_US 170
+// How far from a whole number of chips a width may be, after the asymmetry is taken out
+#define COLLISION_CHIP_TOLERANCE_US 150
+#define COLLISION_FRAME_BYTES 12
+#define COLLISION_MAX_CHIPS 2048
+#define COLLISION_TRACKS 24
+#define COLLISION_RECENT 6
+// The other transmission of a pair is 10ms plus a frame away
+#define COLLISION_PAIR_WINDOW_MS 1500
+// How close to its expected time a sensor has to be to be tried
+#define COLLISION_CADENCE_WINDOW_MS 3000
+#define COLLISION_MAX_CANDIDATES 6
+// Rebuilt readings have to be this close to the sensor's last one (tenths of a degree, %)
+#define COLLISION_MAX_TEMP_STEP 10
+#define COLLISION_MAX_HUM_STEP 3
+
+struct Burst {
+    uint16_t widths[BURST_MAX_WIDTHS];
+    uint16_t count;
+    bool truncated;
+    uint32_t start_ms;
+    uint32_t duration_us;
+    // RSSI register values, -2 x dBm, so the smallest is the strongest
+    uint8_t rssiStrongest;
+    uint8_t rssiWeakest;
+    uint8_t rssiStep;
+    uint8_t rssiSamples;
+    // Frames the normal decoder got out of it
+    uint8_t decoded;
+};
+
+// Collects the widths of each burst, alongside the normal decoder
+class BurstRecorder {
+    Burst b;
+    bool active = false;
+    uint8_t lastRssi = 0;
+
+public:
+    // Every width, in the order the decoder gets them, after the decoder has seen it (so frameDecoded()
+    // for the gap that ends a frame lands in that burst). True when this width ended a burst worth looking at.
+    bool width(uint32_t width_us, uint32_t now_ms) {
+        if (width_us >= BURST_GAP_US) {
+            bool ended = active;
+            active = false;
+            return ended && b.count >= BURST_MIN_WIDTHS;
+        }
+        if (!active) {
+            active = true;
+            b.count = 0;
+            b.truncated = false;
+            b.start_ms = now_ms;
+            b.duration_us = 0;
+            b.rssiStrongest = 0xff;
+            b.rssiWeakest = 0;
+            b.rssiStep = 0;
+            b.rssiSamples = 0;
+            b.decoded = 0;
+        }
+        if (b.count < BURST_MAX_WIDTHS) {
+            b.widths[b.count++] = uint16_t(width_us);
+        } else {
+            b.truncated = true;
+        }
+        b.duration_us += width_us;
+        return false;
+    }
+
+    // RSSI samples taken while a burst is going (from DIO0 or the RSSI register)
+    void rssi(uint8_t value) {
+        if (!active) return;
+        if (b.rssiSamples) {
+            uint8_t step = value > lastRssi ? value - lastRssi : lastRssi - value;
+            if (step > b.rssiStep) b.rssiStep = step;
+        }
+        if (value < b.rssiStrongest) b.rssiStrongest = value;
+        if (value > b.rssiWeakest) b.rssiWeakest = value;
+        lastRssi = value;
+        if (b.rssiSamples < 0xff) b.rssiSamples++;
+    }
+
+    void frameDecoded() {
+        if (active) b.decoded++;
+    }
+
+    bool inBurst() const { return active; }
+    const Burst& burst() const { return b; }
+};
+
+enum RecoveryMethod : uint8_t {
+    RECOVERED_REDECODE = 1,     // the stronger frame, decoded again without the glitches
+    RECOVERED_REBUILT,          // every nibble came off the air, from one or both of the pair
+    RECOVERED_FILLED,           // one or two nibbles solved for from the checksum
+};
+
+struct RecoveredFrame {
+    uint8_t data[COLLISION_FRAME_BYTES];
+    uint8_t len;
+    RecoveryMethod how;
+};
+
+inline const char* recoveryName(RecoveryMethod how) {
+    switch (how) {
+        case RECOVERED_REDECODE: return "redecoded";
+        case RECOVERED_REBUILT: return "rebuilt";
+        case RECOVERED_FILLED: return "filled";
+    }
+    return "?";
+}
+
+class CollisionResolver {
+public:
+    struct Stats {
+        uint32_t bursts;
+        uint32_t collisions;
+        uint32_t redecoded;
+        uint32_t rebuilt;
+        uint32_t filled;
+        uint32_t unresolved;
+    };
+
+    // Every frame that was decoded, normally or recovered: keeps the cadence and the last reading
+    void decoded(const uint8_t* data, uint8_t len, uint32_t now_ms) {
+        int n = checkedLength(data, len);
+        if (!n || !readingOk(data, len)) return;
+        int t = findTrack(data);
+        if (t < 0) t = newTrack();
+        Track& tr = tracks[t];
+        if (tr.used) {
+            uint32_t since = now_ms - tr.lastSeen_ms;
+            // The other transmission of the pair says nothing about the period
+            if (since > COLLISION_PAIR_WINDOW_MS) {
+                if (!tr.period_ms) {
+                    if (since < 60000) tr.period_ms = since;
+                } else {
+                    uint32_t k = (since + tr.period_ms / 2) / tr.period_ms;
+                    if (k >= 1) {
+                        int32_t err = int32_t(since / k) - int32_t(tr.period_ms);
+                        if (err > -2000 && err < 2000) tr.period_ms += err / 4;
+                    }
+                }
+            }
+        }
+        tr.used = true;
+        memcpy(tr.data, data, n);
+        tr.len = uint8_t(n);
+        tr.lastSeen_ms = now_ms;
+    }
+
+    // Look at a finished burst; up to maxOut frames go in out (and are passed to decoded() already)
+    int resolve(const Burst& b, uint32_t now_ms, RecoveredFrame* out, int maxOut) {
+        stats_.bursts++;
+        bool collision = analyse(b);
+        if (collision) stats_.collisions++;
+        if (b.decoded && !collision) return 0;
+
+        int found = redecode(b, out, maxOut);
+        stats_.redecoded += found;
+        // So rebuild() doesn't go looking for these again
+        for (int i = 0; i < found; i++) decoded(out[i].data, out[i].len, now_ms);
+        int rebuilt = rebuild(b, now_ms, out + found, maxOut - found);
+        for (int i = found; i < found + rebuilt; i++) decoded(out[i].data, out[i].len, now_ms);
+        found += rebuilt;
+        if (!found && !b.decoded) stats_.unresolved++;
+        return found;
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Track {
+        uint8_t data[COLLISION_FRAME_BYTES];
+        uint8_t len;
+        bool used;
+        uint32_t lastSeen_ms;
+        uint32_t period_ms;
+    };
+
+    // Bits of one transmission, each either known or not
+    struct SoftFrame {
+        uint8_t value[COLLISION_FRAME_BYTES];
+        uint8_t known[COLLISION_FRAME_BYTES];
+        int8_t track;
+        bool used;
+        uint32_t at_ms;
+    };
+
+    Track tracks[COLLISION_TRACKS] = {};
+    SoftFrame recent[COLLISION_RECENT] = {};
+    uint8_t chipLevel[COLLISION_MAX_CHIPS / 8];
+    uint8_t chipKnown[COLLISION_MAX_CHIPS / 8];
+    int nchips = 0;
+    int32_t asym_us = 0;
+    uint16_t badWidths = 0;
+    OregonDecoderPLL redecoder;
+    Stats stats_ = {};
+
+    static bool getBit(const uint8_t* bits, int i) { return (bits[i >> 3] >> (i & 7)) & 1; }
+    static void setBit(uint8_t* bits, int i, bool v) {
+        if (v) bits[i >> 3] |= uint8_t(1 << (i & 7));
+        else bits[i >> 3] &= uint8_t(~(1 << (i & 7)));
+    }
+
+    // As the sensors send them: the bytes covered by the checksum, plus one that isn't
+    static int frameBits(const uint8_t* data) {
+        int n = checkedLength(data, COLLISION_FRAME_BYTES);
+        return n ? (n + 1) * 8 : 0;
+    }
+
+    int findTrack(const uint8_t* data) const {
+        for (int i = 0; i < COLLISION_TRACKS; i++) {
+            if (tracks[i].used && !memcmp(tracks[i].data, data, 4)) return i;
+        }
+        return -1;
+    }
+
+    int newTrack() {
+        int oldest = 0;
+        for (int i = 0; i < COLLISION_TRACKS; i++) {
+            if (!tracks[i].used) return i;
+            if (int32_t(tracks[i].lastSeen_ms - tracks[oldest].lastSeen_ms) < 0) oldest = i;
+        }
+        tracks[oldest].used = false;
+        tracks[oldest].period_ms = 0;
+        return oldest;
+    }
+
+    // Chips from the widths (the first is high), with the asymmetry taken out; and the collision checks
+    bool analyse(const Burst& b) {
+        // Highs and lows are off a whole number of chips by opposite amounts
+        int32_t sum[2] = { 0, 0 };
+        int32_t count[2] = { 0, 0 };
+        for (int i = 0; i < b.count; i++) {
+            int32_t w = b.widths[i];
+            int32_t n = (w + COLLISION_CHIP_US / 2) / COLLISION_CHIP_US;
+            if (n < 1 || n > 2) continue;
+            int32_t r = w - n * COLLISION_CHIP_US;
+            if (r > 2 * COLLISION_CHIP_TOLERANCE_US || r < -2 * COLLISION_CHIP_TOLERANCE_US) continue;
+            sum[i & 1] += r;
+            count[i & 1]++;
+        }
+        asym_us = count[0] && count[1] ? (sum[0] / count[0] - sum[1] / count[1]) / 2 : 0;
+
+        memset(chipKnown, 0, sizeof chipKnown);
+        nchips = 0;
+        badWidths = 0;
+        for (int i = 0; i < b.count && nchips < COLLISION_MAX_CHIPS; i++) {
+            bool high = (i & 1) == 0;
+            int32_t w = int32_t(b.widths[i]) + (high ? -asym_us : asym_us);
+            int32_t n = (w + COLLISION_CHIP_US / 2) / COLLISION_CHIP_US;
+            int32_t r = w - n * COLLISION_CHIP_US;
+            bool good = n >= 1 && n <= 2 && r <= COLLISION_CHIP_TOLERANCE_US && r >= -COLLISION_CHIP_TOLERANCE_US;
+            if (!good) {
+                badWidths++;
+                if (n < 1) n = 1;
+                if (n > 8) n = 8;
+            }
+            for (int k = 0; k < n && nchips < COLLISION_MAX_CHIPS; k++, nchips++) {
+                setBit(chipLevel, nchips, high);
+                setBit(chipKnown, nchips, good);
+            }
+        }
+        return badWidths * 100 > COLLISION_BAD_WIDTH_PERCENT * b.count || b.rssiStep >= COLLISION_RSSI_STEP ||
+               b.duration_us > BURST_ONE_FRAME_US || b.truncated;
+    }
+
+    // The stronger frame: the same burst through OregonDecoderPLL, glitches merged into the pulse around them
+    int redecode(const Burst& b, RecoveredFrame* out, int maxOut) {
+        int found = 0;
+        redecoder.resetDecoder();
+        uint32_t pending = 0;
+        uint8_t lastLen = 0;
+        for (int i = 0; i <= b.count && found < maxOut; i++) {
+            uint32_t w = i < b.count ? b.widths[i] : BURST_GAP_US * 2;
+            if (i + 1 < b.count && b.widths[i + 1] < COLLISION_GLITCH_US) {
+                // This, the glitch and the one after are really one pulse
+                pending += w + b.widths[i + 1];
+                i++;
+                continue;
+            }
+            w += pending;
+            pending = 0;
+            bool ended = redecoder.nextPulse(w > 0xffff ? 0xffff : word(w));
+            uint8_t len;
+            const uint8_t* data = redecoder.getData(len);
+            // A frame that runs straight into the other carrier never sees its gap, so take it as soon
+            // as the checksum byte is in; the decoder would throw it away at the first bad pulse
+            if (!ended && (len == lastLen || !checkedLength(data, len) || checkedLength(data, len) != len)) {
+                lastLen = len;
+                continue;
+            }
+            int n = checkedLength(data, len);
+            if (n && readingOk(data, len) && !alreadyHave(data, n, b)) {
+                memcpy(out[found].data, data, n);
+                out[found].len = uint8_t(n);
+                out[found].how = RECOVERED_REDECODE;
+                found++;
+                redecoder.resetDecoder();
+            } else if (ended) {
+                redecoder.resetDecoder();
+            }
+            lastLen = 0;
+        }
+        return found;
+    }
+
+    // The normal decoder already reported it from this burst
+    bool alreadyHave(const uint8_t* data, int n, const Burst& b) const {
+        int t = findTrack(data);
+        return t >= 0 && int32_t(tracks[t].lastSeen_ms - b.start_ms) >= 0 && !memcmp(tracks[t].data, data, n);
+    }
+
+    // One bit, sent as four chips b, !b, !b, b starting at chip c: 0 or 1, or -1 if it isn't clearly there
+    int softBit(int c) const {
+        if (c < 0 || c + 4 > nchips) return -1;
+        for (int k = 0; k < 4; k++) {
+            if (!getBit(chipKnown, c + k)) return -1;
+        }
+        bool b = getBit(chipLevel, c);
+        if (getBit(chipLevel, c + 1) == b || getBit(chipLevel, c + 2) == b || getBit(chipLevel, c + 3) != b) return -1;
+        return b;
+    }
+
+    // Where the first bit of this sensor's frame starts, found by its header; INT32_MIN if nowhere
+    int32_t findHeader(const Track& t) const {
+        int32_t best = INT32_MIN;
+        int bestScore = 0;
+        for (int32_t c0 = -4 * 31; c0 < nchips - 4; c0++) {
+            int match = 0, miss = 0;
+            for (int i = 0; i < 32 && miss <= 2; i++) {
+                int v = softBit(c0 + 4 * i);
+                if (v < 0) continue;
+                if (v == getBit(t.data, i)) match++;
+                else miss++;
+            }
+            int score = match - 4 * miss;
+            if (match >= 12 && miss <= 2 && score > bestScore) {
+                bestScore = score;
+                best = c0;
+            }
+        }
+        return best;
+    }
+
+    // The bits of a frame starting at chip c0; false if the visible part of the header disagrees with the track
+    bool extract(int32_t c0, const Track& t, int track, uint32_t now_ms, SoftFrame& s) const {
+        int nbits = frameBits(t.data);
+        memset(&s, 0, sizeof s);
+        int miss = 0, got = 0;
+        for (int i = 0; i < nbits; i++) {
+            int v = softBit(c0 + 4 * i);
+            if (v < 0) continue;
+            setBit(s.value, i, v);
+            setBit(s.known, i, true);
+            got++;
+            if (i < 32 && v != getBit(t.data, i)) miss++;
+        }
+        s.track = int8_t(track);
+        s.used = true;
+        s.at_ms = now_ms;
+        return miss <= 2 && got >= 16;
+    }
+
+    // The weaker frame
+    int rebuild(const Burst& b, uint32_t now_ms, RecoveredFrame* out, int maxOut) {
+        int candidates[COLLISION_MAX_CANDIDATES];
+        int n = predicted(now_ms, candidates);
+        int found = 0;
+        for (int k = 0; k < n && found < maxOut; k++) {
+            const Track& t = tracks[candidates[k]];
+            // Already have it from this burst
+            if (int32_t(t.lastSeen_ms - b.start_ms) >= 0) continue;
+            int32_t anchors[2] = { findHeader(t), 0 };
+            // The end of the burst as the end of the frame: the last chip is the first of the last bit's second half
+            anchors[1] = (nchips - 1) - 4 * frameBits(t.data) + 2;
+            if (anchors[1] == anchors[0]) anchors[1] = INT32_MIN;
+            for (int32_t c0 : anchors) {
+                if (c0 == INT32_MIN) continue;
+                SoftFrame s;
+                if (!extract(c0, t, candidates[k], now_ms, s)) continue;
+                mergeRecent(s, b.start_ms);
+                if (complete(s, t, out[found])) {
+                    if (out[found].how == RECOVERED_FILLED) stats_.filled++;
+                    else stats_.rebuilt++;
+                    found++;
+                    break;
+                }
+                remember(s);
+            }
+        }
+        return found;
+    }
+
+    // Sensors due about now, or heard a moment ago (this could be the other of the pair), nearest first
+    int predicted(uint32_t now_ms, int* out) const {
+        uint32_t dist[COLLISION_MAX_CANDIDATES];
+        int n = 0;
+        for (int i = 0; i < COLLISION_TRACKS; i++) {
+            const Track& t = tracks[i];
+            if (!t.used) continue;
+            uint32_t since = now_ms - t.lastSeen_ms;
+            uint32_t d;
+            if (since <= COLLISION_PAIR_WINDOW_MS) {
+                d = since;
+            } else if (t.period_ms) {
+                uint32_t k = (since + t.period_ms / 2) / t.period_ms;
+                if (k == 0) continue;
+                int32_t e = int32_t(since - k * t.period_ms);
+                d = uint32_t(e < 0 ? -e : e);
+                // The period estimate is only so good
+                if (d > COLLISION_CADENCE_WINDOW_MS + k * 100) continue;
+            } else {
+                continue;
+            }
+            // Insert in order, dropping the furthest when full
+            if (n == COLLISION_MAX_CANDIDATES && d >= dist[n - 1]) continue;
+            int j = n < COLLISION_MAX_CANDIDATES ? n++ : n - 1;
+            for (; j > 0 && dist[j - 1] > d; j--) {
+                dist[j] = dist[j - 1];
+                out[j] = out[j - 1];
+            }
+            dist[j] = d;
+            out[j] = i;
+        }
+        return n;
+    }
+
+    // Fold in the other transmission of the pair, if we kept it from an earlier burst
+    void mergeRecent(SoftFrame& s, uint32_t burstStart_ms) {
+        for (auto& r : recent) {
+            if (!r.used || r.track != s.track || int32_t(r.at_ms - burstStart_ms) >= 0 ||
+                burstStart_ms - r.at_ms > COLLISION_PAIR_WINDOW_MS) {
+                continue;
+            }
+            for (int i = 0; i < COLLISION_FRAME_BYTES; i++) {
+                uint8_t both = s.known[i] & r.known[i];
+                uint8_t conflict = both & (s.value[i] ^ r.value[i]);
+                uint8_t onlyOld = r.known[i] & ~s.known[i];
+                s.value[i] = uint8_t((s.value[i] & s.known[i]) | (r.value[i] & onlyOld));
+                s.known[i] = uint8_t((s.known[i] | r.known[i]) & ~conflict);
+            }
+            r.used = false;
+        }
+    }
+
+    void remember(const SoftFrame& s) {
+        int slot = 0;
+        for (int i = 0; i < COLLISION_RECENT; i++) {
+            if (!recent[i].used) {
+                slot = i;
+                break;
+            }
+            if (int32_t(recent[i].at_ms - recent[slot].at_ms) < 0) slot = i;
+        }
+        recent[slot] = s;
+    }
+
+    // Header from the track, up to two missing nibbles from the checksum, and it has to be near the last reading
+    bool complete(const SoftFrame& s, const Track& t, RecoveredFrame& out) const {
+        int len = t.len;
+        uint8_t data[COLLISION_FRAME_BYTES];
+        int missing[2];
+        int nmissing = 0;
+        for (int nib = 0; nib < len * 2; nib++) {
+            int byte = nib >> 1, shift = (nib & 1) * 4;
+            uint8_t mask = uint8_t(0xf << shift);
+            uint8_t v;
+            if (nib < 8) {
+                // Type, channel and rolling code don't change; extract() has checked what was heard of them
+                v = uint8_t((t.data[byte] & mask) >> shift);
+            } else if ((s.known[byte] & mask) == mask) {
+                v = uint8_t((s.value[byte] & mask) >> shift);
+            } else {
+                if (nmissing == 2) return false;
+                missing[nmissing++] = nib;
+                v = 0;
+            }
+            if (shift) data[byte] = uint8_t((data[byte] & 0x0f) | (v << 4));
+            else data[byte] = v;
+        }
+
+        int16_t lastTemp = 0;
+        uint8_t lastHum = 0;
+        readingOf(t.data, t.len, lastTemp, lastHum);
+        // With nibbles missing, exactly one of the answers the checksum allows has to be near the last reading
+        int passes = 0;
+        uint8_t best[COLLISION_FRAME_BYTES];
+        int combos = 1 << (4 * nmissing);
+        for (int c = 0; c < combos; c++) {
+            for (int m = 0; m < nmissing; m++) {
+                int nib = missing[m];
+                uint8_t v = uint8_t((c >> (4 * m)) & 0xf);
+                uint8_t& byte = data[nib >> 1];
+                byte = (nib & 1) ? uint8_t((byte & 0x0f) | (v << 4)) : uint8_t((byte & 0xf0) | v);
+            }
+            int16_t temp;
+            uint8_t hum;
+            if (!readingOf(data, len, temp, hum)) continue;
+            // A frame put together from pieces could be someone else's data under this sensor's header that
+            // happens to pass the checksum; the sensor's last reading is what we have to go on
+            if (temp - lastTemp > COLLISION_MAX_TEMP_STEP || lastTemp - temp > COLLISION_MAX_TEMP_STEP) continue;
+            if (hum - lastHum > COLLISION_MAX_HUM_STEP || lastHum - hum > COLLISION_MAX_HUM_STEP) continue;
+            if (++passes > 1) return false;
+            memcpy(best, data, len);
+        }
+        if (!passes) return false;
+        memcpy(out.data, best, len);
+        out.len = uint8_t(len);
+        out.how = nmissing ? RECOVERED_FILLED : RECOVERED_REBUILT;
+        return true;
+    }
+
+    static bool readingOk(const uint8_t* data, int len) {
+        int16_t temp;
+        uint8_t hum;
+        return readingOf(data, len, temp, hum);
+    }
+
+    static bool readingOf(const uint8_t* data, int len, int16_t& temp, uint8_t& hum) {
+        uint16_t type;
+        uint8_t channel, rollingCode;
+        bool battOK;
+        return decodeTempHumidity(data, len, type, channel, rollingCode, temp, hum, battOK);
+    }
+};
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef APPS_COROTASK_H_
+#define APPS_COROTASK_H_
+
+// Cooperative C++20 coroutine tasks for the app main loop
+//
+// Every app so far is one while (true) with a handful of absolute_time_t deadlines, time_reached()
+// checks and flags to remember where it was up to. Here each of those becomes its own task,
+// written as straight line code:
+//
+//   corotask::Task heartbeat() {
+//       while (true) {
+//           co_await corotask::sleep_for(ONE_SECOND_US);
+//           printf(...);
+//       }
+//   }
+//   ...
+//   corotask::scheduler.spawn(heartbeat());
+//   corotask::scheduler.run();
+//
+// Tasks can wait for a time (sleep_for / sleep_until), a Signal (e.g. raised by a GPIO edge ISR),
+// a value from a Queue, or just yield() to let the others run.
+//
+// No heap: coroutine frames are bump allocated from a fixed arena when a task is created, and
+// waiting never allocates, the timer node lives in the awaiting task's own frame.
+// Tasks are expected to run forever; a finished task's frame is not reused.
+//
+// Scheduling is deterministic: each pass of the loop first moves due timers to the ready queue
+// in deadline order (ties in the order they were set), then Signals / Queues that became ready
+// in the order they were waited on, then resumes what is ready in FIFO order. Nothing preempts a task,
+// so tasks share data freely; only ISRs need the Signal / Queue (single producer) handoff.
+//
+// The scheduler keeps its own overhead and wakeup latency numbers, see Stats.
+// No SDK dependency beyond pinhal.h, so host/coro-bench runs the same code against a simulated clock.
+// Needs C++20 (-fcoroutines on GCC 10).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <coroutine>
+
+#include "pinhal.h"
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include <pico/platform.h>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+// Frames for all the tasks of one app; an app with four or five tasks uses well under 1kB
+#ifndef CORO_ARENA_BYTES
+#define CORO_ARENA_BYTES 2048
+#endif
+// Most tasks that can exist at once
+#ifndef CORO_MAX_TASKS
+#define CORO_MAX_TASKS 16
+#endif
+
+namespace corotask {
+
+inline uint64_t now_us() { return pinhal::micros64(); }
+
+[[noreturn]] inline void fatal(const char* why) {
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+    panic("corotask: %s", why);
+#else
+    fprintf(stderr, "corotask: %s\n", why);
+    abort();
+#endif
+}
+
+class FrameArena {
+    alignas(8) uint8_t bytes[CORO_ARENA_BYTES];
+    size_t used = 0;
+
+public:
+    void* allocate(size_t n) {
+        n = (n + 7) & ~size_t(7);
+        if (used + n > sizeof bytes) {
+            fatal("frame arena full, raise CORO_ARENA_BYTES");
+        }
+        void* p = bytes + used;
+        used += n;
+        return p;
+    }
+    size_t bytesUsed() const { return used; }
+    size_t capacity() const { return sizeof bytes; }
+    // Host tests only, once every task made so far is destroyed
+    void reset() { used = 0; }
+};
+
+inline FrameArena arena;
+
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { fatal("exception escaped a task"); }
+
+        static void* operator new(size_t n) { return arena.allocate(n); }
+        static void operator delete(void*) {}
+    };
+
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    Task(Task&& other) : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    // The scheduler takes over the frame
+    std::coroutine_handle<> release() {
+        std::coroutine_handle<> h = handle;
+        handle = nullptr;
+        return h;
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Lives in the awaiting frame, so setting a timer allocates nothing
+struct TimerNode {
+    uint64_t deadline_us;
+    std::coroutine_handle<> waiter;
+    TimerNode* next;
+};
+
+// Something a task can wait on that becomes ready outside the scheduler (an ISR, another task)
+class Waitable {
+public:
+    virtual bool ready() const = 0;
+    // When it became ready, for the latency stats; 0 if not known
+    virtual uint32_t readySince_us() const { return 0; }
+
+protected:
+    ~Waitable() {}
+    friend class Scheduler;
+    std::coroutine_handle<> waiter;
+};
+
+class Scheduler {
+public:
+    struct Stats {
+        uint32_t loops;             // passes of the loop
+        uint32_t idleLoops;         // passes with nothing to resume
+        uint32_t resumes;
+        uint64_t taskTime_us;       // inside tasks
+        uint64_t schedTime_us;      // in the scheduler on passes that resumed something
+        uint32_t timerWakeups;
+        uint64_t timerLateSum_us;   // resumed this long after the deadline
+        uint32_t timerLateMax_us;
+        uint32_t eventWakeups;
+        uint64_t eventLatSum_us;    // resumed this long after the Signal / Queue became ready
+        uint32_t eventLatMax_us;
+    };
+
+private:
+    enum WakeKind : uint8_t { WAKE_NONE, WAKE_TIMER, WAKE_EVENT };
+    struct ReadyEntry {
+        std::coroutine_handle<> h;
+        uint32_t due_us;    // when it should have run, for the latency stats
+        WakeKind kind;
+    };
+    ReadyEntry ready[CORO_MAX_TASKS];
+    uint32_t readyHead = 0;
+    uint32_t readyCount = 0;
+    TimerNode* timers = nullptr;
+    Waitable* parked[CORO_MAX_TASKS];
+    int parkedCount = 0;
+    int taskCount = 0;
+    Stats st = {};
+
+    void makeReady(std::coroutine_handle<> h, WakeKind kind = WAKE_NONE, uint32_t due_us = 0) {
+        if (readyCount >= CORO_MAX_TASKS) {
+            fatal("ready queue full, raise CORO_MAX_TASKS");
+        }
+        ready[(readyHead + readyCount) % CORO_MAX_TASKS] = { h, due_us, kind };
+        readyCount++;
+    }
+
+    static void noteLatency(uint32_t lat, uint64_t& sum, uint32_t& max) {
+        sum += lat;
+        if (lat > max) max = lat;
+    }
+
+public:
+    void spawn(Task&& task) {
+        if (taskCount >= CORO_MAX_TASKS) {
+            fatal("too many tasks, raise CORO_MAX_TASKS");
+        }
+        taskCount++;
+        makeReady(task.release());
+    }
+
+    void addTimer(TimerNode* node) {
+        // Sorted, and after any with the same deadline so equal timers fire in the order they were set
+        TimerNode** p = &timers;
+        while (*p && int64_t((*p)->deadline_us - node->deadline_us) <= 0) {
+            p = &(*p)->next;
+        }
+        node->next = *p;
+        *p = node;
+    }
+
+    void park(Waitable* w, std::coroutine_handle<> h) {
+        if (w->waiter) {
+            fatal("only one task can wait on a Signal / Queue");
+        }
+        w->waiter = h;
+        parked[parkedCount++] = w;
+    }
+
+    void yieldFrom(std::coroutine_handle<> h) { makeReady(h); }
+
+    // One pass: due timers, then ready waitables, then resume everything that was ready at the start
+    // Returns false once there are no tasks left
+    bool runOnce() {
+        uint64_t now = now_us();
+        uint32_t t0 = uint32_t(now);
+        st.loops++;
+        while (timers && int64_t(timers->deadline_us - now) <= 0) {
+            TimerNode* node = timers;
+            timers = node->next;
+            makeReady(node->waiter, WAKE_TIMER, uint32_t(node->deadline_us));
+        }
+        int kept = 0;
+        for (int i = 0; i < parkedCount; i++) {
+            Waitable* w = parked[i];
+            if (w->ready()) {
+                std::coroutine_handle<> h = w->waiter;
+                w->waiter = nullptr;
+                uint32_t since = w->readySince_us();
+                makeReady(h, since ? WAKE_EVENT : WAKE_NONE, since);
+            } else {
+                parked[kept++] = w;
+            }
+        }
+        parkedCount = kept;
+
+        uint32_t n = readyCount;
+        if (!n) {
+            st.idleLoops++;
+            return taskCount > 0;
+        }
+        uint32_t inTasks = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            ReadyEntry e = ready[readyHead];
+            std::coroutine_handle<> h = e.h;
+            readyHead = (readyHead + 1) % CORO_MAX_TASKS;
+            readyCount--;
+            uint32_t r0 = uint32_t(now_us());
+            // Latency is to the actual resume, so it includes the tasks that ran first in this pass
+            if (e.kind == WAKE_TIMER) {
+                st.timerWakeups++;
+                noteLatency(r0 - e.due_us, st.timerLateSum_us, st.timerLateMax_us);
+            } else if (e.kind == WAKE_EVENT) {
+                st.eventWakeups++;
+                noteLatency(r0 - e.due_us, st.eventLatSum_us, st.eventLatMax_us);
+            }
+            h.resume();
+            inTasks += uint32_t(now_us()) - r0;
+            st.resumes++;
+            if (h.done()) {
+                h.destroy();
+                taskCount--;
+            }
+        }
+        st.taskTime_us += inTasks;
+        st.schedTime_us += uint32_t(now_us()) - t0 - inTasks;
+        return taskCount > 0;
+    }
+
+    void run() {
+        while (runOnce()) {}
+    }
+
+    // Earliest timer, for a host loop that wants to jump the simulated clock; false if none
+    bool nextDeadline(uint64_t& t) const {
+        if (!timers) return false;
+        t = timers->deadline_us;
+        return true;
+    }
+
+    int tasks() const { return taskCount; }
+    const Stats& stats() const { return st; }
+    void resetStats() { st = {}; }
+};
+
+inline Scheduler scheduler;
+
+struct SleepAwaiter {
+    TimerNode node;
+    bool await_ready() const { return int64_t(node.deadline_us - now_us()) <= 0; }
+    void await_suspend(std::coroutine_handle<> h) {
+        node.waiter = h;
+        scheduler.addTimer(&node);
+    }
+    void await_resume() const {}
+};
+
+inline SleepAwaiter sleep_until(uint64_t t_us) { return SleepAwaiter{ { t_us, nullptr, nullptr } }; }
+inline SleepAwaiter sleep_for(uint32_t us) { return sleep_until(now_us() + us); }
+
+struct YieldAwaiter {
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) { scheduler.yieldFrom(h); }
+    void await_resume() const {}
+};
+
+inline YieldAwaiter yield() { return {}; }
+
+// Raised from an ISR (or a task), waited on by one task.
+// Raises are counted, not queued: one wakeup covers however many happened since the last,
+// and co_await returns how many that was. Only plain loads and stores, no atomic RMW,
+// which the M0+ does not have: the ISR is the only writer of posted, the task of taken.
+class Signal : public Waitable {
+    std::atomic<uint32_t> posted{0};
+    std::atomic<uint32_t> firstAt_us{0};
+    uint32_t taken = 0;
+
+public:
+    inline void notify() {
+        uint32_t p = posted.load(std::memory_order_relaxed);
+        if (p == taken) firstAt_us.store(uint32_t(now_us()), std::memory_order_relaxed);
+        posted.store(p + 1, std::memory_order_release);
+    }
+
+    bool ready() const override { return posted.load(std::memory_order_acquire) != taken; }
+    uint32_t readySince_us() const override { return firstAt_us.load(std::memory_order_relaxed); }
+
+    uint32_t take() {
+        uint32_t p = posted.load(std::memory_order_acquire);
+        uint32_t n = p - taken;
+        taken = p;
+        return n;
+    }
+
+    struct Awaiter {
+        Signal& s;
+        bool await_ready() const { return s.ready(); }
+        void await_suspend(std::coroutine_handle<> h) { scheduler.park(&s, h); }
+        uint32_t await_resume() const { return s.take(); }
+    };
+    Awaiter operator co_await() { return Awaiter{ *this }; }
+};
+
+// Single producer (ISR or task) / single consumer (one task) queue of N (power of two) values
+template <typename T, unsigned N>
+class Queue : public Waitable {
+    static_assert((N & (N - 1)) == 0, "Queue size must be a power of two");
+    T items[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> drops{0};
+    std::atomic<uint32_t> firstAt_us{0};
+
+public:
+    // Producer side; false (and counted) if full
+    bool push(const T& v) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (h - t >= N) {
+            drops.store(drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (N - 1)] = v;
+        // Going from empty to ready; the consumer only parks on an empty queue, so this is what wakes it
+        if (h == t) firstAt_us.store(uint32_t(now_us()), std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool ready() const override { return head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed); }
+    uint32_t readySince_us() const override { return firstAt_us.load(std::memory_order_relaxed); }
+
+    bool tryPop(T& v) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        v = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t dropCount() const { return drops.load(std::memory_order_relaxed); }
+
+    struct PopAwaiter {
+        Queue& q;
+        bool await_ready() const { return q.ready(); }
+        void await_suspend(std::coroutine_handle<> h) { scheduler.park(&q, h); }
+        T await_resume() {
+            T v{};
+            q.tryPop(v);
+            return v;
+        }
+    };
+    // T v = co_await queue.pop();
+    PopAwaiter pop() { return PopAwaiter{ *this }; }
+};
+
+} // namespace corotask
+
+#endif
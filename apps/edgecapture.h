@@ -0,0 +1,76 @@
+#ifndef APPS_EDGECAPTURE_H_
+#define APPS_EDGECAPTURE_H_
+
+// Per radio DIO2 edge capture
+//
+// The single radio apps pass one pulse length through sharedData, which is fine when the loop
+// does nothing else, but with several radios the loop is busy with the other decoders and
+// would drop edges. So each radio gets a ring of edge timestamps, filled by its own ISR
+// (single producer) and drained by the loop (single consumer), and the loop turns them into
+// pulse widths for that radio's decoder.
+//
+// No SDK dependency, so the host simulations run the same code.
+
+#include <stdint.h>
+#include <atomic>
+
+template <unsigned N>
+class EdgeRing {
+    static_assert((N & (N - 1)) == 0, "EdgeRing size must be a power of two");
+    uint32_t t_us[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> overflows{0};
+
+public:
+    // ISR side
+    inline void push(uint32_t now_us) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        t_us[h & (N - 1)] = now_us;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Loop side
+    inline bool pop(uint32_t& now_us) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        now_us = t_us[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t pending() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed); }
+    uint32_t overflowCount() const { return overflows.load(std::memory_order_relaxed); }
+};
+
+// Enough for ~60ms of Oregon edges, far longer than any one pass of the loop
+#define EDGE_RING_SIZE 128
+
+class EdgeCapture {
+    EdgeRing<EDGE_RING_SIZE> ring;
+    uint32_t prev_us = 0;
+    uint32_t edges = 0;
+
+public:
+    inline void onEdge(uint32_t now_us) { ring.push(now_us); }
+
+    // Next interval between edges, the same value sharedData.nextPulseLength_us carried
+    bool nextWidth(uint32_t& width_us) {
+        uint32_t t;
+        if (!ring.pop(t)) return false;
+        width_us = t - prev_us;
+        prev_us = t;
+        edges++;
+        return true;
+    }
+
+    uint32_t lastEdge_us() const { return prev_us; }
+    uint32_t edgeCount() const { return edges; }
+    uint32_t overflowCount() const { return ring.overflowCount(); }
+};
+
+#endif
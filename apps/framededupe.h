@@ -0,0 +1,93 @@
+#ifndef APPS_FRAMEDEDUPE_H_
+#define APPS_FRAMEDEDUPE_H_
+
+// Merges decoded frames from several radios into one output stream
+//
+// The same transmission is normally heard twice per radio (the repeated pair, ~10ms apart)
+// and once more on every other radio that is in range. Frames with identical payload bytes
+// arriving inside the window are one reading; we remember which radios heard it and the best RSSI,
+// and only hand it out once the window has closed, so the output says which antennas are doing the work.
+//
+// Fixed size table, no allocation. No SDK dependency, the host simulation uses this too.
+
+#include <stdint.h>
+#include <string.h>
+
+#define DEDUPE_MAX_BYTES 12
+
+struct MergedFrame {
+    uint8_t data[DEDUPE_MAX_BYTES];
+    uint8_t len;
+    uint8_t radios;         // bit per radio that decoded it
+    uint8_t bestRadio;
+    uint16_t copies;
+    float bestRssi;
+    uint32_t firstSeen_ms;
+};
+
+template <int SLOTS>
+class FrameDedupe {
+    MergedFrame slots[SLOTS];
+    bool used[SLOTS];
+    uint32_t window_ms;
+    uint32_t dropped = 0;
+
+public:
+    explicit FrameDedupe(uint32_t window = 500) : window_ms(window) {
+        memset(used, 0, sizeof used);
+    }
+
+    // Returns true if this was the first copy
+    bool offer(uint8_t radio, const uint8_t* data, uint8_t len, float rssi, uint32_t now_ms) {
+        if (len > DEDUPE_MAX_BYTES) len = DEDUPE_MAX_BYTES;
+        int freeSlot = -1;
+        for (int i = 0; i < SLOTS; i++) {
+            if (!used[i]) {
+                if (freeSlot < 0) freeSlot = i;
+                continue;
+            }
+            MergedFrame& f = slots[i];
+            if (f.len == len && now_ms - f.firstSeen_ms < window_ms && !memcmp(f.data, data, len)) {
+                f.radios |= 1 << radio;
+                f.copies++;
+                // RSSI is dBm, so higher (less negative) is better
+                if (rssi > f.bestRssi) {
+                    f.bestRssi = rssi;
+                    f.bestRadio = radio;
+                }
+                return false;
+            }
+        }
+        if (freeSlot < 0) {
+            // More distinct frames inside one window than we have slots; not expected
+            dropped++;
+            return false;
+        }
+        MergedFrame& f = slots[freeSlot];
+        memcpy(f.data, data, len);
+        f.len = len;
+        f.radios = 1 << radio;
+        f.bestRadio = radio;
+        f.copies = 1;
+        f.bestRssi = rssi;
+        f.firstSeen_ms = now_ms;
+        used[freeSlot] = true;
+        return true;
+    }
+
+    // Hand out one frame whose window has closed
+    bool poll(uint32_t now_ms, MergedFrame& out) {
+        for (int i = 0; i < SLOTS; i++) {
+            if (used[i] && now_ms - slots[i].firstSeen_ms >= window_ms) {
+                out = slots[i];
+                used[i] = false;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t droppedCount() const { return dropped; }
+};
+
+#endif
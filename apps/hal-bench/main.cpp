@@ -0,0 +1,129 @@
+// Microbenchmark of the arduino-compat calls on the edge timing hot path vs pinhal.h
+//
+// Cycle counts come from SysTick running at clk_sys, so they include the call overhead
+// as the compiler actually generated it.
+// The ISR comparison fires the DIO2 GPIO interrupt in software (the INTF force register),
+// so nothing needs to be connected; each round measures from the force write until
+// the handler has recorded its timestamp, i.e. dispatch plus the body of the
+// dio2InterruptHandler used in ook-timing / oregon-decode.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <pico/stdlib.h>
+#include <hardware/clocks.h>
+#include <hardware/irq.h>
+#include <hardware/structs/systick.h>
+#include <hardware/structs/iobank0.h>
+
+#include "../picopins.h"
+#include "../pinhal.h"
+
+#define ROUNDS 1000
+
+static volatile uint32_t isrCycles;
+static volatile uint32_t nextPulseLength_us;
+static uint32_t prevTime_us;
+
+static inline uint32_t cycles() {
+    // SysTick counts down
+    return 0xffffff - systick_hw->cvr;
+}
+
+static inline uint32_t elapsed(uint32_t t0, uint32_t t1) {
+    return (t1 - t0) & 0xffffff;
+}
+
+static inline void forceDio2(bool on) {
+    const uint reg = RFM69_DIO2 >> 3;
+    const uint32_t bit = GPIO_IRQ_EDGE_RISE << (4 * (RFM69_DIO2 & 7));
+    if (on) hw_set_bits(&iobank0_hw->proc0_irq_ctrl.intf[reg], bit);
+    else hw_clear_bits(&iobank0_hw->proc0_irq_ctrl.intf[reg], bit);
+}
+
+void arduinoHandler() {
+    auto now = micros();
+    nextPulseLength_us = now - prevTime_us;
+    prevTime_us = now;
+    isrCycles = cycles();
+    forceDio2(false);
+}
+
+void halHandler() {
+    auto now = pinhal::micros32();
+    nextPulseLength_us = now - prevTime_us;
+    prevTime_us = now;
+    isrCycles = cycles();
+    forceDio2(false);
+}
+
+template <typename F>
+static uint32_t measure(F f) {
+    uint32_t total = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        uint32_t t0 = cycles();
+        f();
+        uint32_t t1 = cycles();
+        total += elapsed(t0, t1);
+    }
+    return total / ROUNDS;
+}
+
+static uint32_t measureIsr() {
+    uint32_t total = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        isrCycles = 0;
+        uint32_t t0 = cycles();
+        forceDio2(true);
+        while (!isrCycles) { tight_loop_contents(); }
+        total += elapsed(t0, isrCycles);
+    }
+    return total / ROUNDS;
+}
+
+int main() {
+    stdio_init_all();
+    sleep_ms(2000);
+
+    systick_hw->rvr = 0xffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5; // enable, clk_sys, no interrupt
+
+    pinMode(LOGIC_TRIGGER, OUTPUT);
+    pinMode(RFM69_DIO2, INPUT_PULLDOWN);
+
+    // Subtract the cost of the measurement itself
+    uint32_t empty = measure([] { __asm volatile ("" ::: "memory"); });
+
+    uint32_t cWrite = measure([] { digitalWrite(LOGIC_TRIGGER, HIGH); digitalWrite(LOGIC_TRIGGER, LOW); });
+    uint32_t cMicros = measure([] { volatile uint32_t t = micros(); (void)t; });
+    uint32_t cRead = measure([] { volatile int v = digitalRead(RFM69_DIO2); (void)v; });
+
+    pinhal::OutputPin<LOGIC_TRIGGER>::begin();
+    uint32_t hWrite = measure([] { pinhal::OutputPin<LOGIC_TRIGGER>::high(); pinhal::OutputPin<LOGIC_TRIGGER>::low(); });
+    uint32_t hMicros = measure([] { volatile uint32_t t = pinhal::micros32(); (void)t; });
+    uint32_t hRead = measure([] { volatile bool v = pinhal::InputPin<RFM69_DIO2>::read(); (void)v; });
+
+    printf("Cycles per operation (clk_sys %d MHz, %d rounds, loop overhead %lu removed)\n", int(clock_get_hz(clk_sys) / 1000000), ROUNDS, (unsigned long)empty);
+    printf("%-28s %10s %10s\n", "", "arduino", "pinhal");
+    printf("%-28s %10lu %10lu\n", "digitalWrite high+low", (unsigned long)(cWrite - empty), (unsigned long)(hWrite - empty));
+    printf("%-28s %10lu %10lu\n", "micros", (unsigned long)(cMicros - empty), (unsigned long)(hMicros - empty));
+    printf("%-28s %10lu %10lu\n", "digitalRead", (unsigned long)(cRead - empty), (unsigned long)(hRead - empty));
+
+    // The two ISR registrations cannot coexist (see pinhal.h) so run the arduino one first,
+    // then tear it down before installing the pinhal one; attach() takes off the exclusive
+    // handler older SDKs leave behind
+    attachInterrupt(digitalPinToInterrupt(RFM69_DIO2), arduinoHandler, RISING);
+    uint32_t cIsr = measureIsr();
+    detachInterrupt(digitalPinToInterrupt(RFM69_DIO2));
+
+    pinhal::EdgeIrq<RFM69_DIO2, halHandler, GPIO_IRQ_EDGE_RISE>::attach();
+    uint32_t hIsr = measureIsr();
+
+    printf("%-28s %10lu %10lu\n", "edge to handler done", (unsigned long)cIsr, (unsigned long)hIsr);
+    printf("Per edge saving: %ld cycles\n", (long)cIsr - (long)hIsr);
+
+    while (true) {
+        sleep_ms(1000);
+    }
+    return 0;
+}
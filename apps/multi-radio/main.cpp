@@ -0,0 +1,193 @@
+// Two (or more, see radioPins) RFM69 modules on one Pico
+//
+// Each module has its own DIO2 edge capture ISR and its own Oregon decoder; decoded frames from all
+// modules are merged, so a reading heard by both antennas (or in both repeats of the pair) is printed once.
+// The modules can be on two frequencies, or on the same frequency with the antennas in two places
+// for diversity. The SPI pins are shared by default, see picopins.h.
+//
+// Output is the same as oregon-decode, so ook-ingest can read it, with the radios that heard it on the end:
+//   n,type,channel,rolling,temp,hum,Batt=ok,rssidB,radios=3,best=1
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <pico/stdlib.h>
+#include <array>
+#include <utility>
+#include "../rfm69common.h"
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../oregon.h"
+#include "../edgecapture.h"
+#include "../framededupe.h"
+#include "../radiohealth.h"
+
+#include "../picopins.h"
+#include "../pinhal.h"
+
+#define RADIO_A_FREQUENCY_MHZ 433.92
+// Same frequency for antenna diversity; change to cover a second band
+#define RADIO_B_FREQUENCY_MHZ 433.92
+
+#define ONE_SECOND_US (1000 * 1000)
+#define STATS_INTERVAL_US (10 * ONE_SECOND_US)
+
+struct RadioChannel {
+    Rfm69Common rfm;
+    EdgeCapture capture;
+    OregonDecoderV2 decoder;
+    uint32_t frames;
+    uint32_t decoded;
+};
+
+// Everything is static, nothing on the heap and nothing big on the 2kB main stack; see rambudget.h
+static Rfm69Bus busA;
+#if RFM69_B_SHARED_SPI
+static constexpr Rfm69Bus& busB = busA;
+#else
+static Rfm69Bus busB;
+#endif
+
+struct RadioPins {
+    Rfm69Bus* bus;
+    uint8_t cs, irq, rst, dio2;
+    float frequencyMHz;
+};
+
+// One line per module, everything else follows from it; a third wants its pins in picopins.h and a line here
+// (FrameDedupe keeps which radios heard a frame as bits, so up to 8)
+static constexpr RadioPins radioPins[] = {
+    { &busA, RFM69_CS, RFM69_IRQ, RFM69_RST, RFM69_DIO2, RADIO_A_FREQUENCY_MHZ },
+    { &busB, RFM69_B_CS, RFM69_B_IRQ, RFM69_B_RST, RFM69_B_DIO2, RADIO_B_FREQUENCY_MHZ },
+};
+static constexpr int NUM_RADIOS = sizeof radioPins / sizeof radioPins[0];
+
+static RadioChannel radios[NUM_RADIOS];
+// Both of the pair, on both radios, land well inside half a second
+static FrameDedupe<8> dedupe(500);
+
+// RadioHealth takes its radio when it is made, so the array is made a radio at a time
+template <size_t... I>
+static std::array<RadioHealth<Rfm69Common>, NUM_RADIOS> makeHealth(std::index_sequence<I...>) {
+    return { { RadioHealth<Rfm69Common>(radios[I].rfm)... } };
+}
+static std::array<RadioHealth<Rfm69Common>, NUM_RADIOS> health = makeHealth(std::make_index_sequence<NUM_RADIOS>());
+
+RAM_BUDGET_CHECK(EdgeCapture, RAM_BUDGET_CAPTURE);
+RAM_BUDGET_CHECK(OregonDecoderV2, RAM_BUDGET_DECODER);
+RAM_BUDGET_CHECK(FrameDedupe<8>, RAM_BUDGET_DEDUPE);
+static_assert(NUM_RADIOS <= 8, "FrameDedupe keeps the radios as 8 bits");
+static_assert(sizeof(radios) + sizeof(dedupe) + 2 * sizeof(Rfm69Bus) <= RAM_BUDGET_PIPELINE,
+    "multi-radio pipeline is over its RAM budget");
+
+// One ISR per module, each pinned at compile time to its own DIO2
+template <size_t Index>
+void __not_in_flash_func(dio2Isr)() {
+    radios[Index].capture.onEdge(pinhal::micros32());
+}
+
+template <size_t... I>
+static void beginDio2(std::index_sequence<I...>) {
+    (pinhal::InputPin<radioPins[I].dio2>::begin(), ...);
+}
+
+template <size_t... I>
+static void attachDio2(std::index_sequence<I...>) {
+    (pinhal::EdgeIrq<radioPins[I].dio2, dio2Isr<I>>::attach(), ...);
+}
+
+int main() {
+    pinhal::OutputPin<LOGIC_TRIGGER>::begin(LOW);
+
+    stdio_init_all();
+
+    beginDio2(std::make_index_sequence<NUM_RADIOS>());
+
+    busA.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK);
+#if !RFM69_B_SHARED_SPI
+    busB.setPins(RFM69_B_MISO, RFM69_B_MOSI, RFM69_B_SCK);
+#endif
+    // Deselect them all before any is reset or initialised
+    for (int r = 0; r < NUM_RADIOS; r++) {
+        const RadioPins& p = radioPins[r];
+        radios[r].rfm.setBus(*p.bus, p.cs, p.irq, p.rst);
+    }
+    for (int r = 0; r < NUM_RADIOS; r++) {
+        const RadioPins& p = radioPins[r];
+        printf("Radio %c at %.3f MHz", 'A' + r, p.frequencyMHz);
+        if (r > 0) printf(" (%s SPI)", p.bus == &busA ? "shared" : "separate");
+        printf("\n");
+        radios[r].rfm.begin(p.frequencyMHz);
+    }
+
+    attachDio2(std::make_index_sequence<NUM_RADIOS>());
+
+    printf("Start decoding...\n");
+    absolute_time_t tNow = get_absolute_time();
+    absolute_time_t tNextSecond = delayed_by_us(tNow, ONE_SECOND_US);
+    absolute_time_t tNextStats = delayed_by_us(tNow, STATS_INTERVAL_US);
+    int n = 0;
+    uint32_t merged = 0;
+    while (true) {
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        for (int r = 0; r < NUM_RADIOS; r++) {
+            RadioChannel& radio = radios[r];
+            uint32_t width_us;
+            // Drain everything the ISR has queued for this module
+            while (radio.capture.nextWidth(width_us)) {
+                if (!radio.decoder.nextPulse(width_us)) {
+                    continue;
+                }
+                radio.frames++;
+                uint8_t len;
+                const uint8_t* data = radio.decoder.getData(len);
+                uint16_t actualType;
+                uint8_t channel, rollingCode, hum;
+                int16_t temp;
+                bool battOK;
+                if (data && decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK)) {
+                    radio.decoded++;
+                    float rssi = radio.rfm.readRSSIByte() / -2.0F;
+                    dedupe.offer(r, data, checkedLength(data, len), rssi, now_ms);
+                }
+                radio.decoder.resetDecoder();
+            }
+        }
+
+        MergedFrame f;
+        while (dedupe.poll(now_ms, f)) {
+            uint16_t actualType;
+            uint8_t channel, rollingCode, hum;
+            int16_t temp;
+            bool battOK;
+            decodeTempHumidity(f.data, f.len, actualType, channel, rollingCode, temp, hum, battOK);
+            printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB,radios=%x,best=%d\n", n, actualType, channel, rollingCode,
+                temp / 10.F, hum, battOK ? "ok" : "flat", f.bestRssi, f.radios, f.bestRadio);
+            merged++;
+        }
+
+        if (time_reached(tNextStats)) {
+            tNextStats = delayed_by_us(get_absolute_time(), STATS_INTERVAL_US);
+            for (int r = 0; r < NUM_RADIOS; r++) {
+                const SpiArbiter::Stats& bs = radios[r].rfm.busStats();
+                printf("# radio %c edges=%lu overflow=%lu frames=%lu decoded=%lu spi=%lu contended=%lu\n", 'A' + r,
+                    (unsigned long)radios[r].capture.edgeCount(), (unsigned long)radios[r].capture.overflowCount(),
+                    (unsigned long)radios[r].frames, (unsigned long)radios[r].decoded,
+                    (unsigned long)bs.transactions, (unsigned long)bs.contended);
+            }
+            printf("# merged=%lu\n", (unsigned long)merged);
+        }
+
+        if (time_reached(tNextSecond)) {
+            tNextSecond = delayed_by_us(get_absolute_time(), ONE_SECOND_US);
+            n++;
+            for (int r = 0; r < NUM_RADIOS; r++) {
+                if (health[r].check(now_ms, radios[r].capture.edgeCount())) {
+                    printf("# radio %c health %s: detected after %lums, full resets %lu\n", 'A' + r,
+                        health[r].causeName(health[r].lastFault()), (unsigned long)health[r].stats().lastDetect_ms,
+                        (unsigned long)health[r].stats().fullResets);
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -38,6 +38,8 @@
 // This is the RSSI to use to trigger the logic analyser
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+static Rfm69Common rfm69;
+
 int main() {
     // Trigger for the logic analyser, corresponds to the first pulse in RSSI
     pinMode(LOGIC_TRIGGER, OUTPUT);
@@ -45,7 +47,6 @@ int main() {
 
     stdio_init_all();
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
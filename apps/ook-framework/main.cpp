@@ -1,13 +1,29 @@
 // Simple frameork for copying to start additional experiments
+//
+// Rather than one while (true) with a deadline and a flag for everything, each job is its own
+// coroutine task (see corotask.h), and the scheduler runs them:
+//   - decode: wakes on DIO2 edges, runs the Oregon decoder, queues complete frames
+//   - report: prints each queued frame the same way oregon-decode does
+//   - radio: polls RSSI and keeps the background level
+//   - heartbeat: the spinner once a second
+//   - health: the radio watchdog (radiohealth.h)
+//   - stats: scheduler overhead and wakeup latency every STATS_INTERVAL_US
+// Add an experiment as another task.
 
 #include <Arduino.h>
 #include <stdio.h>
+#include <string.h>
 #include <pico/stdlib.h>
 #include "../rfm69common.h"
 #include "DecodeOOK.h"
 #include "OregonDecoderV2.h"
+#include "../oregon.h"
+#include "../edgecapture.h"
+#include "../corotask.h"
+#include "../radiohealth.h"
 
 #include "../picopins.h"
+#include "../pinhal.h"
 
 // See ook-demod for a description of these common constants
 
@@ -18,6 +34,119 @@
 
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+#define RSSI_POLL_US (100 * 1000)
+#define STATS_INTERVAL_US (10 * ONE_SECOND_US)
+
+struct DecodedFrame {
+    uint8_t data[12];
+    uint8_t len;
+    float rssi;
+};
+
+static Rfm69Common rfm69;
+static EdgeCapture capture;
+static OregonDecoderV2 orscV2;
+static corotask::Signal dio2Edges;
+static corotask::Queue<DecodedFrame, 4> frames;
+static RadioHealth<Rfm69Common> health(rfm69);
+// The task frames come out of the arena, so it counts as part of the pipeline too
+static_assert(sizeof(rfm69) + sizeof(capture) + sizeof(orscV2) + sizeof(frames) + sizeof(health) + sizeof(corotask::arena)
+    <= RAM_BUDGET_PIPELINE, "ook-framework pipeline is over its RAM budget");
+
+// Latest RSSI and the slow moving background, kept by the radio task
+static float rssiNow = 0;
+static float rssiBackground = 0;
+
+void dio2InterruptHandler();
+typedef pinhal::EdgeIrq<RFM69_DIO2, dio2InterruptHandler> Dio2Irq;
+
+void __not_in_flash_func(dio2InterruptHandler)() {
+    capture.onEdge(pinhal::micros32());
+    dio2Edges.notify();
+}
+
+static corotask::Task decodeTask() {
+    while (true) {
+        co_await dio2Edges;
+        uint32_t width_us;
+        while (capture.nextWidth(width_us)) {
+            if (!orscV2.nextPulse(width_us)) {
+                continue;
+            }
+            DecodedFrame f;
+            const uint8_t* data = orscV2.getData(f.len);
+            if (data && f.len <= sizeof f.data) {
+                memcpy(f.data, data, f.len);
+                // Read straight after the frame, while the transmitter is still the strongest thing around
+                f.rssi = rfm69.readRSSIByte() / -2.0F;
+                frames.push(f);
+            }
+            orscV2.resetDecoder();
+        }
+    }
+}
+
+static corotask::Task reportTask() {
+    int n = 0;
+    while (true) {
+        DecodedFrame f = co_await frames.pop();
+        uint16_t actualType;
+        uint8_t channel, rollingCode, hum;
+        int16_t temp;
+        bool battOK;
+        if (decodeTempHumidity(f.data, f.len, actualType, channel, rollingCode, temp, hum, battOK)) {
+            printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB\n", n++, actualType, channel, rollingCode, temp / 10.F, hum,
+                battOK ? "ok" : "flat", f.rssi);
+        }
+    }
+}
+
+static corotask::Task radioTask() {
+    uint64_t next = corotask::now_us();
+    while (true) {
+        next += RSSI_POLL_US;
+        co_await corotask::sleep_until(next);
+        rssiNow = rfm69.readRSSIByte() / -2.0F;
+        rssiBackground = rssiBackground == 0 ? rssiNow : rssiBackground * 0.98F + rssiNow * 0.02F;
+    }
+}
+
+static corotask::Task heartbeatTask() {
+    int n = 0;
+    uint64_t next = corotask::now_us();
+    while (true) {
+        next += ONE_SECOND_US;
+        co_await corotask::sleep_until(next);
+        printf((n % 2 == 0) ? "- %d %.1f %.1f    \r" : "| %d %.1f %.1f    \r", n, rssiNow, rssiBackground);
+        n++;
+    }
+}
+
+static corotask::Task healthTask() {
+    uint64_t next = corotask::now_us();
+    while (true) {
+        next += ONE_SECOND_US;
+        co_await corotask::sleep_until(next);
+        if (health.check(uint32_t(corotask::now_us() / 1000), capture.edgeCount())) {
+            printf("# health %s: detected after %lums, full resets %lu\n", health.causeName(health.lastFault()),
+                (unsigned long)health.stats().lastDetect_ms, (unsigned long)health.stats().fullResets);
+        }
+    }
+}
+
+static corotask::Task statsTask() {
+    while (true) {
+        corotask::scheduler.resetStats();
+        co_await corotask::sleep_for(STATS_INTERVAL_US);
+        const corotask::Scheduler::Stats& s = corotask::scheduler.stats();
+        printf("# sched passes=%lu idle=%lu resumes=%lu sched_us=%llu task_us=%llu timer_late_us=%.1f/%lu event_lat_us=%.1f/%lu edges=%lu overflow=%lu\n",
+            (unsigned long)s.loops, (unsigned long)s.idleLoops, (unsigned long)s.resumes,
+            (unsigned long long)s.schedTime_us, (unsigned long long)s.taskTime_us,
+            s.timerWakeups ? double(s.timerLateSum_us) / s.timerWakeups : 0.0, (unsigned long)s.timerLateMax_us,
+            s.eventWakeups ? double(s.eventLatSum_us) / s.eventWakeups : 0.0, (unsigned long)s.eventLatMax_us,
+            (unsigned long)capture.edgeCount(), (unsigned long)capture.overflowCount());
+    }
+}
 
 int main() {
     pinMode(LOGIC_TRIGGER, OUTPUT);
@@ -25,28 +154,22 @@ int main() {
 
     stdio_init_all();
 
-    pinMode(RFM69_DIO2, INPUT_PULLDOWN);
+    pinhal::InputPin<RFM69_DIO2>::begin();
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
     printf("Start...\n");
-    absolute_time_t tNow = get_absolute_time();
-    absolute_time_t tNextSecond = delayed_by_us(tNow, ONE_SECOND_US);
-    int n=0;
-    float rssi;
-    auto t0 = to_ms_since_boot(tNow);
-    while (true) {
-        if (time_reached(tNextSecond)) {
-            auto t1 = to_ms_since_boot(get_absolute_time());
-            tNow = get_absolute_time();
-            tNextSecond = delayed_by_us(tNow, ONE_SECOND_US);
-            rssi = rfm69.readRSSIByte() / -2.0F;
-            printf((n % 2 == 0) ? "- %d %.1f    \r" : "| %d %.1f    \r", (t1 - t0)/1000, rssi);
-            sleep_ms(1);
-            n++;
-        }
-    }
+    Dio2Irq::attach();
+
+    corotask::scheduler.spawn(decodeTask());
+    corotask::scheduler.spawn(reportTask());
+    corotask::scheduler.spawn(radioTask());
+    corotask::scheduler.spawn(heartbeatTask());
+    corotask::scheduler.spawn(healthTask());
+    corotask::scheduler.spawn(statsTask());
+    printf("%d tasks, %u of %u bytes of frame arena\n", corotask::scheduler.tasks(),
+        (unsigned)corotask::arena.bytesUsed(), (unsigned)corotask::arena.capacity());
+    corotask::scheduler.run();
     return 0;
 }
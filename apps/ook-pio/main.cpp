@@ -22,13 +22,14 @@
 
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+static Rfm69Common rfm69;
+
 int main() {
     pinMode(LOGIC_TRIGGER, OUTPUT);
     digitalWrite(LOGIC_TRIGGER, LOW);
 
     stdio_init_all();
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
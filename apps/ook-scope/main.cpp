@@ -3,16 +3,32 @@
 // becuase empirically the SPI and loop overhead means we can't do this any faster than about 70us 
 // It prints it to the serial port, integrating over a specified number of bins,
 // allowing us to see in realtime a possible nearby signal detection
+//
+// With SWEEP_MODE 1 it instead steps the receiver across a span either side of RF_FREQUENCY_MHZ
+// and streams RSSI per frequency bin, one line per sweep, i.e. a waterfall; host/sweep-view turns
+// that into a picture and a per bin summary. This is what I had been getting the RTL-SDR out for,
+// to see where a transmitter's energy actually lands relative to 433.92
+//
+// With STREAM_MODE 1 it sends every sample instead, packed by rssicodec.h into blocks of hex lines,
+// for host/rssi-stream to put back together exactly and plot
 
 #include <Arduino.h>
 #include <stdio.h>
 #include <pico/stdlib.h>
 #include "../rfm69common.h"
+#include "../pinhal.h"
+#include "../rssicodec.h"
 
 // Set this to 1 to print every sample binned, otherwise it only prints
 // when > 1 point above the long term background
 #define PRINT_ALL_VALUES 0
 
+// Set this to 1 for the spectrum sweep (waterfall) instead
+#define SWEEP_MODE 0
+
+// Set this to 1 to stream every RSSI sample, compressed, instead
+#define STREAM_MODE 0
+
 
 // See ook-demod for a description of these common constants
 
@@ -25,6 +41,26 @@
 
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+// Sweep: SWEEP_SPAN_HZ centred on RF_FREQUENCY_MHZ in SWEEP_STEP_HZ bins
+// The receiver bandwidth wants to be about the step, or bins overlap (wider) or there are gaps (narrower).
+// OOK RxBw = FXOSC / (mant * 2^(exp+3)), register is DCC(7-5) mant(4-3: 16,20,24) exp(2-0)
+// 0x4c is 4% DCC, 20, 4 --> 12.5kHz. (begin() uses 0x49, 100kHz, for receiving)
+// The settle time is after RestartRx before reading RSSI; narrower bandwidth needs longer,
+// the sweep stats line shows what each bin actually costs so this can be tuned from the data
+#define SWEEP_SPAN_HZ 1000000
+#define SWEEP_STEP_HZ 12500
+#define SWEEP_RXBW 0x4c
+#define SWEEP_SETTLE_US 250
+#define SWEEP_MAX_BINS 256
+#define SWEEP_STATS_INTERVAL_US ONE_SECOND_US
+
+// Stream: one sample every STREAM_POLL_US, the same rate as the integrating scope, on a fixed grid so
+// the host gets each sample's time from the block's. The line being sent goes out a few characters at
+// a time while waiting for the next poll, stopping STREAM_SEND_MARGIN_US short of it
+#define STREAM_POLL_US 100
+#define STREAM_SEND_MARGIN_US 20
+#define STREAM_STATS_INTERVAL_US ONE_SECOND_US
+
 struct shared_data_t {
     volatile uint32_t edgesCount;
     volatile uint32_t nextPulseLength_us;
@@ -37,6 +73,11 @@ static shared_data_t sharedData = {
     .now = 0,
 };
 
+static Rfm69Common rfm69;
+
+static void runSweep();
+static void runStream();
+
 int main() {
     pinMode(LOGIC_TRIGGER, OUTPUT);
     digitalWrite(LOGIC_TRIGGER, LOW);
@@ -45,10 +86,16 @@ int main() {
 
     pinMode(RFM69_DIO2, INPUT_PULLDOWN);
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
+    if (SWEEP_MODE) {
+        runSweep(); // does not return
+    }
+    if (STREAM_MODE) {
+        runStream(); // does not return
+    }
+
     const int rssiPoll_us = 100;
     auto nextOutput_us = ONE_SECOND_US /4;
     // integrate and output over one quarter second
@@ -116,3 +163,172 @@ int main() {
     }
     return 0;
 }
+
+static uint32_t sweepFrf[SWEEP_MAX_BINS];
+
+static inline void putHexByte(uint8_t b) {
+    static const char hex[] = "0123456789abcdef";
+    putchar_raw(hex[b >> 4]);
+    putchar_raw(hex[b & 15]);
+}
+
+// Output format, so the host can reconstruct the axes:
+//   # sweep start_hz=433420000 step_hz=12500 bins=81 rxbw=4c settle_us=250
+//   W <sweep> <ms since boot> <bins x 2 hex digits, raw RSSI byte i.e. -2 x dBm>
+//   # stats sweeps/s=11.6 bin_us=1065.3 settle_us=250 overhead_us=815.3 max_bin_us=1310
+//
+// Each bin is pipelined: read RSSI for this bin, retune to the next and restart the receiver,
+// then while that settles, write out the bin we just read. So the serial output
+// is done inside the settle time and costs nothing as long as it fits.
+static void runSweep() {
+    const uint32_t centre_hz = uint32_t(RF_FREQUENCY_MHZ * 1000000 + 0.5);
+    const uint32_t start_hz = centre_hz - SWEEP_SPAN_HZ / 2;
+    int bins = SWEEP_SPAN_HZ / SWEEP_STEP_HZ + 1;
+    if (bins > SWEEP_MAX_BINS) { bins = SWEEP_MAX_BINS; }
+    for (int k = 0; k < bins; k++) {
+        sweepFrf[k] = Rfm69Common::frfForHz(start_hz + uint32_t(k) * SWEEP_STEP_HZ);
+    }
+
+    rfm69.setRxBandwidth(SWEEP_RXBW);
+    printf("# sweep start_hz=%lu step_hz=%lu bins=%d rxbw=%02x settle_us=%u\n", (unsigned long)start_hz,
+        (unsigned long)SWEEP_STEP_HZ, bins, SWEEP_RXBW, SWEEP_SETTLE_US);
+
+    uint32_t sweep = 0;
+    uint32_t statsSweeps = 0;
+    uint32_t maxBin_us = 0;
+    uint32_t tStats = pinhal::micros32();
+
+    rfm69.retune(sweepFrf[0]);
+    uint32_t tRestart = pinhal::micros32();
+    uint32_t tPrevRead = tRestart;
+    while (true) {
+        printf("W %lu %lu ", (unsigned long)sweep, (unsigned long)to_ms_since_boot(get_absolute_time()));
+        for (int k = 0; k < bins; k++) {
+            while (int32_t(pinhal::micros32() - tRestart) < SWEEP_SETTLE_US) {}
+            uint8_t rssi = rfm69.readRSSIByte();
+            uint32_t tRead = pinhal::micros32();
+            rfm69.retune(sweepFrf[k + 1 < bins ? k + 1 : 0]);
+            tRestart = pinhal::micros32();
+
+            // Overlapped with the next bin settling
+            putHexByte(rssi);
+            if (tRead - tPrevRead > maxBin_us) { maxBin_us = tRead - tPrevRead; }
+            tPrevRead = tRead;
+        }
+        putchar_raw('\n');
+        sweep++;
+        statsSweeps++;
+
+        uint32_t now = pinhal::micros32();
+        if (now - tStats >= SWEEP_STATS_INTERVAL_US) {
+            float seconds = (now - tStats) / 1e6F;
+            float bin_us = (now - tStats) / float(statsSweeps * bins);
+            printf("# stats sweeps/s=%.1f bin_us=%.1f settle_us=%u overhead_us=%.1f max_bin_us=%lu\n",
+                statsSweeps / seconds, bin_us, SWEEP_SETTLE_US, bin_us - SWEEP_SETTLE_US, (unsigned long)maxBin_us);
+            statsSweeps = 0;
+            maxBin_us = 0;
+            tStats = pinhal::micros32();
+        }
+    }
+}
+
+static uint8_t streamSamples[RSSI_BLOCK_SAMPLES];
+static uint8_t streamBlock[RSSI_BLOCK_MAX_BYTES];
+static char streamLine[64 + 2 * RSSI_BLOCK_MAX_BYTES];
+
+// Output format, for host/rssi-stream:
+//   # stream poll_us=100 block=256
+//   R <block> <us since boot of the first sample> <samples> <rssicodec.h block in hex>
+//   G <us since boot> <samples>    that many samples from then on were not sent
+//   # stats samples/s=10000.0 sent/s=10000.0 chars/s=3912 ratio=5.11 gaps=0 max_late_us=31
+//
+// A block ends after RSSI_BLOCK_SAMPLES, or early when a poll came too late and samples were missed.
+// If the last line hasn't all gone out when the next block is ready, the serial link is not keeping up
+// and the block is dropped; either way the G line says so before the next block that is sent.
+// ratio is raw sample bytes to coded bytes, the hex on the line is twice that.
+static void runStream() {
+    printf("# stream poll_us=%u block=%u\n", STREAM_POLL_US, RSSI_BLOCK_SAMPLES);
+
+    RssiRiceCost cost;
+    int n = 0;
+    uint64_t tBlock = 0;
+    uint32_t seq = 0;
+    uint32_t lineLen = 0, linePos = 0;
+    uint64_t tGap = 0;
+    uint32_t missed = 0;
+    bool statsDue = false;
+
+    uint32_t statPolled = 0, statSent = 0, statCoded = 0, statChars = 0, statGaps = 0, statMaxLate_us = 0;
+    uint64_t tStats = time_us_64();
+
+    auto endBlock = [&]() {
+        if (!n) return;
+        if (linePos < lineLen) {
+            if (!missed) tGap = tBlock;
+            missed += n;
+        } else {
+            int len = 0;
+            if (missed) {
+                len = snprintf(streamLine, sizeof streamLine, "G %llu %lu\n", (unsigned long long)tGap, (unsigned long)missed);
+                missed = 0;
+                statGaps++;
+            }
+            uint32_t bytes = rssiEncodeBlock(streamSamples, n, cost, streamBlock);
+            len += snprintf(streamLine + len, sizeof streamLine - len, "R %lu %llu %d ", (unsigned long)seq, (unsigned long long)tBlock, n);
+            static const char hex[] = "0123456789abcdef";
+            for (uint32_t i = 0; i < bytes; i++) {
+                streamLine[len++] = hex[streamBlock[i] >> 4];
+                streamLine[len++] = hex[streamBlock[i] & 15];
+            }
+            streamLine[len++] = '\n';
+            lineLen = len;
+            linePos = 0;
+            statSent += n;
+            statCoded += bytes;
+        }
+        seq++;
+        n = 0;
+        cost.clear();
+    };
+
+    uint64_t tNext = time_us_64() + STREAM_POLL_US;
+    while (true) {
+        uint64_t now = time_us_64();
+        if (now >= tNext) {
+            // Whole periods late: those samples were never taken, so the block ends before them
+            uint32_t late = uint32_t((now - tNext) / STREAM_POLL_US);
+            if (now - tNext > statMaxLate_us) statMaxLate_us = uint32_t(now - tNext);
+            if (late) {
+                endBlock();
+                if (!missed) tGap = tNext;
+                missed += late;
+                tNext += uint64_t(late) * STREAM_POLL_US;
+            }
+            uint8_t rssi = rfm69.readRSSIByte();
+            statPolled++;
+            if (!n) tBlock = tNext;
+            else cost.add(streamSamples[n - 1], rssi);
+            streamSamples[n++] = rssi;
+            tNext += STREAM_POLL_US;
+            if (n == RSSI_BLOCK_SAMPLES) endBlock();
+        }
+
+        if (now - tStats >= STREAM_STATS_INTERVAL_US) statsDue = true;
+        if (statsDue && linePos == lineLen) {
+            float seconds = (now - tStats) / 1e6F;
+            lineLen = snprintf(streamLine, sizeof streamLine, "# stats samples/s=%.1f sent/s=%.1f chars/s=%.0f ratio=%.2f gaps=%lu max_late_us=%lu\n",
+                statPolled / seconds, statSent / seconds, statChars / seconds, statCoded ? float(statSent) / statCoded : 0.F,
+                (unsigned long)statGaps, (unsigned long)statMaxLate_us);
+            linePos = 0;
+            statsDue = false;
+            statPolled = statSent = statCoded = statChars = statGaps = statMaxLate_us = 0;
+            tStats = now;
+        }
+
+        // Overlapped with waiting for the next poll
+        while (linePos < lineLen && time_us_64() + STREAM_SEND_MARGIN_US < tNext) {
+            putchar_raw(streamLine[linePos++]);
+            statChars++;
+        }
+    }
+}
@@ -10,6 +10,7 @@
 // See ook-demod for a description of these common constants
 
 #include "../picopins.h"
+#include "../pinhal.h"
 
 #define RF_FREQUENCY_MHZ 433.92
 
@@ -18,6 +19,10 @@
 
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+// 1 to also print every pulse width while triggered, one per line, which is the trace format
+// host/drift-bench reads (see host/trace.h); everything else printed is skipped by it
+#define DUMP_WIDTHS 0
+
 struct shared_data_t {
     volatile uint32_t edgesCount;
     volatile uint32_t nextPulseLength_us;
@@ -30,15 +35,20 @@ static shared_data_t sharedData = {
     .now = 0,
 };
 
+// The hot path uses pinhal.h rather than arduino-compat, see apps/hal-bench for the difference
+void dio2InterruptHandler();
+typedef pinhal::OutputPin<LOGIC_TRIGGER> TriggerPin;
+typedef pinhal::EdgeIrq<RFM69_DIO2, dio2InterruptHandler> Dio2Irq;
+
+static Rfm69Common rfm69;
+
 int main() {
-    pinMode(LOGIC_TRIGGER, OUTPUT);
-    digitalWrite(LOGIC_TRIGGER, LOW);
+    TriggerPin::begin(LOW);
 
     stdio_init_all();
 
-    pinMode(RFM69_DIO2, INPUT_PULLDOWN);
+    pinhal::InputPin<RFM69_DIO2>::begin();
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
@@ -61,10 +71,9 @@ int main() {
 
     // Setup interrpts on DIO2
     // Because we are expecting manchester encoding, we want to trigger both rising and falling edges
-    extern void dio2InterruptHandler();
     sharedData.edgesCount = 0;
     sharedData.nextPulseLength_us = 0;
-    attachInterrupt(digitalPinToInterrupt(RFM69_DIO2), dio2InterruptHandler, CHANGE);
+    Dio2Irq::attach();
 
     while (true) {
       if (triggered) {
@@ -76,7 +85,7 @@ int main() {
         // For our case, valid pulses are either ~500uS or ~1msec wide, whether 1 or 0
         // This is a function of the 1024bps rate
         // Use this to try and more accurately count time in chirps, or at least, mask noise
-        auto since_us = micros() - now_us;
+        auto since_us = pinhal::micros32() - now_us;
         bool hadStopped = since_us > OREGON_CHIPRATE * 3;
         if (pulseLength_us > 0 || hadStopped) { // also detect extended no signal
           // these need to be wide enough to deal with intermittent latency
@@ -86,10 +95,15 @@ int main() {
           // If neither is a valid pulse, lower TRG so it shows on the PulseView output
           // gaps come after the interval that caused it...
           if (maybeShort || maybeLong) {
-              digitalWrite(LOGIC_TRIGGER, HIGH);
+              TriggerPin::high();
           } else {
-              digitalWrite(LOGIC_TRIGGER, LOW);
+              TriggerPin::low();
+          }
+#if DUMP_WIDTHS
+          if (pulseLength_us > 0) {
+              printf("%lu\n", (unsigned long)pulseLength_us);
           }
+#endif
           if (maybeShort) {
               shortPulses++;
           }
@@ -110,7 +124,7 @@ int main() {
         }
         if (!triggered && rssi <= triggerByte) {
             // trigger the Logic Analyser
-            digitalWrite(LOGIC_TRIGGER, HIGH);
+            TriggerPin::high();
             noInterrupts();
             sharedData.edgesCount = 0;
             sharedData.nextPulseLength_us = 0;
@@ -128,7 +142,7 @@ int main() {
                 sharedData.nextPulseLength_us = 0;
                 interrupts();
 
-                digitalWrite(LOGIC_TRIGGER, LOW);
+                TriggerPin::low();
                 triggered = false;
                 triggeringSamples = 0;
                 printf("\nTriggered at %.1fdB after %d seconds.\n", triggeredAtRssi / -2.F, n);            
@@ -150,13 +164,13 @@ int main() {
     return 0;
 }
 
-void dio2InterruptHandler() {
+void __not_in_flash_func(dio2InterruptHandler)() {
     static uint32_t prevTime_us = 0;
 
     // From the second and successive interrupt, sharedData.nextPulseLength_us will hold the time between successive interrupts
-    // and local prevTime_us will track what micros() was
+    // and local prevTime_us will track what the timer was
     // sharedData.nextPulseLength_us is cleared after being processed in the loop
-    auto now = micros();
+    auto now = pinhal::micros32();
     sharedData.now = now;
     sharedData.nextPulseLength_us = now - prevTime_us;
     prevTime_us = now;
@@ -0,0 +1,185 @@
+// Oregon decode from chips the SX1231 has already put in step, clocked in by PIO on its DCLK
+//
+// Between oregon-decode (the CPU times every DIO2 edge) and oregon-packet (the radio does the lot):
+// the SX1231 runs in continuous mode with its bit synchroniser on, so DIO2 is the data re-timed to the
+// recovered chip clock and DIO1 is that clock (DCLK). A PIO state machine samples DIO2 on each rising
+// edge of DCLK and shifts the chips into 32 bit words (dclksampler.pio), and DMA puts them in a ring.
+// Nothing is timed by the CPU, so interrupt latency and timestamp jitter don't come into it.
+// The loop wakes every DCLK_POLL_US and hands the new words to OregonChipStream (chipdecoder.h), which
+// finds the same sync word oregon-packet has the radio look for, at any chip offset, and decodes the block.
+//
+// DCLK has to be wired from DIO1 to RFM69_DIO1. Prints the same reading lines as oregon-decode,
+// every STATS_INTERVAL_S a line of counts and time awake, and 's' prints the per sensor table.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <pico/stdlib.h>
+#include <hardware/pio.h>
+#include <hardware/dma.h>
+#include <hardware/sync.h>
+#include "../rfm69common.h"
+#include "../oregon.h"
+#include "../chipdecoder.h"
+#include "../preamblegate.h"
+#include "../radiohealth.h"
+#include "../sensorstats.h"
+
+#include "../picopins.h"
+
+#include "dclksampler.pio.h"
+
+// See ook-demod for a description of these common constants
+
+#define RF_FREQUENCY_MHZ 433.92
+
+#define ONE_SECOND_US (1000 * 1000)
+#define OREGON_CHIPRATE (1024  * 2)
+
+// Sync word chips allowed to be wrong, as PACKET_SYNC_TOLERANCE in oregon-packet
+#define DCLK_SYNC_TOLERANCE 1
+// 64 words a second come in; 50ms is about 3 of them, and nothing waits on it but the RSSI of a reading
+#define DCLK_POLL_US (50 * 1000)
+// 4s of chips, a power of two for the DMA ring wrap
+#define DCLK_RING_WORDS 256
+
+#define STATS_INTERVAL_S 60
+
+static Rfm69Common rfm69;
+static OregonChipStream chipStream(DCLK_SYNC_TOLERANCE);
+static RadioHealth<Rfm69Common> health(rfm69);
+static SensorStats sensorStats;
+RAM_BUDGET_CHECK(SensorStats, RAM_BUDGET_SENSORSTATS);
+
+static uint32_t wordRing[DCLK_RING_WORDS] __attribute__((aligned(DCLK_RING_WORDS * sizeof(uint32_t))));
+static IntervalReader<DCLK_RING_WORDS> wordReader(wordRing);
+static_assert(sizeof(rfm69) + sizeof(chipStream) + sizeof(health) + sizeof(sensorStats) + sizeof(wordRing) + sizeof(wordReader)
+    <= RAM_BUDGET_PIPELINE, "oregon-dclk pipeline is over its RAM budget");
+
+static const PIO samplerPio = pio0;
+static int dmaChannel;
+
+static volatile bool pollTick = false;
+
+static bool pollTimerCallback(repeating_timer_t*) {
+    pollTick = true;
+    return true;
+}
+
+// Words the DMA has written so far, as in oregon-gate
+static inline uint32_t ringHead() {
+    return ~dma_channel_hw_addr(dmaChannel)->transfer_count;
+}
+
+static void startSampler() {
+    uint offset = pio_add_program(samplerPio, &dclk_sampler_program);
+    uint sm = pio_claim_unused_sm(samplerPio, true);
+
+    dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof wordRing));
+    channel_config_set_dreq(&c, pio_get_dreq(samplerPio, sm, false));
+    // At 64 words a second this runs out after two years
+    dma_channel_configure(dmaChannel, &c, wordRing, &samplerPio->rxf[sm], 0xffffffff, true);
+    dclk_sampler_program_init(samplerPio, sm, offset, RFM69_DIO2, RFM69_DIO1);
+}
+
+int main() {
+    stdio_init_all();
+
+    rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
+    rfm69.setBitSync(true);
+    rfm69.begin(RF_FREQUENCY_MHZ);
+
+    printf("Start DCLK decoding...\n");
+    startSampler();
+    wordReader.seek(ringHead());
+
+    repeating_timer_t pollTimer;
+    add_repeating_timer_us(-DCLK_POLL_US, pollTimerCallback, nullptr, &pollTimer);
+
+    absolute_time_t tNextSecond = delayed_by_us(get_absolute_time(), ONE_SECOND_US);
+    int n = 0;
+    uint32_t seconds = 0;
+    uint32_t frames = 0;
+    uint32_t readings = 0;
+    uint32_t wakeups = 0;
+    uint64_t awake_us = 0;
+    uint64_t lastAwake_us = 0;
+    uint8_t rssiByte = 0xff;
+    while (true) {
+        // Asleep until the poll timer (or, with USB stdio, its 1ms task)
+        while (!pollTick) {
+            __wfi();
+        }
+        pollTick = false;
+        wakeups++;
+        uint32_t t0 = time_us_32();
+
+        uint32_t head = ringHead();
+        uint32_t w;
+        while (wordReader.next(head, w)) {
+            uint8_t len;
+            const uint8_t* data = chipStream.word(w, len);
+            if (!data) continue;
+            uint16_t actualType;
+            uint8_t channel, rollingCode, hum;
+            int16_t temp;
+            bool battOK;
+            bool decoded = decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK);
+            if (checkedLength(data, len)) {
+                frames++;
+                sensorStats.frame(data, len, decoded, rssiByte, to_ms_since_boot(get_absolute_time()));
+            }
+            if (decoded) {
+                readings++;
+                printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB\n", n, actualType, channel, rollingCode, temp / 10.F, hum,
+                    battOK?"ok":"flat", rssiByte / -2.0F);
+            }
+            rssiByte = 0xff;
+        }
+        // The strongest RSSI while a block is coming in is the reading's
+        if (chipStream.collecting()) {
+            uint8_t r = rfm69.readRSSIByte();
+            if (r < rssiByte) rssiByte = r;
+        }
+
+        if (time_reached(tNextSecond)) {
+            tNextSecond = delayed_by_us(tNextSecond, ONE_SECOND_US);
+            seconds++;
+            n++;
+            uint32_t t1 = to_ms_since_boot(get_absolute_time());
+            printf((n % 2 == 0) ? "- %lu %.1f    \r" : "| %lu %.1f    \r", (unsigned long)seconds, rfm69.readRSSIByte() / -2.0F);
+
+            if (seconds % STATS_INTERVAL_S == 0) {
+                const auto& ss = chipStream.stats();
+                const auto& cs = chipStream.decoderStats();
+                // A word every 15.6ms means the DCLK is there; no words at all means it is not wired
+                printf("# dclk words=%lu syncs=%lu frames=%lu readings=%lu repaired=%lu mismatched=%lu lapped=%lu wakeups/s=%.1f awake=%.3f%%\n",
+                    (unsigned long)ss.words, (unsigned long)ss.syncs, (unsigned long)frames, (unsigned long)readings,
+                    (unsigned long)cs.repaired, (unsigned long)cs.mismatched, (unsigned long)wordReader.lappedCount(),
+                    double(wakeups) / seconds, 100.0 * (awake_us - lastAwake_us) / (STATS_INTERVAL_S * 1e6));
+                lastAwake_us = awake_us;
+            }
+
+            if (getchar_timeout_us(0) == 's') {
+                printf("\n");
+                sensorStats.dump(t1);
+            }
+
+            // The words come whether or not anything is on the air, so a sync is the sign of life
+            if (health.check(t1, chipStream.stats().syncs)) {
+                const auto& hs = health.stats();
+                printf("# health %s: detected after %lums; so far %lu resyncs, %lu full resets, %lu failed, %lu recovered in max %luus\n",
+                    health.causeName(health.lastFault()), (unsigned long)hs.lastDetect_ms,
+                    (unsigned long)hs.resyncs, (unsigned long)hs.fullResets, (unsigned long)hs.failed,
+                    (unsigned long)hs.recovered, (unsigned long)hs.recoverMax_us);
+            }
+        }
+
+        awake_us += time_us_32() - t0;
+    }
+    return 0;
+}
@@ -8,8 +8,18 @@
 #include "../rfm69common.h"
 #include "DecodeOOK.h"
 #include "OregonDecoderV2.h"
+#include "../oregon.h"
+#include "../oregonpll.h"
+#include "../radiohealth.h"
+#include "../collision.h"
+#include "../edgecapture.h"
+#include "../tracejournal.h"
+#include "../squelch.h"
+#include "../sensorstats.h"
+#include "../rtl433.h"
 
 #include "../picopins.h"
+#include "../pinhal.h"
 
 // See ook-demod for a description of these common constants
 
@@ -20,109 +30,187 @@
 
 #define ESTIMATED_TRIGGER_RSSI_DB -90
 
+// 1 to decode with OregonDecoderPLL (oregonpll.h), which locks onto each transmitter's own clock
+// instead of the fixed windows; see host/drift-bench for how the two compare
+#define OREGON_DECODER_PLL 0
+
+#if OREGON_DECODER_PLL
+typedef OregonDecoderPLL OregonDecoder;
+#else
+typedef OregonDecoderV2 OregonDecoder;
+#endif
+
+// 1 to keep the widths of each burst and, when two sensors' transmissions overlapped, get what can be
+// had out of them (collision.h); recovered readings get a trailing recovered=<how> field
+#define COLLISION_RECOVERY 1
+// While a burst is going, how often to sample RSSI for the collision check
+#define COLLISION_RSSI_INTERVAL_US 2000
+
+// 1 to keep the widths of failed decodes in a ring at the end of flash (tracejournal.h);
+// send 'J' over the USB serial to dump them, for host/journal-dump
+#define TRACE_JOURNAL 1
+#define JOURNAL_FLASH_BYTES (256 * 1024)
+// Bursts at least this long that nothing came out of are kept too; noise is much shorter
+#define JOURNAL_MIN_WIDTHS 120
+// Flash is only written once DIO2 has been quiet this long, since interrupts are off meanwhile (a sector
+// erase is tens of ms); longer than a pair, two frames of about 190ms and the 10ms between, so it never
+// lands between the two. With the gate off noise keeps DIO2 busy, and records wait staged until it is on again
+#define JOURNAL_QUIET_US 400000
+// Oregon's shortest pulse, half a bit at 1024Hz: the most edges a stall can have hidden is its length over this
+#define JOURNAL_EDGE_US 488
+
+// 1 to only take DIO2 interrupts while DIO0 says there is something on the air (squelch.h), instead of
+// paying for every noise edge; 'g' over the USB serial turns the gate off and on, to compare the two
+#define SQUELCH_GATE 1
+#define SQUELCH_THRESHOLD_DB ESTIMATED_TRIGGER_RSSI_DB
+// Longer than the 10ms between the two transmissions of a pair
+#define SQUELCH_HANG_MS 20
+
+// 1 to count, per sensor, readings, second copies, bad checksums and (from the learned period) cycles
+// missed, with an RSSI histogram (sensorstats.h); 's' over the USB serial prints the table
+#define SENSOR_STATS 1
+
+// 1 to print readings the way rtl_433 -F json does (rtl433.h), without the time, instead of the CSV
+// lines; host/ook-ingest --rtl433 gets the same from the CSV with the time added, so leave this 0 for that
+#define OUTPUT_RTL433_JSON 0
+
+#define KEEP_BURSTS (COLLISION_RECOVERY || TRACE_JOURNAL)
+
 struct shared_data_t {
     volatile uint32_t edgesCount;
-    volatile uint32_t nextPulseLength_us;
     volatile uint32_t now;
+    volatile uint32_t prevEdge_us;
 };
 
 static shared_data_t sharedData = {
     .edgesCount = 0,
-    .nextPulseLength_us = 0,
     .now = 0,
+    .prevEdge_us = 0,
 };
 
-int sum(uint8_t count, const byte* buffer) {
-    int s = 0;
- 
-    for(uint8_t i = 0; i < count; i++) {
-        s += (buffer[i]&0xF0) >> 4;
-        s += (buffer[i]&0xF);
-    }
- 
-    if(int(count) != count)
-        s += (buffer[count]&0xF0) >> 4;
- 
-    return s;
-}
+// Pulse widths from the ISR to the loop. A single slot was fine while the loop only ran the decoder, but a
+// collision resolve or a journal record takes a while, and widths arriving meanwhile would overwrite each other.
+// Widths rather than edge times (as in edgecapture.h) so the squelch's pre-roll can still move prevEdge_us
+static EdgeRing<EDGE_RING_SIZE> widthRing;
+RAM_BUDGET_CHECK(EdgeRing<EDGE_RING_SIZE>, RAM_BUDGET_CAPTURE);
 
-bool isSummOK(uint16_t sensorType, const byte* data, int len) {
-    uint8_t s1 = 0;
-    uint8_t s2 = 0;
-
-    switch (sensorType) {
-        case 0x1A2D:                                // THGR2228N
-            s1 = (sum(8, data) - 0xa) & 0xFF;
-            return (data[8] == s1);
-        case 0xEA4C:                                // TNHN132N
-            s1 = (sum(6, data) + (data[6]&0xF) - 0xa) & 0xff;
-            s2 = (s1 & 0xF0) >> 4;
-            s1 = (s1 & 0x0F) << 4;
-            return ((s1 == data[6]) && (s2 == data[7]));
-        default:
-            break;
-    }
-    return false;
+// The hot path uses pinhal.h rather than arduino-compat, see apps/hal-bench for the difference
+void dio2InterruptHandler();
+typedef pinhal::OutputPin<LOGIC_TRIGGER> TriggerPin;
+typedef pinhal::EdgeIrq<RFM69_DIO2, dio2InterruptHandler> Dio2Irq;
+#if SQUELCH_GATE
+void dio0InterruptHandler();
+typedef pinhal::EdgeIrq<RFM69_IRQ, dio0InterruptHandler, GPIO_IRQ_EDGE_RISE> Dio0Irq;
+#endif
+
+// Static rather than on the main stack; nothing in the pipeline is on the heap either, see rambudget.h
+static Rfm69Common rfm69;
+static OregonDecoder orscV2;
+static RadioHealth<Rfm69Common> health(rfm69);
+RAM_BUDGET_CHECK(OregonDecoder, RAM_BUDGET_DECODER);
+#if SQUELCH_GATE
+static Squelch<Rfm69Common, Dio2Irq, Dio0Irq, pinhal::InputPin<RFM69_DIO2>> squelch(rfm69);
+#endif
+#if SENSOR_STATS
+static SensorStats sensorStats;
+RAM_BUDGET_CHECK(SensorStats, RAM_BUDGET_SENSORSTATS);
+#endif
+#if KEEP_BURSTS
+static BurstRecorder burstRecorder;
+RAM_BUDGET_CHECK(BurstRecorder, RAM_BUDGET_BURST);
+#endif
+#if COLLISION_RECOVERY
+static CollisionResolver collisions;
+RAM_BUDGET_CHECK(CollisionResolver, RAM_BUDGET_COLLISION);
+#endif
+#if TRACE_JOURNAL
+static PicoFlash journalFlash(JOURNAL_FLASH_BYTES);
+static TraceJournal<PicoFlash> journal(journalFlash);
+static bool journalOk = false;
+RAM_BUDGET_CHECK(TraceJournal<PicoFlash>, RAM_BUDGET_JOURNAL);
+
+// One line per record, the record as it is in flash in hex; host/journal-dump reads these
+static void dumpJournal() {
+    printf("\n");
+    uint32_t count = journal.forEach([](const uint8_t* record, uint32_t bytes) {
+        printf("J ");
+        for (uint32_t i = 0; i < bytes; i++) printf("%02x", record[i]);
+        printf("\n");
+    });
+    printf("J end %lu\n", (unsigned long)count);
 }
+#endif
 
-bool decodeTempHumidity(const byte* data, int len, uint16_t& actualType, uint8_t& channel, uint8_t& rollingCode, int16_t& temp, uint8_t& hum, bool& battOK) {
-
-    bool is_summ_ok = false;
-    if (len >= 8) {
-        uint16_t Type = (data[0] << 8) | data[1];
-        is_summ_ok = isSummOK(Type, data, len);
-        if (is_summ_ok) {
-            int16_t t = data[5] >> 4;                   // 1st decimal digit
-            t *= 10;
-            t += data[5] & 0x0F;                        // 2nd decimal digit
-            t *= 10;
-            t += data[4] >> 4;                          // 3rd decimal digit
-            if (data[6] & 0x08) t *= -1;
-            temp = t;
-            hum = 0;
-            battOK = !(data[4] & 0x0C);
-            // 1a2D shows as 1d20 in Pulseview... for the exact same data...
-            if (Type == 0x1A2D) {                       // THGR228N, THGN123N, THGR122NX, THGN123N
-                hum  = data[7] & 0xF;
-                hum *= 10;
-                hum += data[6] >> 4;
-            }
-            channel = data[2] >> 4;
-            rollingCode = 
-                         ((data[3] & 0xf) << 4) |     // 2
-                         ((data[3] >> 4));            // 7
-
-            actualType = (uint16_t(data[0] >> 4) << 12) |     // 1
-                         (uint16_t(data[1] & 0xf) << 8) |     // d
-                         (uint16_t(data[1] >> 4) << 4)  |     // 2
-                         (uint16_t(data[2]) & 0xf);           // 0
-        }
+// All of the above together, whatever is switched on
+static_assert(sizeof(widthRing) + sizeof(rfm69) + sizeof(orscV2) + sizeof(health)
+#if SQUELCH_GATE
+    + sizeof(squelch)
+#endif
+#if SENSOR_STATS
+    + sizeof(sensorStats)
+#endif
+#if KEEP_BURSTS
+    + sizeof(burstRecorder)
+#endif
+#if COLLISION_RECOVERY
+    + sizeof(collisions)
+#endif
+#if TRACE_JOURNAL
+    + sizeof(journal)
+#endif
+    <= RAM_BUDGET_PIPELINE, "oregon-decode pipeline is over its RAM budget");
+
+// "12,1d20,1,27,14.5,75,Batt=ok,-80.5dB" (host/readingparser.h), with ",recovered=<how>" if collision.h got it
+static void printReading(int n, uint16_t type, uint8_t channel, uint8_t rollingCode, int16_t temp, uint8_t hum, bool battOK,
+                         float rssi, const char* recovered) {
+#if OUTPUT_RTL433_JSON
+    char json[192];
+    if (rtl433Json(json, sizeof json, nullptr, type, channel, rollingCode, temp, hum, battOK)) {
+        printf("%s\n", json);
     }
-    return is_summ_ok;
+    (void)n; (void)rssi; (void)recovered;
+#else
+    printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB", n, type, channel, rollingCode, temp / 10.F, hum, battOK?"ok":"flat", rssi);
+    if (recovered) printf(",recovered=%s", recovered);
+    printf("\n");
+#endif
 }
 
 int main() {
-    pinMode(LOGIC_TRIGGER, OUTPUT);
-    digitalWrite(LOGIC_TRIGGER, LOW);
+    TriggerPin::begin(LOW);
 
     stdio_init_all();
 
-    pinMode(RFM69_DIO2, INPUT_PULLDOWN);
+    pinhal::InputPin<RFM69_DIO2>::begin();
 
-    Rfm69Common rfm69;
     rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
     rfm69.begin(RF_FREQUENCY_MHZ);
 
+#if TRACE_JOURNAL
+    journalOk = journalFlash.fits();
+    if (journalOk) {
+        printf("# journal %lu records in flash\n", (unsigned long)journal.begin());
+    } else {
+        printf("# journal off, the program reaches into the last %dkB of flash\n", JOURNAL_FLASH_BYTES / 1024);
+    }
+#endif
+
     printf("Start decoding...\n");
-    OregonDecoderV2 orscV2;
     extern void reportSerial (const char* s, class DecodeOOK& decoder);
 
     // Setup interrupts on DIO2
     // Because we are expecting manchester encoding, we want to trigger both rising and falling edges
-    extern void dio2InterruptHandler();
     sharedData.edgesCount = 0;
-    sharedData.nextPulseLength_us = 0;
-    attachInterrupt(digitalPinToInterrupt(RFM69_DIO2), dio2InterruptHandler, CHANGE);
+    Dio2Irq::attach();
+#if SQUELCH_GATE
+    pinhal::InputPin<RFM69_IRQ>::begin();
+    Dio0Irq::attach();
+    squelch.config().threshold = uint8_t(-2 * SQUELCH_THRESHOLD_DB);
+    squelch.config().hang_ms = SQUELCH_HANG_MS;
+    squelch.begin(true);
+    // A full reset clears RssiIrq under an open gate; close it and arm DIO0 again
+    health.onFullReset([] { squelch.radioReset(); });
+#endif
 
     absolute_time_t tNow = get_absolute_time();
     absolute_time_t tNextSecond = delayed_by_us(tNow, ONE_SECOND_US);
@@ -137,17 +225,41 @@ int main() {
     bool latchPreamble = false;
     bool preambleValue = false;
     bool needToPrint = false;
-    float rssi;
+    float rssi = 0;
+    uint32_t readings = 0;
+#if KEEP_BURSTS
+    uint32_t lastRssiSample_us = 0;
+    bool checksumFailed = false;
+#endif
+#if COLLISION_RECOVERY
+    uint32_t resolveMax_us = 0;
+#endif
+#if SQUELCH_GATE
+    uint32_t closingPulse_us = 0;
+#endif
+#if TRACE_JOURNAL
+    uint32_t stallsHit = 0;
+    uint32_t lostEdgesMax = 0;
+#endif
     while (true) {
-        noInterrupts();
-        auto pulseLength_us = sharedData.nextPulseLength_us;
-        sharedData.nextPulseLength_us = 0;
-        auto now_us = sharedData.now;
-        interrupts();
+        uint32_t pulseLength_us = 0;
+        widthRing.pop(pulseLength_us);
+#if SQUELCH_GATE
+        // Closing the gate ends the last pulse, otherwise the frame in it would only come out at the next open.
+        // DIO2 is off by then, so nothing comes after it; it goes to the decoder once the ring is empty
+        if (squelch.poll(time_us_32())) {
+            closingPulse_us = time_us_32() - sharedData.prevEdge_us;
+        }
+        if (pulseLength_us == 0 && closingPulse_us != 0) {
+            pulseLength_us = closingPulse_us;
+            closingPulse_us = 0;
+        }
+#endif
         if (pulseLength_us != 0) {
             bool decoded = false;
             if (orscV2.nextPulse(pulseLength_us)) {
-                rssi = rfm69.readRSSIByte() / -2.0F; // even though this is just after the message it seems to be pretty right
+                uint8_t rssiByte = rfm69.readRSSIByte();
+                rssi = rssiByte / -2.0F; // even though this is just after the message it seems to be pretty right
                 printf("%d ", n);
                 reportSerial("OSV2", orscV2);
                 uint8_t len;
@@ -156,14 +268,91 @@ int main() {
                     // Rolling code is BCD...
                     if (decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK)) {
                         decoded = true;
+#if COLLISION_RECOVERY
+                        collisions.decoded(data, len, to_ms_since_boot(get_absolute_time()));
+#endif
+#if KEEP_BURSTS
+                        burstRecorder.frameDecoded();
+#endif
+                    }
+#if KEEP_BURSTS
+                    else {
+                        checksumFailed = true;
                     }
+#endif
+#if SENSOR_STATS
+                    sensorStats.frame(data, len, decoded, rssiByte, to_ms_since_boot(get_absolute_time()));
+#endif
                 }
                 orscV2.resetDecoder();
             }
             if (decoded) {
-                printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB\n", n, actualType, channel, rollingCode, temp / 10.F, hum, battOK?"ok":"flat", rssi);
+                readings++;
+                printReading(n, actualType, channel, rollingCode, temp, hum, battOK, rssi, nullptr);
+#if OREGON_DECODER_PLL
+                printf("# pll chip_us=%.1f asym_us=%+.1f\n", orscV2.chipPeriod_us(), orscV2.asymmetry_us());
+#endif
+            }
+#if KEEP_BURSTS
+            // After the decoder, so a frame it just finished counts in the burst it ends
+            uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+            if (burstRecorder.width(pulseLength_us, now_ms)) {
+                const Burst& burst = burstRecorder.burst();
+                int nfound = 0;
+#if COLLISION_RECOVERY
+                RecoveredFrame found[2];
+                uint32_t resolveStart_us = time_us_32();
+                nfound = collisions.resolve(burst, now_ms, found, 2);
+                uint32_t resolve_us = time_us_32() - resolveStart_us;
+                if (resolve_us > resolveMax_us) resolveMax_us = resolve_us;
+                for (int i = 0; i < nfound; i++) {
+                    if (decodeTempHumidity(found[i].data, found[i].len, actualType, channel, rollingCode, temp, hum, battOK)) {
+                        readings++;
+#if SENSOR_STATS
+                        sensorStats.frame(found[i].data, found[i].len, true, burst.rssiStrongest, now_ms);
+#endif
+                        // This burst's RSSI, not the last direct decode's
+                        printReading(n, actualType, channel, rollingCode, temp, hum, battOK, burst.rssiStrongest / -2.0F,
+                            recoveryName(found[i].how));
+                    }
+                }
+#endif
+#if TRACE_JOURNAL
+                if (journalOk && !burst.decoded && !nfound && (checksumFailed || burst.count >= JOURNAL_MIN_WIDTHS)) {
+                    journal.add(checksumFailed ? JOURNAL_CHECKSUM : JOURNAL_NO_FRAME, burst.rssiStrongest, now_ms,
+                        burst.widths, burst.count);
+                }
+#endif
+                checksumFailed = false;
+                (void)nfound;
+            }
+#endif
+        }
+
+#if KEEP_BURSTS
+        // A second transmitter coming or going shows as a step in RSSI
+        if (burstRecorder.inBurst() && time_us_32() - lastRssiSample_us >= COLLISION_RSSI_INTERVAL_US) {
+            lastRssiSample_us = time_us_32();
+            burstRecorder.rssi(rfm69.readRSSIByte());
+        }
+#endif
+#if TRACE_JOURNAL
+        // A page at a time, or one sector erase, and only while nothing is coming in on DIO2
+        bool journalQuiet = time_us_32() - sharedData.now >= JOURNAL_QUIET_US;
+#if SQUELCH_GATE
+        journalQuiet = journalQuiet && !squelch.open();
+#endif
+        if (journal.busy() && journalQuiet) {
+            uint32_t edgesBefore = sharedData.edgesCount;
+            uint32_t stallStart_us = time_us_32();
+            journal.service();
+            // An edge during the stall is latched and taken as interrupts come back on; any before it are gone
+            if (sharedData.edgesCount != edgesBefore) {
+                stallsHit++;
+                lostEdgesMax += (time_us_32() - stallStart_us) / JOURNAL_EDGE_US;
             }
         }
+#endif
 
         if (time_reached(tNextSecond)) {
             auto t1 = to_ms_since_boot(get_absolute_time());
@@ -175,24 +364,108 @@ int main() {
             sleep_ms(1);
 #endif
             n++;
+
+#if SQUELCH_GATE
+            squelch.second(sharedData.edgesCount, readings);
+            if (n % 60 == 0) {
+                const auto& ss = squelch.stats();
+                printf("# squelch gate=%s opens=%lu prerolls=%lu open_ms=%lu longest_ms=%lu",
+                    squelch.gated() ? "on" : "off", (unsigned long)ss.opens, (unsigned long)ss.prerolls,
+                    (unsigned long)ss.open_ms, (unsigned long)ss.longestOpen_ms);
+                // ISR load as interrupts per second, and yield, for each setting of the gate
+                for (int g = 1; g >= 0; g--) {
+                    const auto& m = ss.mode[g];
+                    if (!m.seconds) continue;
+                    printf(" %s: edges/s=%.1f readings/h=%.1f over %lus", g ? "on" : "off", double(m.edges) / m.seconds,
+                        m.readings * 3600.0 / m.seconds, (unsigned long)m.seconds);
+                }
+                printf("\n");
+            }
+#endif
+
+#if COLLISION_RECOVERY
+            if (n % 60 == 0) {
+                const auto& cs = collisions.stats();
+                // The widths that came in during the longest resolve waited in the ring; lost ones didn't fit
+                printf("# collision bursts=%lu collisions=%lu redecoded=%lu rebuilt=%lu filled=%lu unresolved=%lu resolve_max_us=%lu lost_widths=%lu\n",
+                    (unsigned long)cs.bursts, (unsigned long)cs.collisions, (unsigned long)cs.redecoded,
+                    (unsigned long)cs.rebuilt, (unsigned long)cs.filled, (unsigned long)cs.unresolved,
+                    (unsigned long)resolveMax_us, (unsigned long)widthRing.overflowCount());
+            }
+#endif
+
+#if TRACE_JOURNAL
+            if (n % 60 == 0 && journalOk) {
+                const auto& js = journal.stats();
+                // Edges lost is an upper bound: stalls an edge came in during, at one edge per half bit
+                printf("# journal records=%lu dropped=%lu truncated=%lu pages=%lu erases=%lu program_max_us=%lu erase_max_us=%lu record_max_us=%lu stall_ms=%lu stalls_hit=%lu lost_edges_max=%lu\n",
+                    (unsigned long)js.records, (unsigned long)js.dropped, (unsigned long)js.truncated,
+                    (unsigned long)js.pages, (unsigned long)js.erases, (unsigned long)js.programMax_us,
+                    (unsigned long)js.eraseMax_us, (unsigned long)js.recordMax_us, (unsigned long)(js.stallTotal_us / 1000),
+                    (unsigned long)stallsHit, (unsigned long)lostEdgesMax);
+            }
+#endif
+
+            // 'J' on the USB serial dumps the journal, 'g' turns the squelch gate off and on, 's' prints the sensor table
+            int command = getchar_timeout_us(0);
+#if TRACE_JOURNAL
+            if (journalOk && command == 'J') {
+                dumpJournal();
+            }
+#endif
+#if SQUELCH_GATE
+            if (command == 'g') {
+                squelch.setGate(!squelch.gated());
+                printf("# squelch gate %s\n", squelch.gated() ? "on" : "off");
+            }
+#endif
+#if SENSOR_STATS
+            if (command == 's') {
+                printf("\n");
+                sensorStats.dump(t1);
+            }
+#endif
+            (void)command;
+
+            // With the gate on DIO2 is only heard while something is on the air, so the gate opening counts
+            // as activity too; sensors above the threshold still come round well inside the stall time
+            uint32_t activity = sharedData.edgesCount;
+#if SQUELCH_GATE
+            activity += squelch.stats().opens;
+#endif
+            // Once a second is plenty; a wedged radio is found within a few seconds, and it costs three SPI reads
+            if (health.check(t1, activity)) {
+                const auto& hs = health.stats();
+                printf("# health %s: detected after %lums; so far %lu resyncs, %lu full resets, %lu failed, %lu recovered in max %luus\n",
+                    health.causeName(health.lastFault()), (unsigned long)hs.lastDetect_ms,
+                    (unsigned long)hs.resyncs, (unsigned long)hs.fullResets, (unsigned long)hs.failed,
+                    (unsigned long)hs.recovered, (unsigned long)hs.recoverMax_us);
+            }
         }
     }
     return 0;
 }
 
-void dio2InterruptHandler() {
-    static uint32_t prevTime_us = 0;
-
-    // From the second and successive interrupt, sharedData.nextPulseLength_us will hold the time between successive interrupts
-    // and local prevTime_us will track what micros() was
-    // sharedData.nextPulseLength_us is cleared after being processed in the loop
-    auto now = micros();
+void __not_in_flash_func(dio2InterruptHandler)() {
+    // From the second and successive interrupt, each width pushed is the time between successive interrupts
+    // and sharedData.prevEdge_us tracks what the timer was (the squelch can move it back, for the pre-roll)
+    // The DIO0 ISR is on the same IRQ and never pushes, so the ring keeps its single producer
+    auto now = pinhal::micros32();
     sharedData.now = now;
-    sharedData.nextPulseLength_us = now - prevTime_us;
-    prevTime_us = now;
+    widthRing.push(now - sharedData.prevEdge_us);
+    sharedData.prevEdge_us = now;
     sharedData.edgesCount++;
 }
 
+#if SQUELCH_GATE
+void __not_in_flash_func(dio0InterruptHandler)() {
+    uint32_t prev = squelch.opened(pinhal::micros32());
+    if (prev) {
+        sharedData.prevEdge_us = prev;
+    }
+}
+#endif
+
 void reportSerial (const char* s, class DecodeOOK& decoder) {
     byte pos;
     const byte* data = decoder.getData(pos);
@@ -0,0 +1,225 @@
+// Oregon decode that only wakes the CPU when PIO has seen something that looks like a preamble
+//
+// oregon-decode runs the decoder from an interrupt on every DIO2 edge, and most of those edges
+// are noise between transmissions. Here PIO does the watching (see oregongate.pio and
+// preamblegate.h): one state machine times every pulse into a DMA ring, with no CPU at all,
+// and another counts preamble length pulses and raises an IRQ after PREAMBLE_PULSES in a row.
+// The CPU then decodes from the ring, starting from before the trigger so nothing is lost.
+//
+// Prints the same lines as oregon-decode, and every STATS_INTERVAL_S a line comparing the
+// decode wakeups against the edges (which is how many interrupts oregon-decode would have taken).
+// With GATE_COMPARE 1 a second decoder also runs over every width in the ring, which is what
+// oregon-decode does, so frames the gate missed show up as a count.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <pico/stdlib.h>
+#include <hardware/pio.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include "../rfm69common.h"
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../oregon.h"
+#include "../preamblegate.h"
+
+#include "../picopins.h"
+
+#include "oregongate.pio.h"
+
+// See ook-demod for a description of these common constants
+
+#define RF_FREQUENCY_MHZ 433.92
+
+#define ONE_SECOND_US (1000 * 1000)
+#define OREGON_CHIPRATE (1024  * 2)
+
+#define ESTIMATED_TRIGGER_RSSI_DB -90
+
+// Run the ungated decoder alongside, to count what the gate misses. Costs the CPU time the gate saves.
+#define GATE_COMPARE 1
+// While decoding after a trigger, how often to look at the ring
+#define GATE_POLL_US 2000
+#define STATS_INTERVAL_S 60
+
+static_assert(oregon_preamble_MIN_TICKS == PREAMBLE_MIN_TICKS, "oregongate.pio and preamblegate.h disagree");
+static_assert(oregon_preamble_SPAN_TICKS == PREAMBLE_SPAN_TICKS, "oregongate.pio and preamblegate.h disagree");
+
+static Rfm69Common rfm69;
+static OregonDecoderV2 orscV2;
+RAM_BUDGET_CHECK(OregonDecoderV2, RAM_BUDGET_DECODER);
+
+// The DMA ring wrap needs the buffer aligned to its size
+static uint32_t widthRing[GATE_RING_SIZE] __attribute__((aligned(GATE_RING_SIZE * sizeof(uint32_t))));
+typedef GatedDecode<OregonDecoderV2, GATE_RING_SIZE> Gate;
+static Gate gate(orscV2, widthRing);
+
+#if GATE_COMPARE
+static OregonDecoderV2 orscUngated;
+static IntervalReader<GATE_RING_SIZE> ungatedReader(widthRing);
+#endif
+static_assert(sizeof(rfm69) + sizeof(widthRing) + sizeof(gate)
+#if GATE_COMPARE
+    + sizeof(orscUngated) + sizeof(ungatedReader)
+#endif
+    <= RAM_BUDGET_PIPELINE, "oregon-gate pipeline is over its RAM budget");
+
+static const PIO gatePio = pio0;
+static uint edgeTimerSm;
+static uint preambleSm;
+static int dmaChannel;
+
+static volatile bool triggered = false;
+static volatile bool secondTick = false;
+
+static void __not_in_flash_func(preambleIrqHandler)() {
+    // The state machine stays in irq wait until we clear the flag, so mask it here and clear it when re-arming
+    pio_set_irq0_source_enabled(gatePio, pis_interrupt0, false);
+    triggered = true;
+}
+
+static bool secondTimerCallback(repeating_timer_t*) {
+    secondTick = true;
+    return true;
+}
+
+// Widths the DMA has written so far: the transfer count started at 0xffffffff and counts down
+static inline uint32_t ringHead() {
+    return ~dma_channel_hw_addr(dmaChannel)->transfer_count;
+}
+
+static void rearm() {
+    pio_interrupt_clear(gatePio, 0);
+    pio_set_irq0_source_enabled(gatePio, pis_interrupt0, true);
+}
+
+static void startGate() {
+    uint offset = pio_add_program(gatePio, &edge_timer_program);
+    edgeTimerSm = pio_claim_unused_sm(gatePio, true);
+
+    dmaChannel = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dmaChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    // Wrap the write address at the ring size (given as log2 of the size in bytes)
+    channel_config_set_ring(&c, true, __builtin_ctz(sizeof widthRing));
+    channel_config_set_dreq(&c, pio_get_dreq(gatePio, edgeTimerSm, false));
+    // Never finishes, as far as we are concerned (that many edges is weeks of noise)
+    dma_channel_configure(dmaChannel, &c, widthRing, &gatePio->rxf[edgeTimerSm], 0xffffffff, true);
+    edge_timer_program_init(gatePio, edgeTimerSm, offset, RFM69_DIO2);
+
+    offset = pio_add_program(gatePio, &oregon_preamble_program);
+    preambleSm = pio_claim_unused_sm(gatePio, true);
+    irq_set_exclusive_handler(PIO0_IRQ_0, preambleIrqHandler);
+    irq_set_enabled(PIO0_IRQ_0, true);
+    oregon_preamble_program_init(gatePio, preambleSm, offset, RFM69_DIO2, PREAMBLE_PULSES, PREAMBLE_TICK_US);
+    rearm();
+}
+
+// true if it was a reading
+static bool reportFrame(int n, uint8_t len, const uint8_t* data, bool print) {
+    uint16_t actualType;
+    uint8_t channel, rollingCode, hum;
+    int16_t temp;
+    bool battOK;
+    if (!data || !decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK)) {
+        return false;
+    }
+    if (print) {
+        float rssi = rfm69.readRSSIByte() / -2.0F;
+        printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB\n", n, actualType, channel, rollingCode, temp / 10.F, hum, battOK?"ok":"flat", rssi);
+    }
+    return true;
+}
+
+int main() {
+    stdio_init_all();
+
+    rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
+    rfm69.begin(RF_FREQUENCY_MHZ);
+
+    printf("Start gated decoding...\n");
+    startGate();
+
+    repeating_timer_t secondTimer;
+    add_repeating_timer_us(-ONE_SECOND_US, secondTimerCallback, nullptr, &secondTimer);
+
+    int n = 0;
+    uint32_t seconds = 0;
+    uint32_t lastEdges = 0;
+    uint32_t wakeups = 0;
+    uint32_t decodeTime_us = 0;
+#if GATE_COMPARE
+    uint32_t ungatedFrames = 0;
+    uint32_t gatedFrames = 0;
+#endif
+    while (true) {
+        // Asleep until the preamble IRQ or the one second timer (or, with USB stdio, its 1ms task)
+        while (!triggered && !secondTick) {
+            __wfi();
+        }
+
+        if (triggered) {
+            triggered = false;
+            wakeups++;
+            uint32_t t0 = time_us_32();
+            gate.trigger(ringHead(), t0);
+            Gate::Result r;
+            do {
+                sleep_us(GATE_POLL_US);
+                r = gate.poll(ringHead(), time_us_32());
+            } while (r == Gate::BUSY);
+            if (r == Gate::FRAME) {
+                uint8_t len;
+                const uint8_t* data = orscV2.getData(len);
+                if (reportFrame(n, len, data, true)) {
+#if GATE_COMPARE
+                    gatedFrames++;
+#endif
+                }
+                orscV2.resetDecoder();
+            }
+            rearm();
+            decodeTime_us += time_us_32() - t0;
+        }
+
+#if GATE_COMPARE
+        // What oregon-decode would have made of the same edges
+        uint32_t width_us;
+        uint32_t head = ringHead();
+        while (ungatedReader.next(head, width_us)) {
+            if (orscUngated.nextPulse(width_us)) {
+                uint8_t len;
+                const uint8_t* data = orscUngated.getData(len);
+                if (reportFrame(n, len, data, false)) ungatedFrames++;
+                orscUngated.resetDecoder();
+            }
+        }
+#endif
+
+        if (secondTick) {
+            secondTick = false;
+            seconds++;
+            n++;
+            printf((n % 2 == 0) ? "- %lu %.1f    \r" : "| %lu %.1f    \r", (unsigned long)seconds, rfm69.readRSSIByte() / -2.0F);
+            if (seconds % STATS_INTERVAL_S == 0) {
+                uint32_t edges = ringHead();
+                const auto& gs = gate.stats();
+                double hours = seconds / 3600.0;
+                printf("# gate wakeups=%lu (%.0f/h) frames=%lu no_frame=%lu decode_ms=%lu edges=%lu (%.0f/h, %lu in the last %ds) lapped=%lu\n",
+                    (unsigned long)wakeups, wakeups / hours, (unsigned long)gs.frames, (unsigned long)gs.noFrame,
+                    (unsigned long)(decodeTime_us / 1000), (unsigned long)edges, edges / hours,
+                    (unsigned long)(edges - lastEdges), STATS_INTERVAL_S, (unsigned long)gate.lappedCount());
+#if GATE_COMPARE
+                printf("# ungated frames=%lu gated=%lu missed=%.1f%% lapped=%lu\n", (unsigned long)ungatedFrames,
+                    (unsigned long)gatedFrames, gatedFrames < ungatedFrames ? 100.0 * (ungatedFrames - gatedFrames) / ungatedFrames : 0.0,
+                    (unsigned long)ungatedReader.lappedCount());
+#endif
+                lastEdges = edges;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+// Oregon decode with the SX1231 in packet mode, so the radio does the chip timing instead of the CPU
+//
+// oregon-decode times every DIO2 edge itself, an interrupt each, noise included. Here the radio's bit
+// synchroniser clocks the Manchester chips in as bits at OREGON_CHIPRATE, matches the end of the
+// preamble and the sync nibble as its sync word, and fills the FIFO with a fixed block of chips.
+// DIO0 is PayloadReady, so there is one interrupt per transmission; the loop reads the block and
+// chipdecoder.h turns it into the same bytes OregonDecoderV2 would have (see there for the layout).
+//
+// The CPU sleeps in between. Every STATS_INTERVAL_S a line gives the interrupts and the time spent awake,
+// to compare against oregon-decode's edges per second, and 's' prints the per sensor table for the yield.
+// host/yield-bench runs the same decoder behind a model of the radio, next to the edge timing decoders.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <pico/stdlib.h>
+#include <hardware/sync.h>
+#include "../rfm69common.h"
+#include "../oregon.h"
+#include "../chipdecoder.h"
+#include "../radiohealth.h"
+#include "../sensorstats.h"
+
+#include "../picopins.h"
+#include "../pinhal.h"
+
+// See ook-demod for a description of these common constants
+
+#define RF_FREQUENCY_MHZ 433.92
+
+#define ONE_SECOND_US (1000 * 1000)
+#define OREGON_CHIPRATE (1024  * 2)
+
+// The sync search only starts above this, so it is the squelch too
+#define ESTIMATED_TRIGGER_RSSI_DB -90
+
+// Chips of the sync word allowed to be wrong (up to 7); the preamble alone is 4 chips off it, so 1 can't match early
+#define PACKET_SYNC_TOLERANCE 1
+// After RSSI goes over the threshold, how long until the receiver is restarted if no block came, in 16 chips:
+// 32 is 250ms, longer than the preamble, sync and block
+#define PACKET_RX_TIMEOUT 32
+// How often the loop looks for that timeout (a register read)
+#define PACKET_TIMEOUT_POLL_US (50 * 1000)
+
+#define STATS_INTERVAL_S 60
+
+void dio0InterruptHandler();
+typedef pinhal::EdgeIrq<RFM69_IRQ, dio0InterruptHandler, GPIO_IRQ_EDGE_RISE> Dio0Irq;
+
+static Rfm69Common rfm69;
+static OregonChipDecoder chipDecoder;
+static RadioHealth<Rfm69Common> health(rfm69);
+static SensorStats sensorStats;
+RAM_BUDGET_CHECK(SensorStats, RAM_BUDGET_SENSORSTATS);
+static_assert(sizeof(rfm69) + sizeof(chipDecoder) + sizeof(health) + sizeof(sensorStats) <= RAM_BUDGET_PIPELINE,
+    "oregon-packet pipeline is over its RAM budget");
+
+static volatile bool payloadReady = false;
+static volatile uint32_t payloadIrqs = 0;
+static volatile bool pollTick = false;
+
+static bool pollTimerCallback(repeating_timer_t*) {
+    pollTick = true;
+    return true;
+}
+
+int main() {
+    stdio_init_all();
+
+    pinhal::InputPin<RFM69_IRQ>::begin();
+
+    rfm69.setPins(RFM69_MISO, RFM69_MOSI, RFM69_SCK, RFM69_CS, RFM69_IRQ, RFM69_RST);
+    rfm69.setPacketMode(OREGON_SYNC_CHIPS, OREGON_SYNC_BYTES, PACKET_SYNC_TOLERANCE, OREGON_BLOCK_BYTES, PACKET_RX_TIMEOUT);
+    rfm69.begin(RF_FREQUENCY_MHZ);
+    rfm69.setRssiThreshold(uint8_t(-2 * ESTIMATED_TRIGGER_RSSI_DB));
+    rfm69.restartRx();
+
+    printf("Start packet mode decoding...\n");
+    Dio0Irq::attach();
+    // The reset pulse empties the FIFO and drops DIO0; arm the interrupt again, no block is waiting
+    health.onFullReset([] {
+        payloadReady = false;
+        Dio0Irq::enable(true);
+    });
+
+    repeating_timer_t pollTimer;
+    add_repeating_timer_us(-PACKET_TIMEOUT_POLL_US, pollTimerCallback, nullptr, &pollTimer);
+
+    absolute_time_t tNextSecond = delayed_by_us(get_absolute_time(), ONE_SECOND_US);
+    int n = 0;
+    uint32_t seconds = 0;
+    uint32_t blocks = 0;
+    uint32_t frames = 0;
+    uint32_t readings = 0;
+    uint32_t timeouts = 0;
+    uint64_t awake_us = 0;
+    uint32_t lastIrqs = 0;
+    uint64_t lastAwake_us = 0;
+    while (true) {
+        // Asleep until PayloadReady or the poll timer (or, with USB stdio, its 1ms task)
+        while (!payloadReady && !pollTick) {
+            __wfi();
+        }
+        uint32_t t0 = time_us_32();
+
+        if (payloadReady) {
+            payloadReady = false;
+            blocks++;
+            // While the receiver is still on this transmission; it restarts once the FIFO is empty
+            uint8_t rssiByte = rfm69.readRSSIByte();
+            uint8_t block[OREGON_BLOCK_BYTES];
+            rfm69.readFifo(block, sizeof block);
+            uint8_t len;
+            const uint8_t* data = chipDecoder.decode(block, sizeof block, len);
+            uint16_t actualType;
+            uint8_t channel, rollingCode, hum;
+            int16_t temp;
+            bool battOK;
+            bool decoded = decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK);
+            if (checkedLength(data, len)) {
+                frames++;
+                sensorStats.frame(data, len, decoded, rssiByte, to_ms_since_boot(get_absolute_time()));
+            }
+            if (decoded) {
+                readings++;
+                printf("%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB\n", n, actualType, channel, rollingCode, temp / 10.F, hum,
+                    battOK?"ok":"flat", rssiByte / -2.0F);
+            }
+        }
+
+        if (pollTick) {
+            pollTick = false;
+            if (rfm69.timedOut()) timeouts++;
+        }
+
+        if (time_reached(tNextSecond)) {
+            tNextSecond = delayed_by_us(tNextSecond, ONE_SECOND_US);
+            seconds++;
+            n++;
+            uint32_t t1 = to_ms_since_boot(get_absolute_time());
+            printf((n % 2 == 0) ? "- %lu %.1f    \r" : "| %lu %.1f    \r", (unsigned long)seconds, rfm69.readRSSIByte() / -2.0F);
+
+            if (seconds % STATS_INTERVAL_S == 0) {
+                const auto& cs = chipDecoder.stats();
+                uint32_t irqs = payloadIrqs;
+                // Interrupts per second against oregon-decode's edges/s; awake includes the printing
+                printf("# packet blocks=%lu frames=%lu readings=%lu timeouts=%lu repaired=%lu mismatched=%lu short=%lu irq/s=%.2f awake=%.3f%%\n",
+                    (unsigned long)blocks, (unsigned long)frames, (unsigned long)readings, (unsigned long)timeouts,
+                    (unsigned long)cs.repaired, (unsigned long)cs.mismatched, (unsigned long)cs.shortFrames,
+                    double(irqs - lastIrqs) / STATS_INTERVAL_S,
+                    100.0 * (awake_us - lastAwake_us) / (STATS_INTERVAL_S * 1e6));
+                lastIrqs = irqs;
+                lastAwake_us = awake_us;
+            }
+
+            if (getchar_timeout_us(0) == 's') {
+                printf("\n");
+                sensorStats.dump(t1);
+            }
+
+            // No DIO2 edges to count here; blocks and timeouts both show the receiver is hearing something
+            if (health.check(t1, payloadIrqs + timeouts)) {
+                const auto& hs = health.stats();
+                printf("# health %s: detected after %lums; so far %lu resyncs, %lu full resets, %lu failed, %lu recovered in max %luus\n",
+                    health.causeName(health.lastFault()), (unsigned long)hs.lastDetect_ms,
+                    (unsigned long)hs.resyncs, (unsigned long)hs.fullResets, (unsigned long)hs.failed,
+                    (unsigned long)hs.recovered, (unsigned long)hs.recoverMax_us);
+            }
+        }
+
+        awake_us += time_us_32() - t0;
+    }
+    return 0;
+}
+
+void __not_in_flash_func(dio0InterruptHandler)() {
+    // PayloadReady stays high until the FIFO is read, so this is one per block
+    payloadIrqs++;
+    payloadReady = true;
+}
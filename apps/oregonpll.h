@@ -0,0 +1,167 @@
+#ifndef APPS_OREGONPLL_H_
+#define APPS_OREGONPLL_H_
+
+// Oregon V2 decoder that recovers the chip clock from the preamble, and tracks it through the frame
+//
+// OregonDecoderV2 classifies every pulse against fixed numbers: 200-700us is short, 700-1200us
+// long. Those have to be wide, because each sensor's crystal is a little off (and drifts with
+// temperature), and the OOK threshold in the SX1231 stretches the highs and shrinks the lows
+// by an amount that depends on signal strength. Once those two add up to a couple of hundred
+// microseconds a pulse lands on the wrong side of 700 and the frame is lost; meanwhile the
+// wide windows let plenty of noise in.
+//
+// This one measures instead:
+//   - during the preamble (all long pulses) it averages the widths, separately for every other
+//     pulse, which gives the chip period and the high/low asymmetry of this transmission
+//   - it locks when the short pulse that ends the preamble arrives, if there were at least
+//     PLL_PREAMBLE_LONGS before it and the short is half of what the longs were
+//   - from then on each pulse, corrected for the asymmetry, has to be within PLL_TOLERANCE_16THS
+//     of one or two chips, and the error nudges the period (and the asymmetry) a little,
+//     like a software DLL, so slow drift through the frame is followed
+// The bits and bytes come out exactly as OregonDecoderV2 has them, so it is a drop in
+// replacement, and apps/oregon.h works on its data unchanged.
+//
+// Arithmetic is in 1/16us, integers only; it runs on every edge.
+// Needs DecodeOOK.h (and Arduino.h, or host/arduinohost.h, before it) like the other decoders.
+
+#include <stdint.h>
+
+// Longs needed before the sync; V2 wants 24, but it can't tell a preamble from noise the way this can
+#define PLL_PREAMBLE_LONGS 16
+// How far (in chips) a corrected pulse may be from a whole number of chips
+#define PLL_TOLERANCE_16THS 5
+// DLL gains, as shifts: the period moves by 1/2^n of the error per chip
+#define PLL_PERIOD_SHIFT 3
+#define PLL_ASYMMETRY_SHIFT 4
+// Acquisition, in us: what could be a long at all (nominal 976us), and how much the preamble may vary
+#define PLL_ACQUIRE_MIN_US 600
+#define PLL_ACQUIRE_MAX_US 1500
+#define PLL_ACQUIRE_SPREAD_PERCENT 20
+
+class OregonDecoderPLL : public DecodeOOK {
+    // In 1/16us: the chip period, and how much longer than that the even pulses are (the odd
+    // ones are shorter by the same); even and odd count from the start of the preamble
+    int32_t chip16 = 0;
+    int32_t asym16 = 0;
+    // Preamble sums, per parity
+    int32_t sum16[2] = { 0, 0 };
+    uint8_t count[2] = { 0, 0 };
+    uint8_t parity = 0;
+
+    void startAcquire() {
+        sum16[0] = sum16[1] = 0;
+        count[0] = count[1] = 0;
+        parity = 0;
+    }
+
+    // Width with the asymmetry taken out, for the pulse about to be classified
+    int32_t corrected16(word width) const {
+        int32_t w16 = int32_t(width) << 4;
+        return parity == 0 ? w16 - asym16 : w16 + asym16;
+    }
+
+    // 1 or 2 chips, 0 if neither; and follow the error
+    int classify(word width) {
+        int32_t w16 = corrected16(width);
+        int chips = (w16 + chip16 / 2) / chip16;
+        if (chips < 1 || chips > 2) return 0;
+        int32_t err16 = w16 - chips * chip16;
+        if (err16 * 16 > PLL_TOLERANCE_16THS * chip16 || -err16 * 16 > PLL_TOLERANCE_16THS * chip16) return 0;
+        // The error per chip moves the period, and the error's sign against the parity the asymmetry
+        chip16 += (err16 / chips) >> PLL_PERIOD_SHIFT;
+        asym16 += (parity == 0 ? err16 : -err16) >> PLL_ASYMMETRY_SHIFT;
+        return chips;
+    }
+
+    char acquire(word width) {
+        if (flip == 0) startAcquire();
+        int32_t w16 = int32_t(width) << 4;
+        uint8_t n = count[0] + count[1];
+        if (n >= PLL_PREAMBLE_LONGS && count[parity]) {
+            // Is this the short that ends the preamble? Lock onto what the longs said, and check it against that
+            int32_t mean0 = sum16[0] / count[0];
+            int32_t mean1 = sum16[1] / count[1];
+            chip16 = (mean0 + mean1) / 4;
+            asym16 = (mean0 - mean1) / 2;
+            int32_t err16 = corrected16(width) - chip16;
+            if (err16 * 16 <= PLL_TOLERANCE_16THS * chip16 && -err16 * 16 <= PLL_TOLERANCE_16THS * chip16) {
+                parity ^= 1;
+                flip = 0;
+                state = T0;
+                return 0;
+            }
+        }
+        if (w16 < (PLL_ACQUIRE_MIN_US << 4) || w16 > (PLL_ACQUIRE_MAX_US << 4)) return -1;
+        if (count[parity]) {
+            // Has to agree with the longs so far of the same level; the two levels differ by the asymmetry
+            int32_t mean = sum16[parity] / count[parity];
+            int32_t spread = mean * PLL_ACQUIRE_SPREAD_PERCENT / 100;
+            if (w16 < mean - spread || w16 > mean + spread) {
+                // Could be the first long of a real preamble after some noise
+                startAcquire();
+            }
+        }
+        if (count[0] + count[1] < 250) {
+            sum16[parity] += w16;
+            count[parity]++;
+            flip = count[0] + count[1];
+        }
+        parity ^= 1;
+        return 0;
+    }
+
+public:
+    OregonDecoderPLL() {}
+
+    // Same bit collection as OregonDecoderV2: the second of each bit pair is the complement, skip it
+    virtual void gotBit(char value) {
+        if (!(total_bits & 0x01)) {
+            data[pos] = (data[pos] >> 1) | (value ? 0x80 : 00);
+        }
+        total_bits++;
+        pos = total_bits >> 4;
+        if (pos >= sizeof data) {
+            resetDecoder();
+            return;
+        }
+        state = OK;
+    }
+
+    virtual char decode(word width) {
+        if (state == UNKNOWN) {
+            return acquire(width);
+        }
+        // A gap of five chips or more ends the frame, if there was one
+        if ((int32_t(width) << 4) >= 5 * chip16) {
+            return pos >= 8 ? 1 : -1;
+        }
+        int chips = classify(width);
+        parity ^= 1;
+        switch (chips) {
+            case 1:
+                if (state == OK) {
+                    state = T0;
+                } else {
+                    // T0: the second short of a pair
+                    manchester(0);
+                }
+                break;
+            case 2:
+                if (state == OK) {
+                    manchester(1);
+                } else {
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+        }
+        return 0;
+    }
+
+    // What the last frame locked onto, in us
+    float chipPeriod_us() const { return chip16 / 16.0f; }
+    float asymmetry_us() const { return asym16 / 16.0f; }
+};
+
+#endif
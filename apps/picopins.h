@@ -19,4 +19,22 @@
 
 #define RFM69_DIO2 D11
 
+// DCLK, only for apps/oregon-dclk (continuous mode with the bit synchroniser)
+#define RFM69_DIO1 D13
+
+// A second module, for apps/multi-radio
+// By default it shares MISO/MOSI/SCK with the first (each module has its own CS)
+// Set RFM69_B_SHARED_SPI to 0 to put it on its own SPI pins instead
+#define RFM69_B_SHARED_SPI 1
+
+#define RFM69_B_MISO D26
+#define RFM69_B_MOSI D27
+#define RFM69_B_SCK D22
+#define RFM69_B_CS D18
+
+#define RFM69_B_RST D19
+#define RFM69_B_IRQ D20
+
+#define RFM69_B_DIO2 D21
+
 #endif
@@ -0,0 +1,192 @@
+#ifndef APPS_PINHAL_H_
+#define APPS_PINHAL_H_
+
+// Compile time pin / timer access for the hot paths
+//
+// arduino-compat is convenient, but every digitalWrite() goes through a pin number check
+// and a call into the SDK, micros() does the 64 bit latched timer read,
+// and attachInterrupt() dispatches through a table lookup on every edge.
+// For the edge timing ISR this is a significant fraction of the budget between edges.
+//
+// Here the pin is a template parameter (use the picopins.h constants), so each operation
+// compiles down to a single store to the SIO set/clr registers or a single load of
+// the raw timer; and an edge handler is registered directly on IO_IRQ_BANK0.
+//
+// There is a host fallback (anything not built with the Pico SDK for the device) so code using this
+// can also be run in host simulations; there, pin state is just an array and edges are injected.
+
+#include <stdint.h>
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include <hardware/gpio.h>
+#include <hardware/irq.h>
+#include <hardware/structs/sio.h>
+#include <hardware/structs/iobank0.h>
+#include <hardware/structs/timer.h>
+#else
+#include <chrono>
+#ifndef GPIO_IRQ_EDGE_FALL
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+#endif
+#endif
+
+namespace pinhal {
+
+typedef void (*edge_handler_t)();
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+
+// Free running 1MHz timer, low 32 bits; no latching, wraps every ~71 minutes
+// which is fine for differences between edges
+static inline uint32_t micros32() {
+    return timer_hw->timerawl;
+}
+
+// Full 64 bit timer without the latch registers (those are shared and not ISR safe)
+static inline uint64_t micros64() {
+    uint32_t hi = timer_hw->timerawh;
+    uint32_t lo;
+    uint32_t hi2;
+    while (true) {
+        lo = timer_hw->timerawl;
+        hi2 = timer_hw->timerawh;
+        if (hi == hi2) break;
+        hi = hi2;
+    }
+    return (uint64_t(hi) << 32) | lo;
+}
+
+template <uint Pin>
+struct OutputPin {
+    static constexpr uint32_t mask = 1u << Pin;
+    static void begin(bool initial = false) {
+        gpio_init(Pin);
+        gpio_put(Pin, initial);
+        gpio_set_dir(Pin, GPIO_OUT);
+    }
+    static inline void high() { sio_hw->gpio_set = mask; }
+    static inline void low() { sio_hw->gpio_clr = mask; }
+    static inline void toggle() { sio_hw->gpio_togl = mask; }
+    static inline void write(bool v) { if (v) high(); else low(); }
+};
+
+template <uint Pin>
+struct InputPin {
+    static constexpr uint32_t mask = 1u << Pin;
+    static void begin(bool pullDown = true) {
+        gpio_init(Pin);
+        gpio_set_dir(Pin, GPIO_IN);
+        if (pullDown) gpio_pull_down(Pin); else gpio_disable_pulls(Pin);
+    }
+    static inline bool read() { return (sio_hw->gpio_in & mask) != 0; }
+};
+
+// Edge interrupt on one pin, handler fixed at compile time.
+// Several EdgeIrq can coexist; each adds a shared handler on IO_IRQ_BANK0 that only
+// looks at its own status bits (a constant register and mask), so there is no table walk.
+// Do not use attachInterrupt() / gpio_set_irq_enabled_with_callback() after this in the same program,
+// the SDK installs its callback dispatcher as an exclusive handler.
+template <uint Pin, edge_handler_t Handler, uint32_t Events = GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL>
+struct EdgeIrq {
+    static constexpr uint reg = Pin >> 3;
+    static constexpr uint shift = 4 * (Pin & 7);
+    static constexpr uint32_t bits = Events << shift;
+
+    static void __not_in_flash_func(dispatch)() {
+        io_irq_ctrl_hw_t* ctrl = &iobank0_hw->proc0_irq_ctrl;
+        if (ctrl->ints[reg] & bits) {
+            // Edge status bits are write one to clear
+            iobank0_hw->intr[reg] = bits;
+            Handler();
+        }
+    }
+
+    static void attach() {
+        // RadioHead's init() uses attachInterrupt() on DIO0, which on older SDKs installs the GPIO
+        // callback dispatcher as an exclusive handler. Rfm69Common detaches the pin again,
+        // but the leftover handler would make adding a shared one fail
+        irq_handler_t leftover = irq_get_exclusive_handler(IO_IRQ_BANK0);
+        if (leftover) {
+            irq_remove_handler(IO_IRQ_BANK0, leftover);
+        }
+        iobank0_hw->intr[reg] = bits;
+        irq_add_shared_handler(IO_IRQ_BANK0, dispatch, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        gpio_set_irq_enabled(Pin, Events, true);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+    // Leave the shared handler installed, just stop the pin raising it
+    static inline void enable(bool on) {
+        if (on) {
+            iobank0_hw->intr[reg] = bits;
+            hw_set_bits(&iobank0_hw->proc0_irq_ctrl.inte[reg], bits);
+        } else {
+            hw_clear_bits(&iobank0_hw->proc0_irq_ctrl.inte[reg], bits);
+        }
+    }
+};
+
+#else // host
+
+namespace host {
+    inline uint32_t pinState = 0;
+    inline edge_handler_t handlers[32] = {};
+    inline uint32_t events[32] = {};
+    inline uint32_t enabled = 0;
+    // Simulations can drive time themselves; otherwise this is the host clock
+    inline uint64_t (*clock_us)() = nullptr;
+
+    // Set an input pin level, calling the edge handler like the IRQ would
+    inline void setInput(uint32_t pin, bool level) {
+        bool was = (pinState >> pin) & 1;
+        if (level) pinState |= 1u << pin; else pinState &= ~(1u << pin);
+        uint32_t edge = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+        if (was != level && (enabled & (1u << pin)) && (events[pin] & edge) && handlers[pin]) {
+            handlers[pin]();
+        }
+    }
+} // namespace host
+
+static inline uint64_t micros64() {
+    if (host::clock_us) return host::clock_us();
+    using namespace std::chrono;
+    static const auto t0 = steady_clock::now();
+    return uint64_t(duration_cast<microseconds>(steady_clock::now() - t0).count());
+}
+
+static inline uint32_t micros32() { return uint32_t(micros64()); }
+
+template <unsigned Pin>
+struct OutputPin {
+    static constexpr uint32_t mask = 1u << Pin;
+    static void begin(bool initial = false) { write(initial); }
+    static inline void high() { host::pinState |= mask; }
+    static inline void low() { host::pinState &= ~mask; }
+    static inline void toggle() { host::pinState ^= mask; }
+    static inline void write(bool v) { if (v) high(); else low(); }
+};
+
+template <unsigned Pin>
+struct InputPin {
+    static constexpr uint32_t mask = 1u << Pin;
+    static void begin(bool = true) {}
+    static inline bool read() { return (host::pinState & mask) != 0; }
+};
+
+template <unsigned Pin, edge_handler_t Handler, uint32_t Events = GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL>
+struct EdgeIrq {
+    static void attach() {
+        host::handlers[Pin] = Handler;
+        host::events[Pin] = Events;
+        host::enabled |= 1u << Pin;
+    }
+    static inline void enable(bool on) {
+        if (on) host::enabled |= 1u << Pin; else host::enabled &= ~(1u << Pin);
+    }
+};
+
+#endif
+
+} // namespace pinhal
+
+#endif
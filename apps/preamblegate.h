@@ -0,0 +1,227 @@
+#ifndef APPS_PREAMBLEGATE_H_
+#define APPS_PREAMBLEGATE_H_
+
+// Oregon preamble gate, the CPU side of apps/oregon-gate
+//
+// oregon-decode takes an interrupt on every DIO2 edge, and most of those are noise between
+// transmissions. In oregon-gate two PIO state machines watch DIO2 instead (oregongate.pio):
+//   - edge_timer measures every pulse in microseconds, and DMA drops each one in a ring, so the
+//     edges from before a trigger are still there to be decoded
+//   - oregon_preamble counts pulses of the preamble length (one bit period, two chips) in a row,
+//     and only raises a PIO IRQ after PREAMBLE_PULSES of them; anything shorter or longer starts
+//     the count again. Then it waits, stalled, until the CPU re-arms it.
+// The CPU sleeps until that IRQ, backs up PRETRIGGER_INTERVALS in the ring, and runs the decoder
+// from there until it has a frame or gives up; the decoder itself checks for the sync nibble.
+//
+// PreambleModel does what oregon_preamble does, a pulse at a time, for host/preamble-gate-sim.
+// The numbers here have to match the .define's in oregongate.pio; oregon-gate static_asserts that.
+//
+// No SDK dependency, so the host simulations run the same code.
+
+#include <stdint.h>
+
+// oregon_preamble runs two instructions per tick
+#define PREAMBLE_TICK_US 40
+// Preamble pulses are 976us; accept 680us up to 1240us, which leaves out the 488us short pulses
+#define PREAMBLE_MIN_TICKS 17
+#define PREAMBLE_SPAN_TICKS 14
+// The decoder wants 24 long pulses before the sync; the sensors send 32, so trigger at 16
+// and there are still plenty to come, plus the ones before the trigger from the ring
+#define PREAMBLE_PULSES 16
+#define PRETRIGGER_INTERVALS 48
+
+// DMA ring of pulse widths, 8K, so it can use the DMA ring wrap (which wants it aligned to its size)
+#define GATE_RING_SIZE 2048
+// No edge for this long means the frame is over; the decoder wants a pulse >= 2500us to finish
+#define GATE_GAP_US 3000
+// A trigger that has not produced a frame by now was not a sensor (a whole frame is about 200ms)
+#define GATE_FRAME_TIMEOUT_US 400000
+
+// What the oregon_preamble state machine does, one pulse at a time
+class PreambleModel {
+    enum State { WAIT_LOW, COUNTING, MATCHED };
+    State state = WAIT_LOW;
+    uint32_t remaining = 0;
+
+    // restart: mov x, osr; wait 0 pin; wait 1 pin
+    // So the count starts at the next rising edge that comes after a low the restart saw
+    void restart(State next) {
+        remaining = PREAMBLE_PULSES - 1;
+        state = next;
+    }
+
+public:
+    // A pulse of width_us, high or low, has just ended; true if that completed a preamble
+    bool pulse(bool high, uint32_t width_us) {
+        switch (state) {
+            case MATCHED:
+                // Stalled in irq wait
+                return false;
+            case WAIT_LOW:
+                if (!high) {
+                    // wait 1 pin is satisfied by the rise at the end of this low
+                    remaining = PREAMBLE_PULSES - 1;
+                    state = COUNTING;
+                }
+                return false;
+            case COUNTING:
+                break;
+        }
+        uint32_t ticks = width_us / PREAMBLE_TICK_US;
+        if (ticks < PREAMBLE_MIN_TICKS) {
+            // Seen at the edge that ended it. After a short high the pin is low and the rise that
+            // ends it starts the count; after a short low, wait 0 skips the high we are now in.
+            // Either way the next low is the one that arms it.
+            restart(WAIT_LOW);
+            return false;
+        }
+        if (ticks >= PREAMBLE_MIN_TICKS + PREAMBLE_SPAN_TICKS) {
+            // Seen while still in it: a long high still needs a low, a long low is one
+            restart(high ? WAIT_LOW : COUNTING);
+            return false;
+        }
+        // jmp x--
+        if (remaining == 0) {
+            state = MATCHED;
+            return true;
+        }
+        remaining--;
+        return false;
+    }
+
+    // The CPU cleared the IRQ flag; the next complete high pulse starts the count
+    void rearm() {
+        if (state == MATCHED) {
+            state = WAIT_LOW;
+        }
+    }
+
+    bool matched() const { return state == MATCHED; }
+};
+
+// Reader for the ring the DMA writes into. head is the number of widths written so far, which
+// on the Pico is the DMA transfer count counted up from 0
+template <unsigned N>
+class IntervalReader {
+    static_assert((N & (N - 1)) == 0, "IntervalReader size must be a power of two");
+    // Don't read the slots the DMA is about to write
+    static const uint32_t MARGIN = 8;
+    const volatile uint32_t* ring;
+    uint32_t tail = 0;
+    uint32_t lapped = 0;
+
+public:
+    explicit IntervalReader(const volatile uint32_t* ring) : ring(ring) {}
+
+    // Start reading up to back widths before head, as far as the ring still has them
+    void seekBack(uint32_t head, uint32_t back) {
+        if (back > N - MARGIN) back = N - MARGIN;
+        tail = head - (head < back ? head : back);
+    }
+
+    void seek(uint32_t head) { tail = head; }
+
+    bool next(uint32_t head, uint32_t& width_us) {
+        if (tail == head) return false;
+        if (head - tail > N - MARGIN) {
+            // The DMA went all the way round since we last looked
+            lapped += head - tail - (N - MARGIN);
+            tail = head - (N - MARGIN);
+        }
+        width_us = ring[tail & (N - 1)];
+        tail++;
+        return true;
+    }
+
+    uint32_t pending(uint32_t head) const { return head - tail; }
+    uint32_t lappedCount() const { return lapped; }
+};
+
+// Runs the decoder over the ring after a trigger, until a frame or the timeout
+template <typename Decoder, unsigned N>
+class GatedDecode {
+    Decoder& decoder;
+    IntervalReader<N> reader;
+    uint32_t start_us = 0;
+    uint32_t lastEdge_us = 0;
+    bool gapSent = false;
+    bool locked = false;
+    bool active = false;
+
+    // Once the decoder has started collecting bits, going back to none means it lost the frame,
+    // and there is no point waiting out the timeout: the second of the pair is only 10ms behind
+    bool lostLock() {
+        uint8_t len;
+        decoder.getData(len);
+        if (len) {
+            locked = true;
+            return false;
+        }
+        return locked;
+    }
+
+public:
+    enum Result { BUSY, FRAME, GAVE_UP };
+
+    struct Stats {
+        uint32_t triggers;
+        uint32_t frames;
+        uint32_t noFrame;
+        uint32_t widthsDecoded;
+    };
+
+    GatedDecode(Decoder& decoder, const volatile uint32_t* ring) : decoder(decoder), reader(ring) {}
+
+    void trigger(uint32_t head, uint32_t now_us) {
+        reader.seekBack(head, PRETRIGGER_INTERVALS);
+        decoder.resetDecoder();
+        start_us = now_us;
+        lastEdge_us = now_us;
+        gapSent = false;
+        locked = false;
+        active = true;
+        stats_.triggers++;
+    }
+
+    // Decode whatever the DMA has added since the last call. FRAME leaves the frame in the
+    // decoder for the caller (who resets it); FRAME and GAVE_UP both mean re-arm the gate.
+    Result poll(uint32_t head, uint32_t now_us) {
+        if (!active) return GAVE_UP;
+        uint32_t width_us;
+        while (reader.next(head, width_us)) {
+            lastEdge_us = now_us;
+            gapSent = false;
+            stats_.widthsDecoded++;
+            if (decoder.nextPulse(width_us)) return finish(FRAME);
+            if (lostLock()) return finish(GAVE_UP);
+        }
+        // The width of the gap after the last pulse is only known at the next edge, which could
+        // be seconds away, but once it is this long it is long enough to end the frame
+        if (!gapSent && now_us - lastEdge_us >= GATE_GAP_US) {
+            gapSent = true;
+            if (decoder.nextPulse(GATE_GAP_US)) return finish(FRAME);
+            if (lostLock()) return finish(GAVE_UP);
+        }
+        if (now_us - start_us >= GATE_FRAME_TIMEOUT_US) {
+            return finish(GAVE_UP);
+        }
+        return BUSY;
+    }
+
+    bool busy() const { return active; }
+    uint32_t lappedCount() const { return reader.lappedCount(); }
+    const Stats& stats() const { return stats_; }
+
+private:
+    Stats stats_ = {};
+
+    Result finish(Result r) {
+        active = false;
+        if (r == GAVE_UP) decoder.resetDecoder();
+        if (r == FRAME) stats_.frames++;
+        else stats_.noFrame++;
+        return r;
+    }
+};
+
+#endif
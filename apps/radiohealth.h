@@ -0,0 +1,342 @@
+#ifndef APPS_RADIOHEALTH_H_
+#define APPS_RADIOHEALTH_H_
+
+// Radio health watchdog
+//
+// If the SX1231 gets wedged - a brown out puts every register back to its reset value, an SPI glitch
+// writes a wrong value somewhere, the chip drops out of RX - the apps just keep looping, deaf.
+// RadioHealth is called from the loop (about once a second) and looks for:
+//   - OPMODE not in RX, or the version register not reading 0x24 (SPI not talking to the chip at all)
+//   - any configured register not reading back what we wrote (the register shadow, checked every verify_ms)
+//   - RSSI not varying at all over a window; a working receiver always has some noise
+//   - no DIO2 edges at all for edgeStall_ms; with the OOK threshold following the floor there is
+//     always some noise getting through, and sensors transmit every ~40s anyway
+//
+// Recovery is in two steps. First a resync: rewrite just the registers that drifted, put it back in RX
+// and restart the receiver, which takes a few SPI transactions. If that does not verify, or the symptom
+// is still there when checked again, the full reset and reconfigure (what begin() does, ~25ms).
+// Time to detect (from the last time the symptom was seen healthy) and time to recover are kept in Stats.
+//
+// The Port is the radio: Rfm69Common, or the fault injecting stand in in host/radio-health-sim. It needs
+//   uint8_t readReg(uint8_t reg);  void writeReg(uint8_t reg, uint8_t value);
+//   RegisterShadow<...>& shadow();  void restartRx();  bool fullReset();
+// The chip comes out of a full reset with nothing latched and DIO0 low, so whatever the app keeps around
+// it (the DIO0 interrupt, the squelch) wants setting up again: onFullReset() gives a function for that.
+// No SDK dependency beyond pinhal.h for the clock.
+
+#include <stdint.h>
+
+#include "pinhal.h"
+
+namespace sx1231 {
+    // Same values as RH_RF69.h; repeated so this builds on the host without RadioHead
+    constexpr uint8_t REG_OPMODE = 0x01;
+    constexpr uint8_t REG_VERSION = 0x10;
+    constexpr uint8_t REG_RSSIVALUE = 0x24;
+    constexpr uint8_t REG_IRQFLAGS1 = 0x27;
+    constexpr uint8_t OPMODE_MODE = 0x1c;
+    constexpr uint8_t OPMODE_MODE_RX = 0x10;
+    constexpr uint8_t IRQFLAGS1_MODEREADY = 0x80;
+    constexpr uint8_t VERSION = 0x24;
+}
+
+// What we configured, so it can be checked and put back register by register
+template <unsigned N>
+class RegisterShadow {
+    struct Entry {
+        uint8_t reg;
+        uint8_t value;
+        uint8_t mask;   // bits we care about
+    };
+    Entry entries[N];
+    unsigned count = 0;
+
+public:
+    void clear() { count = 0; }
+
+    void record(uint8_t reg, uint8_t value, uint8_t mask = 0xff) {
+        for (unsigned i = 0; i < count; i++) {
+            if (entries[i].reg == reg) {
+                entries[i].value = value;
+                entries[i].mask = mask;
+                return;
+            }
+        }
+        if (count < N) {
+            entries[count++] = { reg, value, mask };
+        }
+    }
+
+    unsigned size() const { return count; }
+
+    // Compare against the chip; with fix, rewrite what drifted and read it back again.
+    // Returns how many drifted, or -1 if a rewrite did not stick
+    template <typename Port>
+    int verify(Port& port, bool fix) const {
+        int drifted = 0;
+        for (unsigned i = 0; i < count; i++) {
+            const Entry& e = entries[i];
+            uint8_t v = port.readReg(e.reg);
+            if (((v ^ e.value) & e.mask) == 0) continue;
+            drifted++;
+            if (!fix) continue;
+            port.writeReg(e.reg, uint8_t((v & ~e.mask) | (e.value & e.mask)));
+            if ((port.readReg(e.reg) ^ e.value) & e.mask) return -1;
+        }
+        return drifted;
+    }
+};
+
+// Configured registers: DATAMODUL, BITRATE x2, RXBW, DIOMAPPING x2, FRF x3, OOKPEAK, OOKFIX, RSSITHRESH,
+// and in packet mode SYNCCONFIG, SYNCVALUE x up to 8, PACKETCONFIG1, PAYLOADLENGTH, RXTIMEOUT2
+#define RADIO_SHADOW_REGISTERS 24
+
+template <typename Port>
+class RadioHealth {
+public:
+    enum Cause { CAUSE_OPMODE, CAUSE_NO_CHIP, CAUSE_REGISTERS, CAUSE_RSSI_STUCK, CAUSE_EDGE_STALL, NUM_CAUSES };
+
+    struct Config {
+        uint32_t verify_ms = 10000;     // full register shadow check this often
+        uint32_t edgeStall_ms = 120000;
+        uint32_t probation_ms = 5000;   // after a resync for RSSI / edge symptoms, they must clear by then
+        uint32_t retry_ms = 60000;      // if even a full reset did not help, try again this often
+    };
+
+    struct Stats {
+        uint32_t checks;
+        uint32_t faults[NUM_CAUSES];
+        uint32_t resyncs;           // first step recoveries that worked
+        uint32_t registersFixed;
+        uint32_t fullResets;
+        uint32_t failed;            // full reset did not clear it either
+        uint32_t detected;
+        uint64_t detectSum_ms;
+        uint32_t detectMax_ms;
+        uint32_t lastDetect_ms;
+        uint32_t recovered;
+        uint64_t recoverSum_us;
+        uint32_t recoverMax_us;
+    };
+
+    static const char* causeName(int c) {
+        static const char* const names[NUM_CAUSES] = { "opmode", "no-chip", "registers", "rssi-stuck", "edge-stall" };
+        return c >= 0 && c < NUM_CAUSES ? names[c] : "?";
+    }
+
+private:
+    static constexpr int RSSI_WINDOW = 10;
+
+    Port& port;
+    Config cfg;
+    Stats st = {};
+
+    uint32_t lastCheck_ms = 0;
+    uint32_t lastVerify_ms = 0;
+    uint32_t lastEdges = 0;
+    uint32_t lastEdge_ms = 0;
+    uint8_t rssi[RSSI_WINDOW] = {};
+    int rssiCount = 0;
+    int rssiAt = 0;
+    uint32_t rssiVaried_ms = 0;
+    bool started = false;
+
+    // Recovery in progress: waiting for the symptom to clear
+    bool probation = false;
+    bool afterFullReset = false;
+    void (*resetHook)() = nullptr;
+    int probationCause = 0;
+    uint32_t probationUntil_ms = 0;
+    uint64_t detectedAt_us = 0;
+    uint32_t nextRetry_ms = 0;
+    int lastCause = -1;
+
+    bool rssiStuck() const {
+        if (rssiCount < RSSI_WINDOW) return false;
+        // Variance over the window, done in integers; zero means every reading identical
+        uint32_t sum = 0, sumSq = 0;
+        for (int i = 0; i < RSSI_WINDOW; i++) {
+            sum += rssi[i];
+            sumSq += uint32_t(rssi[i]) * rssi[i];
+        }
+        return sumSq * RSSI_WINDOW == sum * sum;
+    }
+
+    void addRssi(uint8_t v, uint32_t now_ms) {
+        if (rssiCount > 0 && v != rssi[(rssiAt + RSSI_WINDOW - 1) % RSSI_WINDOW]) rssiVaried_ms = now_ms;
+        rssi[rssiAt] = v;
+        rssiAt = (rssiAt + 1) % RSSI_WINDOW;
+        if (rssiCount < RSSI_WINDOW) rssiCount++;
+    }
+
+    void resetSymptoms(uint32_t now_ms) {
+        rssiCount = 0;
+        rssiVaried_ms = now_ms;
+        lastEdge_ms = now_ms;
+    }
+
+    // Back in RX, waiting (bounded - RadioHead's setOpMode() waits forever) for ModeReady
+    bool enterRx() {
+        uint8_t op = port.readReg(sx1231::REG_OPMODE);
+        port.writeReg(sx1231::REG_OPMODE, uint8_t((op & ~sx1231::OPMODE_MODE) | sx1231::OPMODE_MODE_RX));
+        for (int i = 0; i < 100; i++) {
+            if (port.readReg(sx1231::REG_IRQFLAGS1) & sx1231::IRQFLAGS1_MODEREADY) {
+                return (port.readReg(sx1231::REG_OPMODE) & sx1231::OPMODE_MODE) == sx1231::OPMODE_MODE_RX;
+            }
+        }
+        return false;
+    }
+
+    bool resync() {
+        if (port.readReg(sx1231::REG_VERSION) != sx1231::VERSION) return false;
+        int fixed = port.shadow().verify(port, true);
+        if (fixed < 0) return false;
+        st.registersFixed += fixed;
+        if (!enterRx()) return false;
+        port.restartRx();
+        return true;
+    }
+
+    void recovered() {
+        uint32_t us = uint32_t(pinhal::micros64() - detectedAt_us);
+        st.recovered++;
+        st.recoverSum_us += us;
+        if (us > st.recoverMax_us) st.recoverMax_us = us;
+    }
+
+    bool fullReset(uint32_t now_ms) {
+        st.fullResets++;
+        afterFullReset = true;
+        bool ok = port.fullReset() && port.readReg(sx1231::REG_VERSION) == sx1231::VERSION;
+        if (ok && resetHook) resetHook();
+        resetSymptoms(now_ms);
+        lastVerify_ms = now_ms;
+        return ok;
+    }
+
+    // Something is wrong: resync first, full reset if that does not do it
+    void recover(int cause, uint32_t now_ms, uint32_t onset_ms) {
+        st.faults[cause]++;
+        st.detected++;
+        lastCause = cause;
+        uint32_t detect = now_ms - onset_ms;
+        st.detectSum_ms += detect;
+        st.lastDetect_ms = detect;
+        if (detect > st.detectMax_ms) st.detectMax_ms = detect;
+        detectedAt_us = pinhal::micros64();
+        afterFullReset = false;
+
+        bool ok = resync();
+        if (!ok) {
+            ok = fullReset(now_ms);
+        } else {
+            resetSymptoms(now_ms);
+        }
+        if (!ok) {
+            st.failed++;
+            nextRetry_ms = now_ms + cfg.retry_ms;
+            probation = false;
+            return;
+        }
+        if (cause == CAUSE_RSSI_STUCK || cause == CAUSE_EDGE_STALL) {
+            // The registers were fine, or are now; whether it is hearing again shows over the next while
+            probation = true;
+            probationCause = cause;
+            probationUntil_ms = now_ms + cfg.probation_ms;
+        } else {
+            if (!afterFullReset) st.resyncs++;
+            recovered();
+        }
+    }
+
+public:
+    RadioHealth(Port& p, const Config& c = Config()) : port(p), cfg(c) {}
+
+    // Called from check() after each full reset that worked
+    void onFullReset(void (*hook)()) { resetHook = hook; }
+
+    // Call from the loop with the current DIO2 edge count; a check costs three SPI reads,
+    // plus the whole shadow every verify_ms. Returns true if it did a recovery this time
+    bool check(uint32_t now_ms, uint32_t edgeCount) {
+        st.checks++;
+        if (!started) {
+            started = true;
+            lastCheck_ms = lastVerify_ms = now_ms;
+            resetSymptoms(now_ms);
+            lastEdges = edgeCount;
+        }
+        uint32_t prevCheck_ms = lastCheck_ms;
+        lastCheck_ms = now_ms;
+        if (edgeCount != lastEdges) {
+            lastEdges = edgeCount;
+            lastEdge_ms = now_ms;
+        }
+
+        if (nextRetry_ms && int32_t(now_ms - nextRetry_ms) < 0) return false;
+        nextRetry_ms = 0;
+
+        uint8_t version = port.readReg(sx1231::REG_VERSION);
+        uint8_t op = port.readReg(sx1231::REG_OPMODE);
+        addRssi(port.readReg(sx1231::REG_RSSIVALUE), now_ms);
+
+        int cause = -1;
+        uint32_t onset_ms = prevCheck_ms;
+        if (version != sx1231::VERSION) {
+            cause = CAUSE_NO_CHIP;
+        } else if ((op & sx1231::OPMODE_MODE) != sx1231::OPMODE_MODE_RX) {
+            cause = CAUSE_OPMODE;
+        } else if (int32_t(now_ms - lastVerify_ms) >= int32_t(cfg.verify_ms)) {
+            uint32_t prevVerify_ms = lastVerify_ms;
+            lastVerify_ms = now_ms;
+            if (port.shadow().verify(port, false) != 0) {
+                cause = CAUSE_REGISTERS;
+                onset_ms = prevVerify_ms;
+            }
+        }
+
+        if (probation) {
+            bool clear = probationCause == CAUSE_EDGE_STALL ? int32_t(lastEdge_ms - (probationUntil_ms - cfg.probation_ms)) > 0
+                                                            : int32_t(rssiVaried_ms - (probationUntil_ms - cfg.probation_ms)) > 0;
+            if (clear && cause < 0) {
+                probation = false;
+                if (!afterFullReset) st.resyncs++;
+                recovered();
+                return false;
+            }
+            if (cause < 0 && int32_t(now_ms - probationUntil_ms) < 0) return false;
+            // Still deaf (or something else now): the resync was not enough
+            probation = false;
+            if (afterFullReset) {
+                st.failed++;
+                nextRetry_ms = now_ms + cfg.retry_ms;
+                return false;
+            }
+            if (fullReset(now_ms)) {
+                probationUntil_ms = now_ms + cfg.probation_ms;
+                probation = true;
+            } else {
+                st.failed++;
+                nextRetry_ms = now_ms + cfg.retry_ms;
+            }
+            return true;
+        }
+
+        if (cause < 0 && rssiStuck()) {
+            cause = CAUSE_RSSI_STUCK;
+            onset_ms = rssiVaried_ms;
+        }
+        if (cause < 0 && int32_t(now_ms - lastEdge_ms) >= int32_t(cfg.edgeStall_ms)) {
+            cause = CAUSE_EDGE_STALL;
+            onset_ms = lastEdge_ms;
+        }
+        if (cause < 0) return false;
+        recover(cause, now_ms, onset_ms);
+        return true;
+    }
+
+    const Stats& stats() const { return st; }
+    // Why the last recovery was started, -1 if none yet
+    int lastFault() const { return lastCause; }
+};
+
+#endif
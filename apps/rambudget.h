@@ -0,0 +1,74 @@
+#ifndef APPS_RAMBUDGET_H_
+#define APPS_RAMBUDGET_H_
+
+// Static allocation and RAM budgets for the receive pipeline
+//
+// Nothing in the pipeline uses the heap: objects whose construction has to wait until
+// the pins are known (the RadioHead driver) live in a StaticSlot, which is just correctly aligned
+// storage inside the owning object, and everything else is a file scope static in the app.
+// So the RAM an app needs is all visible at link time, and apps/ramreport.cmake prints it
+// per subsystem after every build.
+//
+// The budgets below are checked with static_assert where the types are used, so growing a buffer
+// past what we planned for fails the build instead of running out in the field.
+// They are deliberately generous over today's sizes, the point is catching a 10x mistake,
+// e.g. someone bumping EDGE_RING_SIZE to 64k.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+// RP2040: 264kB SRAM; the SDK reserves 2kB stack for each core
+#define RAM_TOTAL_BYTES (264 * 1024)
+#define RAM_STACKS_BYTES (2 * 2048)
+
+// Per instance budgets, bytes
+#define RAM_BUDGET_RADIO 512        // Rfm69Common including its RH_RF69 driver and (own) SPI bus
+#define RAM_BUDGET_DECODER 64       // one OregonDecoderV2
+#define RAM_BUDGET_CAPTURE 1024     // one EdgeCapture ring
+#define RAM_BUDGET_DEDUPE 512       // the FrameDedupe table
+#define RAM_BUDGET_BURST 1600       // BurstRecorder, the widths of one burst
+#define RAM_BUDGET_COLLISION 2048   // CollisionResolver, sensor tracks and chips
+#define RAM_BUDGET_JOURNAL 1152     // TraceJournal, one record staged for flash
+#define RAM_BUDGET_SENSORSTATS 2048 // SensorStats, the per sensor table
+
+// Whole pipeline, so there is always room left for more decoders and sensors; each receiving app
+// (oregon-decode, oregon-packet, oregon-dclk, oregon-gate, ook-framework, multi-radio) sums its own statics against it
+#define RAM_BUDGET_PIPELINE (16 * 1024)
+
+#define RAM_BUDGET_CHECK(type, budget) \
+    static_assert(sizeof(type) <= (budget), #type " is over its RAM budget (" #budget ")")
+
+template <typename T>
+class StaticSlot {
+    alignas(T) uint8_t storage[sizeof(T)];
+    T* obj = nullptr;
+
+public:
+    StaticSlot() {}
+    ~StaticSlot() { reset(); }
+    StaticSlot(const StaticSlot&) = delete;
+    StaticSlot& operator=(const StaticSlot&) = delete;
+
+    template <typename... Args>
+    T& emplace(Args&&... args) {
+        reset();
+        obj = new (storage) T(std::forward<Args>(args)...);
+        return *obj;
+    }
+
+    void reset() {
+        if (obj) {
+            obj->~T();
+            obj = nullptr;
+        }
+    }
+
+    T* get() const { return obj; }
+    T* operator->() const { return obj; }
+    T& operator*() const { return *obj; }
+    explicit operator bool() const { return obj != nullptr; }
+};
+
+#endif
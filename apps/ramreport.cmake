@@ -0,0 +1,115 @@
+# Per subsystem RAM / flash report for one linked app
+#
+# Run after the link (see ook_ram_report() in apps/CMakeLists.txt), or by hand:
+#   cmake -DNM=arm-none-eabi-nm -DELF=app_oregon-decode.elf -DOUT=report.txt -P apps/ramreport.cmake
+#
+# Symbols are bucketed by name, so the numbers are approximate (the SDK puts some things in RAM we
+# do not see by name, e.g. the vector table copy), but the per subsystem split is what we want,
+# to know how much room there is left for more decoders and sensors.
+# RAM is .data/.bss (D/d/B/b), flash is code and read only data (T/t/R/r) plus the .data initialisers.
+
+if(NOT ELF OR NOT EXISTS "${ELF}")
+    message(FATAL_ERROR "ramreport: ELF not set or missing (${ELF})")
+endif()
+if(NOT NM)
+    set(NM nm)
+endif()
+if(NOT DEFINED RAM_TOTAL)
+    set(RAM_TOTAL 270336)   # 264kB
+endif()
+if(NOT DEFINED RAM_STACKS)
+    set(RAM_STACKS 4096)    # 2kB per core
+endif()
+
+execute_process(
+    COMMAND ${NM} -S -C --size-sort --radix=d "${ELF}"
+    OUTPUT_VARIABLE symbols
+    RESULT_VARIABLE nmResult)
+if(NOT nmResult EQUAL 0)
+    message(FATAL_ERROR "ramreport: ${NM} failed on ${ELF}")
+endif()
+
+# First match wins, so the more specific patterns go first
+set(subsystems radio decoder capture tasks usb stdio sdk app)
+set(match_radio "RH_|RHGeneric|RHSoftwareSPI|RHSPIDriver|RHHardwareSPI|Rfm69|rfm69|SpiArbiter")
+set(match_decoder "DecodeOOK|OregonDecoder|orscV2|decodeTempHumidity|FrameDedupe|dedupe|checkedLength")
+set(match_capture "EdgeCapture|EdgeRing|sharedData|dio2|Dio2|EdgeIrq|pinhal")
+set(match_tasks "corotask")
+set(match_usb "tud_|tusb|usbd_|dcd_|_usbd|hcd_|tuh_")
+set(match_stdio "printf|stdio|_vfprintf|_dtoa|__sf|_reent|_impure|Serial")
+set(match_sdk "^_|hardware_|irq_|gpio_|clock|pll_|xosc|time|alarm|spin_lock|mutex|panic|runtime|flash|__aeabi|memcpy|memset|rom_")
+
+foreach(s ${subsystems})
+    set(ram_${s} 0)
+    set(flash_${s} 0)
+endforeach()
+set(hasMalloc FALSE)
+
+string(REPLACE "\n" ";" lines "${symbols}")
+foreach(line ${lines})
+    # addr size type name; names can contain spaces after demangling
+    if(NOT line MATCHES "^[0-9]+ ([0-9]+) ([A-Za-z]) (.*)$")
+        continue()
+    endif()
+    set(size ${CMAKE_MATCH_1})
+    set(type ${CMAKE_MATCH_2})
+    set(name "${CMAKE_MATCH_3}")
+    if(name MATCHES "^_malloc_r$|^malloc$")
+        set(hasMalloc TRUE)
+    endif()
+    set(bucket app)
+    foreach(s ${subsystems})
+        if(NOT s STREQUAL "app" AND name MATCHES "${match_${s}}")
+            set(bucket ${s})
+            break()
+        endif()
+    endforeach()
+    if(type MATCHES "^[BbDd]$")
+        math(EXPR ram_${bucket} "${ram_${bucket}} + ${size}")
+    endif()
+    if(type MATCHES "^[TtRrDd]$")
+        math(EXPR flash_${bucket} "${flash_${bucket}} + ${size}")
+    endif()
+endforeach()
+
+# Fixed width columns (string(REPEAT) needs a newer cmake than the Pico SDK minimum)
+function(pad_to out width value left)
+    set(v "${value}")
+    string(LENGTH "${v}" len)
+    while(len LESS width)
+        if(left)
+            set(v "${v} ")
+        else()
+            set(v " ${v}")
+        endif()
+        math(EXPR len "${len} + 1")
+    endwhile()
+    set(${out} "${v}" PARENT_SCOPE)
+endfunction()
+
+get_filename_component(elfName "${ELF}" NAME)
+set(report "RAM / flash by subsystem for ${elfName}\n")
+string(APPEND report "  subsystem      RAM    flash\n")
+set(ramSum 0)
+set(flashSum 0)
+foreach(s ${subsystems})
+    math(EXPR ramSum "${ramSum} + ${ram_${s}}")
+    math(EXPR flashSum "${flashSum} + ${flash_${s}}")
+    pad_to(name 10 "${s}" TRUE)
+    pad_to(r 8 "${ram_${s}}" FALSE)
+    pad_to(f 8 "${flash_${s}}" FALSE)
+    string(APPEND report "  ${name}${r} ${f}\n")
+endforeach()
+math(EXPR headroom "${RAM_TOTAL} - ${RAM_STACKS} - ${ramSum}")
+string(APPEND report "  total       ${ramSum} RAM, ${flashSum} flash\n")
+string(APPEND report "  headroom    ${headroom} of ${RAM_TOTAL} bytes RAM after ${RAM_STACKS} bytes of stacks\n")
+if(hasMalloc)
+    string(APPEND report "  malloc is linked in (something allocates, possibly only the SDK / newlib)\n")
+else()
+    string(APPEND report "  malloc is not linked in\n")
+endif()
+
+message("${report}")
+if(OUT)
+    file(WRITE "${OUT}" "${report}")
+endif()
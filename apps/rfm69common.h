@@ -3,11 +3,14 @@
 
 #include <Arduino.h>
 #include <stdio.h>
+#include <string.h>
 #include <pico/stdlib.h>
 #include <RH_RF69.h>
 #include <RHSoftwareSPI.h>
 
-#include <memory>
+#include "spibus.h"
+#include "rambudget.h"
+#include "radiohealth.h"
 
 #define FXOSC 32000000
 
@@ -16,54 +19,241 @@
 #define OOK_USE_FIXED_PEAK_DETECTOR false
 #define OOK_FIXED_PEAK_DETECT_THRESHOLD_DB 21
 
+// One set of MISO/MOSI/SCK pins, which more than one module can share (each with its own CS)
+class Rfm69Bus {
+public:
+    RHSoftwareSPI spi;
+    SpiArbiter arbiter;
+
+    void setPins(uint8_t miso, uint8_t mosi, uint8_t sck) {
+        spi.setPins(miso, mosi, sck);
+    }
+
+    // Every module on the bus must be deselected before any of them is talked to,
+    // otherwise a module that has not had begin() yet sees the traffic with a floating CS
+    void addDevice(uint8_t cs) {
+        pinMode(cs, OUTPUT);
+        digitalWrite(cs, HIGH);
+    }
+};
+
 class Rfm69Common {
 private:
-    uint8_t pin_miso;
-    uint8_t pin_mosi;
-    uint8_t pin_sck;
     uint8_t pin_cs;
     uint8_t pin_irq;
     uint8_t pin_rst;
 
     // This is hacky but it lets us avoid having any RH code in main
-    std::unique_ptr<RHSoftwareSPI> spi;
-    std::unique_ptr<RH_RF69> rfm69module;
+    // The driver (and the bus, when we own it) are constructed in place once the pins are known,
+    // there is no heap allocation, see rambudget.h
+    StaticSlot<Rfm69Bus> ownBus;
+    Rfm69Bus* bus = nullptr;
+    StaticSlot<RH_RF69> rfm69module;
+    uint8_t packetConfig2 = RH_RF69_PACKETCONFIG2_AUTORXRESTARTON;
+    float frequency = 0;
+    uint8_t rssiThreshold = 0;  // 0: leave the reset value
+
+    // Packet mode, see setPacketMode(); syncBytes 0 is continuous mode
+    uint8_t sync[8] = {};
+    uint8_t syncBytes = 0;
+    uint8_t syncTolerance = 0;
+    uint8_t payloadBytes = 0;
+    uint8_t rxTimeout = 0;
+    bool bitSync = false;       // continuous mode with the bit synchroniser, see setBitSync()
+
+    // Everything configure() writes, so RadioHealth can check it and put back just what drifted
+    RegisterShadow<RADIO_SHADOW_REGISTERS> configured;
+
+    // Caller holds the bus lock
+    void writeConfig(uint8_t reg, uint8_t value) {
+        rfm69module->spiWrite(reg, value);
+        configured.record(reg, value);
+    }
+
+    void recordFrf(uint32_t frf) {
+        configured.record(RH_RF69_REG_07_FRFMSB, uint8_t(frf >> 16));
+        configured.record(RH_RF69_REG_08_FRFMID, uint8_t(frf >> 8));
+        configured.record(RH_RF69_REG_09_FRFLSB, uint8_t(frf));
+    }
 
 public:
     Rfm69Common() {}
 
+    // Single module on its own pins
     void setPins(uint8_t miso, uint8_t mosi, uint8_t sck, uint8_t cs, uint8_t irq, uint8_t rst) {
-      pin_miso = miso;
-      pin_mosi = mosi;
-      pin_sck = sck;
+      ownBus.emplace();
+      ownBus->setPins(miso, mosi, sck);
+      setBus(*ownBus, cs, irq, rst);
+    }
+
+    // Module on a bus that may be shared with other modules
+    void setBus(Rfm69Bus& b, uint8_t cs, uint8_t irq, uint8_t rst) {
+      bus = &b;
       pin_cs = cs;
       pin_irq = irq;
       pin_rst = rst;
+      bus->addDevice(cs);
     }
 
     uint8_t readRSSIByte() const {
+        SpiArbiter::Lock lock(bus->arbiter);
         return rfm69module->spiRead(RH_RF69_REG_24_RSSIVALUE);
     }
 
-    void begin(float frequency) {
-        spi.reset(new RHSoftwareSPI());
-        spi->setPins(pin_miso, pin_mosi, pin_sck);
+    const SpiArbiter::Stats& busStats() const { return bus->arbiter.stats(); }
+
+    // FRF register value for a frequency; one step is FXOSC / 2^19, about 61Hz
+    static uint32_t frfForHz(uint32_t hz) {
+        return uint32_t((uint64_t(hz) << 19) / FXOSC);
+    }
+
+    // Retune while staying in RX, as fast as we can, for sweeping.
+    // All three FRF bytes go in one burst (the synthesiser only takes the new value when FrfLsb is written),
+    // then RestartRx so the PLL relocks and RSSI averaging starts again on the new channel
+    // (otherwise the first readings are still partly the previous channel).
+    // Two SPI transactions, no read-modify-write, PacketConfig2 is cached in begin()
+    void retune(uint32_t frf) {
+        const uint8_t frfBytes[3] = { uint8_t(frf >> 16), uint8_t(frf >> 8), uint8_t(frf) };
+        SpiArbiter::Lock lock(bus->arbiter);
+        rfm69module->spiBurstWrite(RH_RF69_REG_07_FRFMSB, frfBytes, 3);
+        rfm69module->spiWrite(RH_RF69_REG_3D_PACKETCONFIG2, packetConfig2 | RH_RF69_PACKETCONFIG2_RESTARTRX);
+        recordFrf(frf);
+    }
+
+    // See the RxBw table in the SX1231 manual; begin() sets 0x49 (100kHz, 4% DCC)
+    void setRxBandwidth(uint8_t rxbw) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        writeConfig(RH_RF69_REG_19_RXBW, rxbw);
+    }
+
+    // RSSI byte (-2 x dBm) above which RssiIrq is set, and DIO0 goes high; see squelch.h.
+    // Kept, so a full reset puts it back too
+    void setRssiThreshold(uint8_t value) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        rssiThreshold = value;
+        writeConfig(RH_RF69_REG_29_RSSITHRESH, value);
+    }
+
+    // Receive in packet mode instead (chipdecoder.h), before begin(): the bit synchroniser clocks the chips in,
+    // the radio matches them against the sync word (up to 8 bytes, with up to 7 chips wrong) and then
+    // puts payload bytes in the FIFO, and DIO0 is PayloadReady instead of RSSI.
+    // The sync search only starts once RSSI is over setRssiThreshold(), which also freezes the gain,
+    // so timeout (in 16 chips) restarts the receiver if no payload followed; the loop does that, see timedOut()
+    void setPacketMode(const uint8_t* syncWord, uint8_t bytes, uint8_t tolerance, uint8_t payload, uint8_t timeout) {
+        syncBytes = bytes > sizeof sync ? sizeof sync : bytes;
+        memcpy(sync, syncWord, syncBytes);
+        syncTolerance = tolerance & 7;
+        payloadBytes = payload;
+        rxTimeout = timeout;
+    }
+
+    bool packetMode() const { return syncBytes != 0; }
+
+    // Continuous mode with the bit synchroniser on instead, before begin(): DIO2 is then the data re-timed
+    // to the recovered chip clock, which comes out as DCLK on DIO1 (data is valid on its rising edge).
+    // The clock free runs at the bit rate between transmissions. See apps/oregon-dclk
+    void setBitSync(bool on) {
+        bitSync = on;
+    }
 
-        rfm69module.reset(new RH_RF69(pin_cs, pin_irq, *spi));
+    // Packet mode: after PayloadReady, the payload; the receiver restarts by itself once the FIFO is empty
+    void readFifo(uint8_t* buf, uint8_t len) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        rfm69module->spiBurstRead(RH_RF69_REG_00_FIFO, buf, len);
+    }
+
+    // Packet mode: RSSI went over the threshold and no payload came within the timeout.
+    // The flag only clears on a restart, so this restarts the receiver too
+    bool timedOut() {
+        SpiArbiter::Lock lock(bus->arbiter);
+        if (!(rfm69module->spiRead(RH_RF69_REG_27_IRQFLAGS1) & RH_RF69_IRQFLAGS1_TIMEOUT)) return false;
+        rfm69module->spiWrite(RH_RF69_REG_3D_PACKETCONFIG2, packetConfig2 | RH_RF69_PACKETCONFIG2_RESTARTRX);
+        return true;
+    }
 
-        // Reset the module first.
+    // Register access and recovery for RadioHealth (radiohealth.h)
+    uint8_t readReg(uint8_t reg) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        return rfm69module->spiRead(reg);
+    }
+
+    void writeReg(uint8_t reg, uint8_t value) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        rfm69module->spiWrite(reg, value);
+    }
+
+    RegisterShadow<RADIO_SHADOW_REGISTERS>& shadow() { return configured; }
+
+    void restartRx() {
+        SpiArbiter::Lock lock(bus->arbiter);
+        rfm69module->spiWrite(RH_RF69_REG_3D_PACKETCONFIG2, packetConfig2 | RH_RF69_PACKETCONFIG2_RESTARTRX);
+    }
+
+    // The hard way: reset pulse and the whole configuration again.
+    // Not init() again: each RH_RF69 init() takes the next of RadioHead's interrupt slots (it never gives
+    // one back, and past the third it writes out of bounds and fails from then on), and attaches its
+    // DIO0 ISR again over the apps' pinhal one. The driver from begin() is kept, and only the registers redone
+    bool fullReset() {
+        SpiArbiter::Lock lock(bus->arbiter);
+        pulseReset();
+        return driverDefaults() && configure();
+    }
+
+    void begin(float frequencyMHz) {
+        SpiArbiter::Lock lock(bus->arbiter);
+        frequency = frequencyMHz;
+        rfm69module.emplace(pin_cs, pin_irq, bus->spi);
+        pulseReset();
+        if (!rfm69module->init()) {
+            panic("Failed to initialise the RFM69 - probably this is a SPI problem");
+        }
+        // RadioHead attaches its packet mode ISR to DIO0, which reads the IRQ flags over SPI
+        // from interrupt context. We never use RH packet handling, and an SPI transaction inside an ISR
+        // would tear whatever transaction the loop was in the middle of (on any module on the bus),
+        // so take it off again. DIO0 is then free for the apps to use (it is mapped to RSSI below).
+        detachInterrupt(digitalPinToInterrupt(pin_irq));
+        configure();
+    }
+
+private:
+    // Caller holds the bus lock
+    void pulseReset() {
         // From the SX1231 data sheet, pulse RST for 100 uS then wait at least 5 ms
         // We go a bit longer to make sure
         printf("SX1231 reset...\n");
         pinMode(pin_rst, OUTPUT);
         digitalWrite(pin_rst, HIGH); delay(10);
         digitalWrite(pin_rst, LOW); delay(10);
-        if (!rfm69module->init()) {
-            panic("Failed to initialise the RFM69 - probably this is a SPI problem");
+    }
+
+    // What RH_RF69::init() writes after the reset, less the interrupt, so a full reset starts
+    // configure() from the same place begin() did (the chip is back at its power on values)
+    bool driverDefaults() {
+        uint8_t version = rfm69module->spiRead(RH_RF69_REG_10_VERSION);
+        if (version == 0x00 || version == 0xff) {
+            return false;
         }
+        // Also tells RadioHead it is no longer in RX, or setModeRx() at the end of configure() would do nothing
+        rfm69module->setModeIdle();
+        rfm69module->spiWrite(RH_RF69_REG_3C_FIFOTHRESH, RH_RF69_FIFOTHRESH_TXSTARTCONDITION_NOTEMPTY | 0x0f);
+        rfm69module->spiWrite(RH_RF69_REG_6F_TESTDAGC, RH_RF69_TESTDAGC_CONTINUOUSDAGC_IMPROVED_LOWBETAOFF);
+        rfm69module->setModemConfig(RH_RF69::GFSK_Rb250Fd250);
+        rfm69module->setPreambleLength(4);
+        const uint8_t syncwords[] = { 0x2d, 0xd4 };
+        rfm69module->setSyncWords(syncwords, sizeof syncwords);
+        rfm69module->setEncryptionKey(nullptr);
+        return true;
+    }
+
+    // Everything of ours on top of RadioHead's defaults; caller holds the bus lock
+    bool configure() {
+        configured.clear();
 
         // Tune the receiver
         rfm69module->setFrequency(frequency);
+        recordFrf((uint32_t(rfm69module->spiRead(RH_RF69_REG_07_FRFMSB)) << 16) |
+                  (uint32_t(rfm69module->spiRead(RH_RF69_REG_08_FRFMID)) << 8) |
+                  rfm69module->spiRead(RH_RF69_REG_09_FRFLSB));
 
         // Configure the modem
         // Note, RadioHead has a function for this where you create a register structure
@@ -77,10 +267,19 @@ public:
 
         // Enable continuous OOK mode without bit synchronisation,
         // because we are trying to receive OOK transmissions from anywhere
+        // (or packet mode, where the chips are bits, see setPacketMode(); or with it, see setBitSync())
         const uint8_t MODEM_CONFIG_OOK_CONT_NO_SYNC =
             RH_RF69_DATAMODUL_DATAMODE_CONT_WITHOUT_SYNC |
             RH_RF69_DATAMODUL_MODULATIONTYPE_OOK |
             RH_RF69_DATAMODUL_MODULATIONSHAPING_OOK_NONE;
+        const uint8_t MODEM_CONFIG_OOK_CONT_SYNC =
+            RH_RF69_DATAMODUL_DATAMODE_CONT_WITH_SYNC |
+            RH_RF69_DATAMODUL_MODULATIONTYPE_OOK |
+            RH_RF69_DATAMODUL_MODULATIONSHAPING_OOK_NONE;
+        const uint8_t MODEM_CONFIG_OOK_PACKET =
+            RH_RF69_DATAMODUL_DATAMODE_PACKET |
+            RH_RF69_DATAMODUL_MODULATIONTYPE_OOK |
+            RH_RF69_DATAMODUL_MODULATIONSHAPING_OOK_NONE;
 
         // Set the bandwidth to 100kHz with 4% DC cancellation
         // See SX1231 manual - Channel Filter - pages ~27,28
@@ -95,10 +294,11 @@ public:
         const byte brLSB = (FXOSC / OOK_BITRATE) & 0xff;
         const byte brMSB = ((FXOSC / OOK_BITRATE) >> 8) & 0xff;    
 
-        rfm69module->spiWrite(RH_RF69_REG_02_DATAMODUL, MODEM_CONFIG_OOK_CONT_NO_SYNC);
-        rfm69module->spiWrite(RH_RF69_REG_03_BITRATEMSB, brMSB);
-        rfm69module->spiWrite(RH_RF69_REG_04_BITRATELSB, brLSB);
-        rfm69module->spiWrite(RH_RF69_REG_19_RXBW, MODEM_CONFIG_BW_100k_DCC_1);
+        writeConfig(RH_RF69_REG_02_DATAMODUL, packetMode() ? MODEM_CONFIG_OOK_PACKET :
+                                              bitSync ? MODEM_CONFIG_OOK_CONT_SYNC : MODEM_CONFIG_OOK_CONT_NO_SYNC);
+        writeConfig(RH_RF69_REG_03_BITRATEMSB, brMSB);
+        writeConfig(RH_RF69_REG_04_BITRATELSB, brLSB);
+        writeConfig(RH_RF69_REG_19_RXBW, MODEM_CONFIG_BW_100k_DCC_1);
 
         // To help calibrate our logic analyser, output a 1MHz frequency on DIO5 (This is FXOSC/32)
         // Also the RSSI state on DIO0  + OOK on DIO2 ( which is the same for all values in continous)
@@ -107,11 +307,16 @@ public:
         // See Table21 in the SX1231 manual
         byte dmap1 = rfm69module->spiRead(RH_RF69_REG_25_DIOMAPPING1);
         dmap1 = (dmap1 & 0xfc) | 2; // DIO0: bits 0-1 --> 10 == RSSI
-        rfm69module->spiWrite(RH_RF69_REG_25_DIOMAPPING1, dmap1);
+        if (packetMode()) {
+            dmap1 = (dmap1 & 0xfc) | 1; // In packet mode 01 == PayloadReady (10 would be SyncAddress)
+        } else if (bitSync) {
+            dmap1 = dmap1 & 0xcf;       // DIO1: bits 4-5 --> 00 == DCLK in continuous mode
+        }
+        writeConfig(RH_RF69_REG_25_DIOMAPPING1, dmap1);
 
         byte dmap2 = rfm69module->spiRead(RH_RF69_REG_26_DIOMAPPING2);
         dmap2 = (dmap2 & 0x38) | 5; // Clock out frequency bits 0-2 --> 101, DIO5 bits 7-6 --> 00 == clock 
-        rfm69module->spiWrite(RH_RF69_REG_26_DIOMAPPING2, dmap2);
+        writeConfig(RH_RF69_REG_26_DIOMAPPING2, dmap2);
 
         // With a good guess of the RSSI threshold value ESTIMATED_TRIGGER_RSSI_DB
         // it is not necessary to use the peak detector
@@ -119,12 +324,31 @@ public:
         // as well as right nearby
         if (OOK_USE_FIXED_PEAK_DETECTOR) {
             printf("ASK threshold is fixed to %ddB above the floor\n", OOK_FIXED_PEAK_DETECT_THRESHOLD_DB);
-            rfm69module->spiWrite(RH_RF69_REG_1B_OOKPEAK, 0); // bits 6-7 default 0x40 (peak), 00 (fixed), 10 (av)
-            rfm69module->spiWrite(RH_RF69_REG_1D_OOKFIX, OOK_FIXED_PEAK_DETECT_THRESHOLD_DB);
+            writeConfig(RH_RF69_REG_1B_OOKPEAK, 0); // bits 6-7 default 0x40 (peak), 00 (fixed), 10 (av)
+            writeConfig(RH_RF69_REG_1D_OOKFIX, OOK_FIXED_PEAK_DETECT_THRESHOLD_DB);
         } else {
             printf("ASK threshold is relative to background RSSI\n");
         }
 
+        if (rssiThreshold) {
+            writeConfig(RH_RF69_REG_29_RSSITHRESH, rssiThreshold);
+        }
+
+        // Packet mode: sync word on, fixed length, no DC free coding, CRC or address (none of it is ours)
+        // The FIFO fills from the sync match (FifoFillCondition 0)
+        if (packetMode()) {
+            writeConfig(RH_RF69_REG_2E_SYNCCONFIG, RH_RF69_SYNCCONFIG_SYNCON | ((syncBytes - 1) << 3) | syncTolerance);
+            for (uint8_t i = 0; i < syncBytes; i++) {
+                writeConfig(RH_RF69_REG_2F_SYNCVALUE1 + i, sync[i]);
+            }
+            writeConfig(RH_RF69_REG_37_PACKETCONFIG1, RH_RF69_PACKETCONFIG1_DCFREE_NONE | RH_RF69_PACKETCONFIG1_ADDRESSFILTERING_NONE);
+            writeConfig(RH_RF69_REG_38_PAYLOADLENGTH, payloadBytes);
+            writeConfig(RH_RF69_REG_2B_RXTIMEOUT2, rxTimeout);
+        }
+
+        // Kept for retune(), so a restart does not need a read first
+        packetConfig2 = rfm69module->spiRead(RH_RF69_REG_3D_PACKETCONFIG2) & ~RH_RF69_PACKETCONFIG2_RESTARTRX;
+
         // Read back the current operating mode & confirm we set the data mode succesfully
         byte opMode = rfm69module->spiRead(RH_RF69_REG_01_OPMODE);
         byte datMode = rfm69module->spiRead(RH_RF69_REG_02_DATAMODUL);
@@ -136,7 +360,10 @@ public:
 
         printf("Start receiving.\n");
         rfm69module->setModeRx();
+        return true;
     }
 };
 
+RAM_BUDGET_CHECK(Rfm69Common, RAM_BUDGET_RADIO);
+
 #endif
@@ -0,0 +1,167 @@
+#ifndef APPS_RSSICODEC_H_
+#define APPS_RSSICODEC_H_
+
+// Lossless packing of RSSI samples, for ook-scope's STREAM_MODE and host/rssi-stream
+//
+// Consecutive RSSI bytes are mostly within a step or two of each other, the noise floor wandering,
+// with a jump at the start and end of a transmission. So a block is the first sample as is, then
+// each difference from the one before, zigzagged (0,-1,1,-2.. to 0,1,2,3..) and Rice coded: z >> k
+// in unary (that many 1s and a 0), then the low k bits. k is chosen per block, by trying each, so
+// quiet blocks come out at one or two bits a sample and busy ones still don't blow up. A difference
+// that would need RSSI_RICE_ESCAPE or more 1s is sent as the escape and then 9 bits of z instead.
+// Bits are first in the top of each byte.
+//
+// Block layout: first sample, k, then the bits. If those come out bigger than the samples themselves,
+// k is RSSI_RICE_RAW and the rest of the samples follow as they are, so a block is never more than
+// RSSI_BLOCK_MAX_BYTES however noisy it was. No SDK dependency, the host decodes with the same code.
+
+#include <stdint.h>
+#include <string.h>
+
+#define RSSI_BLOCK_SAMPLES 256
+#define RSSI_BLOCK_MAX_BYTES (RSSI_BLOCK_SAMPLES + 1)
+#define RSSI_RICE_MAX_K 7
+#define RSSI_RICE_ESCAPE 16
+#define RSSI_RICE_RAW 0xff
+
+inline uint16_t rssiZigzag(uint8_t prev, uint8_t cur) {
+    int d = int(cur) - int(prev);
+    return d < 0 ? uint16_t(-2 * d - 1) : uint16_t(2 * d);
+}
+
+inline uint32_t rssiRiceBits(uint16_t z, int k) {
+    uint32_t q = z >> k;
+    return q < RSSI_RICE_ESCAPE ? q + 1 + k : RSSI_RICE_ESCAPE + 9;
+}
+
+// A byte at a time out of an accumulator; at 10k samples a second the Pico can't spend long per bit
+class RssiBitWriter {
+    uint8_t* out;
+    uint32_t max;
+    uint32_t pos = 0;
+    uint32_t acc = 0;
+    int nacc = 0;
+
+public:
+    RssiBitWriter(uint8_t* out, uint32_t maxBytes) : out(out), max(maxBytes) {}
+
+    // n up to 24
+    void put(uint32_t v, int n) {
+        acc = acc << n | (v & ((1u << n) - 1));
+        nacc += n;
+        while (nacc >= 8) {
+            nacc -= 8;
+            if (pos < max) out[pos++] = uint8_t(acc >> nacc);
+        }
+    }
+    uint32_t flush() {
+        if (nacc && pos < max) out[pos++] = uint8_t(acc << (8 - nacc));
+        nacc = 0;
+        return pos;
+    }
+};
+
+class RssiBitReader {
+    const uint8_t* in;
+    uint32_t max;
+    uint32_t bits = 0;
+
+public:
+    RssiBitReader(const uint8_t* in, uint32_t bytes) : in(in), max(bytes * 8) {}
+
+    // false once it has run off the end
+    bool get(int n, uint32_t& v) {
+        v = 0;
+        while (n--) {
+            if (bits >= max) return false;
+            v = v << 1 | ((in[bits >> 3] >> (7 - (bits & 7))) & 1);
+            bits++;
+        }
+        return true;
+    }
+    uint32_t bytes() const { return (bits + 7) / 8; }
+};
+
+// The bits each k would take, added up as the samples come in, so ook-scope doesn't have to go over
+// the block eight times in the one poll period it ends in
+struct RssiRiceCost {
+    uint32_t bits[RSSI_RICE_MAX_K + 1] = {};
+
+    void clear() { memset(bits, 0, sizeof bits); }
+    void add(uint8_t prev, uint8_t cur) {
+        uint16_t z = rssiZigzag(prev, cur);
+        for (int k = 0; k <= RSSI_RICE_MAX_K; k++) bits[k] += rssiRiceBits(z, k);
+    }
+    int best() const {
+        int k = 0;
+        for (int t = 1; t <= RSSI_RICE_MAX_K; t++) if (bits[t] < bits[k]) k = t;
+        return k;
+    }
+};
+
+// n (1..RSSI_BLOCK_SAMPLES) samples, with cost over all of them, into out, which has room for
+// RSSI_BLOCK_MAX_BYTES; returns the bytes used
+inline uint32_t rssiEncodeBlock(const uint8_t* samples, int n, const RssiRiceCost& cost, uint8_t* out) {
+    out[0] = samples[0];
+    int k = cost.best();
+    // Coded is no smaller than the samples as they are
+    if ((cost.bits[k] + 7) / 8 >= uint32_t(n - 1)) {
+        out[1] = RSSI_RICE_RAW;
+        memcpy(out + 2, samples + 1, n - 1);
+        return uint32_t(n + 1);
+    }
+    out[1] = uint8_t(k);
+    RssiBitWriter w(out + 2, RSSI_BLOCK_MAX_BYTES - 2);
+    for (int i = 1; i < n; i++) {
+        uint16_t z = rssiZigzag(samples[i - 1], samples[i]);
+        uint32_t q = z >> k;
+        if (q < RSSI_RICE_ESCAPE) {
+            w.put(((1u << (q + 1)) - 2) << k | (z & ((1u << k) - 1)), int(q + 1) + k);
+        } else {
+            w.put((1u << RSSI_RICE_ESCAPE) - 1, RSSI_RICE_ESCAPE);
+            w.put(z, 9);
+        }
+    }
+    return 2 + w.flush();
+}
+
+inline uint32_t rssiEncodeBlock(const uint8_t* samples, int n, uint8_t* out) {
+    RssiRiceCost cost;
+    for (int i = 1; i < n; i++) cost.add(samples[i - 1], samples[i]);
+    return rssiEncodeBlock(samples, n, cost, out);
+}
+
+// Back to exactly n samples; false if the block doesn't decode to that, all of it and no more
+inline bool rssiDecodeBlock(const uint8_t* in, uint32_t bytes, int n, uint8_t* samples) {
+    if (bytes < 2 || n < 1 || n > RSSI_BLOCK_SAMPLES) return false;
+    samples[0] = in[0];
+    if (in[1] == RSSI_RICE_RAW) {
+        if (bytes != uint32_t(n + 1)) return false;
+        memcpy(samples + 1, in + 2, n - 1);
+        return true;
+    }
+    int k = in[1];
+    if (k > RSSI_RICE_MAX_K) return false;
+    RssiBitReader r(in + 2, bytes - 2);
+    for (int i = 1; i < n; i++) {
+        uint32_t q = 0, b, z;
+        while (q < RSSI_RICE_ESCAPE) {
+            if (!r.get(1, b)) return false;
+            if (!b) break;
+            q++;
+        }
+        if (q < RSSI_RICE_ESCAPE) {
+            if (!r.get(k, z)) return false;
+            z |= q << k;
+        } else if (!r.get(9, z)) {
+            return false;
+        }
+        int d = (z & 1) ? -int((z + 1) >> 1) : int(z >> 1);
+        int s = samples[i - 1] + d;
+        if (s < 0 || s > 255) return false;
+        samples[i] = uint8_t(s);
+    }
+    return r.bytes() == bytes - 2;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef APPS_RTL433_H_
+#define APPS_RTL433_H_
+
+// Readings as rtl_433 prints them with -F json, so whatever was reading rtl_433 can read us instead
+//
+// Same keys, model names and units as the rtl_433 oregon_scientific decoder:
+//   {"time" : "2022-07-01 12:00:00", "model" : "Oregon-THGR122N", "id" : 39, "channel" : 1,
+//    "battery_ok" : 1, "temperature_C" : 14.500, "humidity" : 75}
+// "id" is the rolling code (rtl_433's "House Code"), THN132N has no humidity.
+// time is left out when it is null (the Pico has no wall clock; like rtl_433 -M time:off), the host
+// tools fill it in. No SDK dependency.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// rtl_433's name for a type as decodeTempHumidity() reports it, or nullptr if it has none we know
+inline const char* rtl433Model(uint16_t type) {
+    switch (type) {
+        case 0x1d20: return "Oregon-THGR122N";
+        case 0xec40: return "Oregon-THN132N";
+        default: return nullptr;
+    }
+}
+
+// One JSON object, no newline; returns the length as snprintf does, or 0 for a type rtl_433 doesn't name
+inline int rtl433Json(char* buf, size_t size, const char* time, uint16_t type, uint8_t channel, uint8_t rollingCode,
+                      int16_t temp, uint8_t hum, bool battOK) {
+    const char* model = rtl433Model(type);
+    if (!model) return 0;
+    int n = 0;
+    n += snprintf(buf, size, "{");
+    if (time) n += snprintf(buf + n, size > size_t(n) ? size - n : 0, "\"time\" : \"%s\", ", time);
+    // rtl_433 prints doubles with three decimals
+    int t = temp < 0 ? -temp : temp;
+    n += snprintf(buf + n, size > size_t(n) ? size - n : 0,
+        "\"model\" : \"%s\", \"id\" : %u, \"channel\" : %u, \"battery_ok\" : %d, \"temperature_C\" : %s%d.%d00",
+        model, rollingCode, channel, battOK ? 1 : 0, temp < 0 ? "-" : "", t / 10, t % 10);
+    if (type == 0x1d20) n += snprintf(buf + n, size > size_t(n) ? size - n : 0, ", \"humidity\" : %u", hum);
+    n += snprintf(buf + n, size > size_t(n) ? size - n : 0, "}");
+    return n;
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef APPS_SENSORSTATS_H_
+#define APPS_SENSORSTATS_H_
+
+// Per sensor reception counters
+//
+// The output only shows the readings that made it, so there is no telling whether a change to the
+// antenna, the threshold or the firmware got us more of them. Oregon sensors are regular though:
+// every reading is sent twice ~10ms apart, and again every 39-43s depending on channel. So from
+// the frames that do arrive we can learn each sensor's period and work out how many we should have had.
+//
+// For each sensor (keyed on the first four bytes: type, channel, rolling code) this counts
+//   received    readings, the first good copy of each cycle
+//   duplicate   the second copy of the pair came through too
+//   bad         frames with this sensor's header that failed the checksum
+//   missed      cycles with nothing at all, from the gap since the last reading and the learned period
+// plus a histogram of RSSI in 5dB steps and when it was last heard. The yield is received out of
+// received + missed; a cycle that is overdue right now counts as missed in the dump too.
+//
+// The table is a small open addressing hash, so frame() is a multiply and usually one compare.
+// When it is full, the sensor not heard from for longest is dropped. No SDK dependency, host tools use it too.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "oregon.h"
+
+#define SENSOR_STATS_SLOTS 32        // power of two
+#define SENSOR_PAIR_WINDOW_MS 1500
+#define SENSOR_RSSI_BUCKETS 8
+// Cycles are at least this far apart; and the first period is only believed if under the max
+#define SENSOR_MIN_PERIOD_MS 20000
+#define SENSOR_MAX_PERIOD_MS 60000
+// How late a cycle can be before it counts as missed in the dump
+#define SENSOR_LATE_MS 3000
+
+class SensorStats {
+public:
+    struct Sensor {
+        uint32_t key;               // data[0..3] as the decoder has them; 0 is a free slot
+        uint32_t firstSeen_ms;
+        uint32_t lastFrame_ms;      // either copy
+        uint32_t lastReading_ms;    // first copy of the latest cycle
+        uint32_t period_ms;         // 0 until learned
+        uint32_t received;
+        uint32_t duplicate;
+        uint32_t bad;
+        uint32_t missed;
+        uint32_t rssiSum;           // of the readings, RSSI bytes
+        uint8_t rssiMin;            // bytes, so min is the strongest
+        uint8_t rssiMax;
+        uint16_t rssiHist[SENSOR_RSSI_BUCKETS];     // <= -100dBm, then 5dB steps, >= -70dBm
+    };
+
+    struct Totals {
+        uint32_t frames;
+        uint32_t unknownBad;        // failed the checksum and the header is no sensor we know
+        uint32_t evicted;
+    };
+
+private:
+    Sensor table[SENSOR_STATS_SLOTS] = {};
+    Totals tot = {};
+
+    static uint32_t keyOf(const uint8_t* data) {
+        uint32_t k = uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+        // (no real header is all zeros, but keep 0 for free)
+        return k ? k : 1;
+    }
+
+    static unsigned slotOf(uint32_t key) {
+        return (key * 2654435761u) >> 27 & (SENSOR_STATS_SLOTS - 1);
+    }
+
+    // The sensor's slot, a free one for it, or -1
+    int find(uint32_t key) const {
+        unsigned s = slotOf(key);
+        for (int i = 0; i < SENSOR_STATS_SLOTS; i++, s = (s + 1) & (SENSOR_STATS_SLOTS - 1)) {
+            if (table[s].key == key || table[s].key == 0) return int(s);
+        }
+        return -1;
+    }
+
+    int add(uint32_t key, uint32_t now_ms) {
+        int s = find(key);
+        if (s < 0) {
+            // Full: the one not heard from for longest goes (a battery change gives a new rolling code)
+            s = 0;
+            for (int i = 1; i < SENSOR_STATS_SLOTS; i++) {
+                if (now_ms - table[i].lastFrame_ms > now_ms - table[s].lastFrame_ms) s = i;
+            }
+            tot.evicted++;
+        }
+        if (table[s].key != key) {
+            memset(&table[s], 0, sizeof table[s]);
+            table[s].key = key;
+            table[s].firstSeen_ms = now_ms;
+            table[s].rssiMin = 0xff;
+        }
+        return s;
+    }
+
+    // Cycles that were due and have not come, as of now
+    static uint32_t overdue(const Sensor& s, uint32_t now_ms) {
+        if (!s.period_ms) return 0;
+        uint32_t since = now_ms - s.lastReading_ms;
+        return since > SENSOR_LATE_MS ? (since - SENSOR_LATE_MS) / s.period_ms : 0;
+    }
+
+public:
+    // Every frame the decoder produced (or collision.h recovered), good checksum or not, with the RSSI byte
+    void frame(const uint8_t* data, uint8_t len, bool ok, uint8_t rssi, uint32_t now_ms) {
+        tot.frames++;
+        if (len < 4 || !checkedLength(data, len)) {
+            if (!ok) tot.unknownBad++;
+            return;
+        }
+        uint32_t key = keyOf(data);
+        if (!ok) {
+            // Only put it down to a sensor we have heard properly; a bad header would make up a new one
+            int s = find(key);
+            if (s >= 0 && table[s].key == key) {
+                table[s].bad++;
+                table[s].lastFrame_ms = now_ms;
+            } else {
+                tot.unknownBad++;
+            }
+            return;
+        }
+
+        Sensor& s = table[add(key, now_ms)];
+        bool first = s.received == 0;
+        uint32_t since = now_ms - s.lastReading_ms;
+        s.lastFrame_ms = now_ms;
+        if (!first && since < SENSOR_PAIR_WINDOW_MS) {
+            s.duplicate++;
+            return;
+        }
+        if (!first && since >= SENSOR_MIN_PERIOD_MS) {
+            if (!s.period_ms) {
+                if (since < SENSOR_MAX_PERIOD_MS) s.period_ms = since;
+            } else {
+                uint32_t k = (since + s.period_ms / 2) / s.period_ms;
+                if (k >= 2) s.missed += k - 1;
+                if (k >= 1) {
+                    // Follow the crystal slowly, and ignore anything that does not fit at all
+                    int32_t err = int32_t(since / k) - int32_t(s.period_ms);
+                    if (err > -2000 && err < 2000) s.period_ms += err / 4;
+                }
+            }
+        }
+        s.received++;
+        s.lastReading_ms = now_ms;
+        s.rssiSum += rssi;
+        if (rssi < s.rssiMin) s.rssiMin = rssi;
+        if (rssi > s.rssiMax) s.rssiMax = rssi;
+        int b = rssi >= 210 ? 0 : (210 - rssi) / 10;
+        if (b >= SENSOR_RSSI_BUCKETS) b = SENSOR_RSSI_BUCKETS - 1;
+        if (s.rssiHist[b] != 0xffff) s.rssiHist[b]++;
+    }
+
+    const Totals& totals() const { return tot; }
+
+    // Sensors in the table, in slot order
+    template <typename Fn>
+    int forEach(Fn fn) const {
+        int n = 0;
+        for (const Sensor& s : table) {
+            if (s.key) {
+                fn(s);
+                n++;
+            }
+        }
+        return n;
+    }
+
+    // Missed including the cycles overdue now
+    static uint32_t missedNow(const Sensor& s, uint32_t now_ms) { return s.missed + overdue(s, now_ms); }
+
+    static float yield(const Sensor& s, uint32_t now_ms) {
+        uint32_t expected = s.received + missedNow(s, now_ms);
+        return expected ? 100.0f * s.received / expected : 0;
+    }
+
+    // The sensor as decodeTempHumidity() would report it
+    static void identity(const Sensor& s, uint16_t& type, uint8_t& channel, uint8_t& rollingCode) {
+        uint8_t d[4] = { uint8_t(s.key >> 24), uint8_t(s.key >> 16), uint8_t(s.key >> 8), uint8_t(s.key) };
+        type = uint16_t((d[0] >> 4) << 12 | (d[1] & 0xf) << 8 | (d[1] >> 4) << 4 | (d[2] & 0xf));
+        channel = d[2] >> 4;
+        rollingCode = uint8_t((d[3] & 0xf) << 4 | d[3] >> 4);
+    }
+
+    // One line per sensor and a total, all starting "S ", for the serial console:
+    //   S <type>,<ch>,<rolling> rx dup bad miss yield% period_s last_s rssi min/avg/max dBm, histogram weakest first
+    void dump(uint32_t now_ms) const {
+        uint32_t rx = 0, miss = 0;
+        int n = forEach([&](const Sensor& s) {
+            uint16_t type;
+            uint8_t channel, rollingCode;
+            identity(s, type, channel, rollingCode);
+            uint32_t m = missedNow(s, now_ms);
+            rx += s.received;
+            miss += m;
+            printf("S %04x,%d,%02x rx=%lu dup=%lu bad=%lu miss=%lu yield=%.1f%% period=%.1fs last=%lus rssi=%.1f/%.1f/%.1f hist=",
+                type, channel, rollingCode, (unsigned long)s.received, (unsigned long)s.duplicate, (unsigned long)s.bad,
+                (unsigned long)m, yield(s, now_ms), s.period_ms / 1000.0, (unsigned long)((now_ms - s.lastFrame_ms) / 1000),
+                s.rssiMax / -2.0, s.received ? double(s.rssiSum) / s.received / -2.0 : 0.0, s.rssiMin / -2.0);
+            for (int b = 0; b < SENSOR_RSSI_BUCKETS; b++) printf(b ? ".%u" : "%u", s.rssiHist[b]);
+            printf("\n");
+        });
+        printf("S total sensors=%d rx=%lu miss=%lu yield=%.1f%% frames=%lu unknown_bad=%lu evicted=%lu\n", n,
+            (unsigned long)rx, (unsigned long)miss, rx + miss ? 100.0 * rx / (rx + miss) : 0.0, (unsigned long)tot.frames,
+            (unsigned long)tot.unknownBad, (unsigned long)tot.evicted);
+    }
+};
+
+#endif
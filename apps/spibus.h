@@ -0,0 +1,80 @@
+#ifndef APPS_SPIBUS_H_
+#define APPS_SPIBUS_H_
+
+// Arbitration for an SPI bus shared by more than one RFM69 module
+//
+// Each module has its own CS, so sharing MISO/MOSI/SCK is electrically fine,
+// but a transaction must not be interleaved with another one on the same bus -
+// e.g. the second core polling RSSI on module B while the first reconfigures module A.
+// Never take this from an ISR; the edge capture ISRs do not touch SPI.
+//
+// Also keeps contention statistics, which is what tells us if splitting the bus is worth the pins.
+// Builds on the host too (std::mutex) so the multi radio simulation exercises the same code.
+
+#include <stdint.h>
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include <pico/mutex.h>
+#include <pico/time.h>
+#else
+#include <mutex>
+#include "pinhal.h"
+#endif
+
+class SpiArbiter {
+public:
+    struct Stats {
+        uint32_t transactions;
+        uint32_t contended;     // had to wait for another user
+        uint64_t waited_us;
+    };
+
+private:
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+    mutex_t mtx;
+    static uint64_t now_us() { return time_us_64(); }
+    bool tryLock() { uint32_t owner; return mutex_try_enter(&mtx, &owner); }
+    void lock() { mutex_enter_blocking(&mtx); }
+    void unlock() { mutex_exit(&mtx); }
+#else
+    std::mutex mtx;
+    static uint64_t now_us() { return pinhal::micros64(); }
+    bool tryLock() { return mtx.try_lock(); }
+    void lock() { mtx.lock(); }
+    void unlock() { mtx.unlock(); }
+#endif
+    Stats st = { 0, 0, 0 };
+
+public:
+    SpiArbiter() {
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+        mutex_init(&mtx);
+#endif
+    }
+
+    void acquire() {
+        if (!tryLock()) {
+            uint64_t t0 = now_us();
+            lock();
+            st.contended++;
+            st.waited_us += now_us() - t0;
+        }
+        st.transactions++;
+    }
+
+    void release() { unlock(); }
+
+    const Stats& stats() const { return st; }
+    void resetStats() { st = { 0, 0, 0 }; }
+
+    class Lock {
+        SpiArbiter& a;
+    public:
+        explicit Lock(SpiArbiter& arb) : a(arb) { a.acquire(); }
+        ~Lock() { a.release(); }
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+    };
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef APPS_SQUELCH_H_
+#define APPS_SQUELCH_H_
+
+// RSSI squelch for the DIO2 edge interrupt
+//
+// With the OOK threshold following the noise floor there is always junk on DIO2, tens to hundreds of
+// edges a second, and with the interrupt live all the time every one of them costs an ISR and a trip
+// round the loop and the decoder. Most of the time there is nothing on the air at all.
+//
+// Rfm69Common maps DIO0 to RSSI, which is RssiIrq: set when the RSSI goes over RegRssiThresh.
+// So the DIO2 interrupt stays off until DIO0 rises; opened() is called from that ISR and turns it on.
+// RssiIrq is latched though, it does not drop again when the signal goes, so closing is done from
+// the loop: poll() reads RSSI about once a ms while open, and once it has stayed under the threshold
+// for the hang time (longer than the 10ms between the two of a pair) it turns DIO2 off again and
+// restarts the receiver, which clears RssiIrq so the next signal raises DIO0 again.
+//
+// Pre-roll: RSSI is averaged over a couple of chips, so DIO0 rises a little after the carrier came on,
+// and the first rising edge on DIO2 has already gone by. If DIO2 is high when the gate opens,
+// opened() gives back a time preroll_us before, to be taken as that edge, so the first pulse comes
+// out about the right length instead of the decoder seeing a partial one.
+// If DIO2 is low, the edge we missed was a whole pulse ago; the stale previous edge makes the next
+// width long and the decoder starts from a clean slate, which the preamble is long enough to cope with.
+//
+// Radio is Rfm69Common, or the stand in in host/squelch-sim: readRSSIByte(), restartRx(), setRssiThreshold().
+// DataIrq and RssiIrq are pinhal::EdgeIrq for DIO2 and DIO0 (rising), DataPin the pinhal::InputPin of DIO2.
+// Everything is counted, per gate setting, so the two can be compared on the same receiver (setGate()).
+
+#include <stdint.h>
+
+#include "pinhal.h"
+
+template <typename Radio, typename DataIrq, typename RssiIrq, typename DataPin>
+class Squelch {
+public:
+    struct Config {
+        uint8_t threshold = 180;        // RSSI byte, -2 x dBm
+        uint32_t hang_ms = 20;
+        uint32_t preroll_us = 1000;     // about two chips, the RSSI averaging
+        uint32_t poll_us = 1000;
+    };
+
+    // Accumulated while the gate is on / off, for the comparison
+    struct ModeStats {
+        uint32_t seconds;
+        uint32_t edges;         // DIO2 interrupts taken
+        uint32_t readings;
+    };
+
+    struct Stats {
+        uint32_t opens;
+        uint32_t prerolls;      // opened with DIO2 already high
+        uint32_t reopened;      // DIO0 rose while already open (after a receiver restart elsewhere)
+        uint64_t open_ms;
+        uint32_t longestOpen_ms;
+        ModeStats mode[2];      // [0] gate off, [1] gate on
+    };
+
+private:
+    Radio& radio;
+    Config cfg;
+    Stats st = {};
+    bool gate = false;
+    volatile bool isOpen = false;
+    volatile uint32_t opened_us = 0;
+    uint32_t lastPoll_us = 0;
+    uint32_t lastAbove_us = 0;
+    uint32_t lastEdges = 0;
+    uint32_t lastReadings = 0;
+
+    void close(uint32_t now_us) {
+        DataIrq::enable(false);
+        isOpen = false;
+        uint32_t open_ms = (now_us - opened_us) / 1000;
+        st.open_ms += open_ms;
+        if (open_ms > st.longestOpen_ms) st.longestOpen_ms = open_ms;
+        // Clears RssiIrq, DIO0 goes low again
+        radio.restartRx();
+    }
+
+public:
+    explicit Squelch(Radio& r) : radio(r) {}
+
+    Config& config() { return cfg; }
+    const Stats& stats() const { return st; }
+    bool gated() const { return gate; }
+    bool open() const { return isOpen; }
+
+    // After both interrupts are attached
+    void begin(bool on) {
+        radio.setRssiThreshold(cfg.threshold);
+        gate = !on;
+        setGate(on);
+    }
+
+    // Off: DIO2 live all the time and DIO0 ignored, as before
+    void setGate(bool on) {
+        if (on == gate) return;
+        gate = on;
+        if (isOpen) close(pinhal::micros32());
+        RssiIrq::enable(on);
+        DataIrq::enable(!on);
+        if (on) radio.restartRx();
+    }
+
+    // After the radio had a full reset (RadioHealth::onFullReset): RssiIrq was cleared with everything else,
+    // so a gate that was open would wait for a DIO0 edge that has already been and gone, or never comes.
+    // Close it, and arm DIO0 (and DIO2) again for the gate setting as it is
+    void radioReset() {
+        if (isOpen) close(pinhal::micros32());
+        RssiIrq::enable(gate);
+        DataIrq::enable(!gate);
+        if (gate) radio.restartRx();
+    }
+
+    // From the DIO0 rising edge ISR. Returns the time to take as the previous DIO2 edge, or 0 to leave it
+    uint32_t opened(uint32_t now_us) {
+        if (isOpen) {
+            st.reopened++;
+            return 0;
+        }
+        isOpen = true;
+        opened_us = now_us;
+        lastAbove_us = now_us;
+        st.opens++;
+        DataIrq::enable(true);
+        if (DataPin::read()) {
+            st.prerolls++;
+            // (never 0)
+            return (now_us - cfg.preroll_us) | 1;
+        }
+        return 0;
+    }
+
+    // From the loop, as often as it goes round. True when it has just closed: the decoder should be
+    // given the time since the last edge as a pulse then, or the frame in it only finishes at the next open
+    bool poll(uint32_t now_us) {
+        if (!gate || !isOpen || now_us - lastPoll_us < cfg.poll_us) return false;
+        lastPoll_us = now_us;
+        // Smaller is stronger
+        if (radio.readRSSIByte() <= cfg.threshold) {
+            lastAbove_us = now_us;
+        } else if (now_us - lastAbove_us >= cfg.hang_ms * 1000) {
+            close(now_us);
+            return true;
+        }
+        return false;
+    }
+
+    // Once a second, with the running totals of DIO2 interrupts and readings
+    void second(uint32_t edges, uint32_t readings) {
+        ModeStats& m = st.mode[gate ? 1 : 0];
+        m.seconds++;
+        m.edges += edges - lastEdges;
+        m.readings += readings - lastReadings;
+        lastEdges = edges;
+        lastReadings = readings;
+    }
+};
+
+#endif
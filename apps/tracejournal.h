@@ -0,0 +1,352 @@
+#ifndef APPS_TRACEJOURNAL_H_
+#define APPS_TRACEJOURNAL_H_
+
+// Journal of the pulse widths of failed decodes, in a ring at the end of flash
+//
+// When a frame fails its checksum out at a site, the widths are gone by the time anyone looks,
+// and the only way to see what happened is a logic analyser on DIO2. This keeps them instead:
+// the widths of the burst, when it was, its RSSI and why it was kept, one record each, so
+// they can be fetched over USB later and replayed through the host tools (host/journal-dump
+// writes them as width traces, see host/trace.h).
+//
+// Records:
+//   - a 16 byte header (magic, sequence number, time, reason, RSSI, width count, payload size),
+//     the widths, and a CRC16 over all of it
+//   - widths as the zigzag varint of the difference from the width two before (the same level),
+//     so a preamble is a byte a width and data mostly two; at most JOURNAL_RECORD_PAGES pages
+//   - each record starts on a page and doesn't cross a sector
+// Flash:
+//   - the sectors are used in turn round the ring, each erased just before it is first written,
+//     so they all wear the same; the oldest records go as the ring wraps
+//   - on boot the newest record is found by its sequence number and writing carries on from
+//     the next sector
+//   - erasing or programming stops the XIP flash, so interrupts are off for the duration and
+//     DIO2 edges are late. So add() only copies the record into RAM, and service() writes it a
+//     page (or one sector erase) per call, which the app only calls when the radio is quiet.
+//     Records are also rate limited (JOURNAL_BURST, then one per JOURNAL_REFILL_MS), so the
+//     flash time is bounded whatever the noise does; each op is timed and the worst kept in Stats
+//
+// The Flash is the storage:
+//   static constexpr uint32_t SECTOR, PAGE;  uint32_t size() const;
+//   void erase(uint32_t offset);  void program(uint32_t offset, const uint8_t* page);
+//   const uint8_t* read(uint32_t offset) const;
+// PicoFlash below on the device, or RAM in host/journal-dump. Offsets are from the start of the journal.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "pinhal.h"
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include <hardware/flash.h>
+#include <hardware/sync.h>
+#endif
+
+#define JOURNAL_MAGIC 0x4a54
+#define JOURNAL_HEADER_BYTES 16
+#define JOURNAL_RECORD_PAGES 4
+// Records allowed back to back, then one more per JOURNAL_REFILL_MS
+#define JOURNAL_BURST 4
+#define JOURNAL_REFILL_MS 15000
+
+enum JournalReason : uint8_t {
+    JOURNAL_CHECKSUM = 1,       // the decoder finished a frame, the checksum was wrong
+    JOURNAL_NO_FRAME,           // a burst long enough to be a transmission, and nothing came out of it
+};
+
+inline const char* journalReasonName(uint8_t reason) {
+    switch (reason) {
+        case JOURNAL_CHECKSUM: return "checksum";
+        case JOURNAL_NO_FRAME: return "no_frame";
+    }
+    return "?";
+}
+
+struct JournalHeader {
+    uint16_t magic;
+    uint8_t reason;
+    uint8_t rssi;           // RSSI register, -2 x dBm
+    uint32_t seq;
+    uint32_t time_ms;
+    uint16_t widths;
+    uint16_t bytes;         // payload, not counting the header or the CRC
+};
+static_assert(sizeof(JournalHeader) == JOURNAL_HEADER_BYTES, "JournalHeader layout");
+
+// CRC-16/CCITT, bitwise; a record is at most a kB, once per record
+inline uint16_t journalCrc(const uint8_t* p, uint32_t n, uint16_t crc = 0xffff) {
+    while (n--) {
+        crc ^= uint16_t(*p++) << 8;
+        for (int i = 0; i < 8; i++) crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ 0x1021) : uint16_t(crc << 1);
+    }
+    return crc;
+}
+
+// Widths to payload; returns the widths that fitted (all of them unless out runs out)
+inline uint16_t journalEncode(const uint16_t* widths, uint16_t n, uint8_t* out, uint16_t max, uint16_t& bytes) {
+    bytes = 0;
+    uint16_t i = 0;
+    for (; i < n; i++) {
+        int32_t prev = i >= 2 ? widths[i - 2] : 0;
+        int32_t d = int32_t(widths[i]) - prev;
+        uint32_t z = d < 0 ? (uint32_t(-d) << 1) - 1 : uint32_t(d) << 1;
+        uint8_t tmp[3];
+        int len = 0;
+        do {
+            tmp[len] = uint8_t(z & 0x7f);
+            z >>= 7;
+            if (z) tmp[len] |= 0x80;
+            len++;
+        } while (z);
+        if (bytes + len > max) break;
+        memcpy(out + bytes, tmp, len);
+        bytes += len;
+    }
+    return i;
+}
+
+// Payload to widths; false if it doesn't come out at exactly n widths
+inline bool journalDecode(const uint8_t* p, uint16_t bytes, uint16_t n, uint16_t* widths) {
+    uint16_t pos = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t z = 0;
+        int shift = 0;
+        uint8_t b;
+        do {
+            if (pos >= bytes || shift > 14) return false;
+            b = p[pos++];
+            z |= uint32_t(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        int32_t d = (z & 1) ? -int32_t((z + 1) >> 1) : int32_t(z >> 1);
+        int32_t prev = i >= 2 ? widths[i - 2] : 0;
+        int32_t w = prev + d;
+        if (w < 0 || w > 0xffff) return false;
+        widths[i] = uint16_t(w);
+    }
+    return pos == bytes;
+}
+
+template <typename Flash>
+class TraceJournal {
+public:
+    struct Stats {
+        uint32_t records;       // written to flash
+        uint32_t dropped;       // rate limit, or the last one still being written
+        uint32_t truncated;     // didn't all fit in JOURNAL_RECORD_PAGES
+        uint32_t pages;
+        uint32_t erases;
+        uint32_t programMax_us;
+        uint32_t eraseMax_us;
+        uint32_t stallTotal_us; // all flash ops, which is time with interrupts off
+        uint32_t recordMax_us;  // all the ops of one record
+    };
+
+    explicit TraceJournal(Flash& flash) : flash(flash) {}
+
+    // Find where the last boot got to. Returns how many records are in flash.
+    uint32_t begin() {
+        uint32_t sectors = flash.size() / Flash::SECTOR;
+        uint32_t newest = 0, newestOffset = 0, count = 0;
+        for (uint32_t off = 0; off < flash.size();) {
+            const JournalHeader* h;
+            uint32_t pages = validAt(off, h);
+            if (!pages) {
+                off += Flash::PAGE;
+                continue;
+            }
+            count++;
+            if (h->seq >= newest) {
+                newest = h->seq;
+                newestOffset = off;
+            }
+            off += pages * Flash::PAGE;
+        }
+        seq = newest + 1;
+        // Carry on from the next sector; the rest of this one may not be erased
+        uint32_t sector = count ? newestOffset / Flash::SECTOR + 1 : 0;
+        writeOffset = (sector % sectors) * Flash::SECTOR;
+        erased = false;
+        pending = false;
+        tokens = JOURNAL_BURST;
+        return count;
+    }
+
+    // Keep a burst; copies it to RAM, service() writes it. False if the rate limit or a record still
+    // being written said no.
+    bool add(JournalReason reason, uint8_t rssi, uint32_t time_ms, const uint16_t* widths, uint16_t n) {
+        refill(time_ms);
+        if (pending || tokens == 0) {
+            stats_.dropped++;
+            return false;
+        }
+        tokens--;
+        uint16_t bytes;
+        uint16_t fitted = journalEncode(widths, n, staging + JOURNAL_HEADER_BYTES,
+            sizeof staging - JOURNAL_HEADER_BYTES - 2, bytes);
+        if (fitted < n) stats_.truncated++;
+        JournalHeader h = { JOURNAL_MAGIC, reason, rssi, seq++, time_ms, fitted, bytes };
+        memcpy(staging, &h, sizeof h);
+        uint32_t total = JOURNAL_HEADER_BYTES + bytes;
+        uint16_t crc = journalCrc(staging, total);
+        staging[total] = uint8_t(crc);
+        staging[total + 1] = uint8_t(crc >> 8);
+        total += 2;
+        memset(staging + total, 0xff, sizeof staging - total);
+        stagingPages = uint8_t((total + Flash::PAGE - 1) / Flash::PAGE);
+        stagingNext = 0;
+        recordStall_us = 0;
+        // Records don't cross sectors
+        uint32_t inSector = writeOffset % Flash::SECTOR;
+        if (inSector && inSector + stagingPages * Flash::PAGE > Flash::SECTOR) nextSector();
+        pending = true;
+        return true;
+    }
+
+    // At most one flash op: a sector erase or a page. Call it when a stall doesn't matter.
+    // True if there is more to do.
+    bool service() {
+        if (!pending) return false;
+        uint32_t t0 = pinhal::micros32();
+        if (!erased) {
+            flash.erase(writeOffset - writeOffset % Flash::SECTOR);
+            erased = true;
+            uint32_t dt = pinhal::micros32() - t0;
+            stats_.erases++;
+            if (dt > stats_.eraseMax_us) stats_.eraseMax_us = dt;
+            account(dt);
+            return true;
+        }
+        flash.program(writeOffset, staging + stagingNext * Flash::PAGE);
+        uint32_t dt = pinhal::micros32() - t0;
+        stats_.pages++;
+        if (dt > stats_.programMax_us) stats_.programMax_us = dt;
+        account(dt);
+        writeOffset += Flash::PAGE;
+        if (++stagingNext == stagingPages) {
+            pending = false;
+            stats_.records++;
+            if (recordStall_us > stats_.recordMax_us) stats_.recordMax_us = recordStall_us;
+        }
+        if (writeOffset % Flash::SECTOR == 0) {
+            // Into the next sector, which wants erasing first
+            writeOffset %= flash.size();
+            erased = false;
+        }
+        return pending;
+    }
+
+    bool busy() const { return pending; }
+
+    // Every valid record, oldest first: fn(const uint8_t* record, uint32_t bytes), header and CRC included
+    template <typename Fn>
+    uint32_t forEach(Fn fn) const {
+        // Oldest first: the sector about to be erased, or if writing has started in this one, the next
+        uint32_t sectors = flash.size() / Flash::SECTOR;
+        uint32_t first = writeOffset / Flash::SECTOR;
+        if (erased || writeOffset % Flash::SECTOR) first = (first + 1) % sectors;
+        uint32_t count = 0;
+        for (uint32_t s = 0; s < sectors; s++) {
+            uint32_t base = ((first + s) % sectors) * Flash::SECTOR;
+            for (uint32_t off = base; off < base + Flash::SECTOR;) {
+                const JournalHeader* h;
+                uint32_t pages = validAt(off, h);
+                if (!pages) {
+                    off += Flash::PAGE;
+                    continue;
+                }
+                fn(flash.read(off), uint32_t(JOURNAL_HEADER_BYTES + h->bytes + 2));
+                count++;
+                off += pages * Flash::PAGE;
+            }
+        }
+        return count;
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    Flash& flash;
+    uint8_t staging[JOURNAL_RECORD_PAGES * Flash::PAGE];
+    uint8_t stagingPages = 0;
+    uint8_t stagingNext = 0;
+    bool pending = false;
+    bool erased = false;
+    uint32_t writeOffset = 0;
+    uint32_t seq = 1;
+    uint32_t tokens = JOURNAL_BURST;
+    uint32_t lastRefill_ms = 0;
+    uint32_t recordStall_us = 0;
+    Stats stats_ = {};
+
+    void refill(uint32_t now_ms) {
+        uint32_t n = (now_ms - lastRefill_ms) / JOURNAL_REFILL_MS;
+        if (!n) return;
+        tokens = tokens + n > JOURNAL_BURST ? JOURNAL_BURST : tokens + n;
+        lastRefill_ms += n * JOURNAL_REFILL_MS;
+    }
+
+    void account(uint32_t dt) {
+        stats_.stallTotal_us += dt;
+        recordStall_us += dt;
+    }
+
+    void nextSector() {
+        writeOffset = (writeOffset - writeOffset % Flash::SECTOR + Flash::SECTOR) % flash.size();
+        erased = false;
+    }
+
+    // Pages taken by a good record at off, 0 if there isn't one
+    uint32_t validAt(uint32_t off, const JournalHeader*& h) const {
+        const uint8_t* p = flash.read(off);
+        h = reinterpret_cast<const JournalHeader*>(p);
+        if (h->magic != JOURNAL_MAGIC) return 0;
+        uint32_t total = JOURNAL_HEADER_BYTES + h->bytes + 2;
+        uint32_t pages = (total + Flash::PAGE - 1) / Flash::PAGE;
+        if (pages > JOURNAL_RECORD_PAGES || off % Flash::SECTOR + pages * Flash::PAGE > Flash::SECTOR) return 0;
+        uint16_t crc = journalCrc(p, total - 2);
+        if (p[total - 2] != uint8_t(crc) || p[total - 1] != uint8_t(crc >> 8)) return 0;
+        return pages;
+    }
+};
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+// The last size bytes of the flash chip. Single core only: the other core would have to be
+// parked too while the flash is busy, and nothing here does that.
+class PicoFlash {
+    uint32_t base;
+    uint32_t bytes;
+
+public:
+    static constexpr uint32_t SECTOR = FLASH_SECTOR_SIZE;
+    static constexpr uint32_t PAGE = FLASH_PAGE_SIZE;
+
+    explicit PicoFlash(uint32_t size) : base(PICO_FLASH_SIZE_BYTES - size), bytes(size) {}
+
+    // False if the program reaches into the journal
+    bool fits() const {
+        extern char __flash_binary_end;
+        return uintptr_t(&__flash_binary_end) <= XIP_BASE + base;
+    }
+
+    uint32_t size() const { return bytes; }
+
+    void erase(uint32_t offset) {
+        uint32_t irq = save_and_disable_interrupts();
+        flash_range_erase(base + offset, SECTOR);
+        restore_interrupts(irq);
+    }
+
+    void program(uint32_t offset, const uint8_t* page) {
+        uint32_t irq = save_and_disable_interrupts();
+        flash_range_program(base + offset, page, PAGE);
+        restore_interrupts(irq);
+    }
+
+    const uint8_t* read(uint32_t offset) const {
+        return reinterpret_cast<const uint8_t*>(XIP_BASE + base + offset);
+    }
+};
+#endif
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_ARDUINOHOST_H_
+#define HOST_ARDUINOHOST_H_
+
+// Just enough of Arduino.h for the ookDecoder headers (DecodeOOK.h and friends) to build on the host
+
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#endif
@@ -0,0 +1,340 @@
+// Decode whole archives of captures on every core
+//
+// After a site audit there are hours of width traces (host/trace.h: ook-timing DUMP_WIDTHS output,
+// journal-dump -o) and saved journal dumps (the "J <hex>" lines from oregon-decode, each record on its
+// own). One decoder going through them a file at a time leaves all but one core idle.
+//
+// So each input is cut into chunks at gaps longer than a frame (--gap, 200ms by default). Such a gap
+// puts OregonDecoderV2 and OregonDecoderPLL back in their reset state (anything over 2500us, or five
+// chips, does), so a chunk decodes the same on its own as it does in sequence. Small pieces are
+// joined up to --chunk widths, so each one is worth handing out. A pool of threads (-j, all cores by
+// default) decodes the chunks: each thread has its own deque, works from the back of it, and when it
+// runs dry steals from the front of the others'. Each chunk's lines are kept with their times, and all of
+// them are merged into time order across the inputs (base time plus time in the input; equal times keep
+// input order), so the output is the same bytes as one decoder going through each input from the start
+// and merging the same way (--single does exactly that).
+// --verify runs both, compares them and prints the speedup. collision.h is left out: it learns the
+// sensors' periods over the whole capture, so a chunk would not decode the same on its own.
+// --synth H decodes an H hour synthetic capture instead of files, for measuring.
+//
+// One line per frame: <input> <time us> OSV2 <hex> and the reading, or "checksum" if it failed:
+//   site1.txt 39012345 OSV2 1A2D1072501450073000 1d20,1,27,14.5,75,ok
+// Times are from the start of a trace, or the receiver's boot for a journal record (input#seq).
+//
+// Usage: batch-decode [-j N] [--decoder v2|pll] [--gap US] [--chunk N] [--single] [--verify] [--synth H] [FILE ...]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/oregon.h"
+#include "../../apps/oregonpll.h"
+#include "../journalrecord.h"
+#include "../oregonsynth.h"
+#include "../trace.h"
+
+// What ended the capture, so the frame in the last burst comes out
+#define BATCH_END_GAP_US 100000
+
+struct Source {
+    std::string name;
+    uint64_t base_us;
+    std::vector<uint32_t> widths;
+};
+
+// One output line and its time, for the merge
+struct Line {
+    uint64_t t_us;
+    std::string text;
+};
+
+struct Chunk {
+    size_t source;
+    size_t begin;
+    size_t end;
+    uint64_t start_us;      // from the start of the source, at widths[begin]
+};
+
+// Each thread's own deque; the owner takes from the back, thieves from the front
+class WorkStealingPool {
+    struct Queue {
+        std::mutex m;
+        std::deque<size_t> tasks;
+    };
+    std::vector<Queue> queues;
+    std::vector<uint64_t> stolen;
+
+    bool take(size_t self, size_t& task) {
+        {
+            Queue& q = queues[self];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.tasks.empty()) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            Queue& q = queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.m);
+            if (!q.tasks.empty()) {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+                stolen[self]++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit WorkStealingPool(size_t threads) : queues(threads), stolen(threads) {}
+
+    // fn(task) for tasks 0..n-1; dealt out in contiguous runs, so a thread starts on its own part of the
+    // archive, and nothing is added while it runs, so every deque empty means done
+    template <typename Fn>
+    void run(size_t n, Fn fn) {
+        size_t threads = queues.size();
+        for (size_t t = 0; t < threads; t++) {
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; i++) queues[t].tasks.push_back(i);
+        }
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([this, t, &fn]() {
+                size_t task;
+                while (take(t, task)) fn(task);
+            });
+        }
+        for (auto& w : workers) w.join();
+    }
+
+    uint64_t steals() const {
+        uint64_t s = 0;
+        for (uint64_t n : stolen) s += n;
+        return s;
+    }
+};
+
+static bool loadFile(const char* path, std::vector<Source>& sources) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    // A journal dump has J lines; anything else is a width trace
+    std::vector<Source> records;
+    std::string line;
+    char buf[4096];
+    bool journal = false;
+    while (fgets(buf, sizeof buf, f)) {
+        line += buf;
+        if (line.back() != '\n' && !feof(f)) continue;
+        Record r;
+        bool damaged;
+        if (parseRecord(line.c_str(), r, damaged)) {
+            journal = true;
+            Source s = { std::string(path) + "#" + std::to_string(r.header.seq), uint64_t(r.header.time_ms) * 1000, {} };
+            s.widths.assign(r.widths.begin(), r.widths.end());
+            s.widths.push_back(BATCH_END_GAP_US);
+            records.push_back(std::move(s));
+        } else if (damaged) {
+            fprintf(stderr, "batch-decode: %s: damaged journal record skipped\n", path);
+            journal = true;
+        }
+        line.clear();
+    }
+    fclose(f);
+    if (journal) {
+        for (auto& s : records) sources.push_back(std::move(s));
+        return true;
+    }
+    Source s = { path, 0, {} };
+    if (!readWidthTrace(path, s.widths)) return false;
+    s.widths.push_back(BATCH_END_GAP_US);
+    sources.push_back(std::move(s));
+    return true;
+}
+
+// Like yield-bench's synthetic traffic: 16 sensors, drifting crystals, jitter and noise
+static Source synthesise(double hours) {
+    std::mt19937_64 rng(1);
+    uint64_t duration_us = uint64_t(hours * 3600e6);
+    std::vector<OnInterval> on, quiet;
+    for (int s = 0; s < 16; s++) {
+        uint8_t channel = uint8_t(1 + s % 3);
+        SynthReading r = { uint16_t(s % 4 == 3 ? 0xec40 : 0x1d20), channel, uint8_t(0x11 + s * 7), int16_t(50 + rng() % 250),
+                           uint8_t(30 + rng() % 50), true };
+        double d = 1.0 + 0.04 * (int(rng() % 2001) - 1000) / 1000.0;
+        uint64_t period_us = uint64_t((39000000 + (channel - 1) * 2000000) * d);
+        for (uint64_t start = rng() % period_us; start + 500000 < duration_us; start += period_us) {
+            r.temp = int16_t(std::max(10, r.temp + int(rng() % 3) - 1));
+            uint64_t end = appendPair(r, start, d, 20, rng, on);
+            quiet.push_back({ start, end + 3000 });
+        }
+    }
+    std::sort(quiet.begin(), quiet.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+    appendNoise(0, duration_us, 20, rng, on, &quiet);
+    std::vector<uint64_t> edges;
+    intervalsToEdges(on, edges);
+    Source src = { "synthetic", 0, { uint32_t(edges[0]) } };
+    for (size_t i = 0; i + 1 < edges.size(); i++) src.widths.push_back(uint32_t(std::min<uint64_t>(edges[i + 1] - edges[i], 10000000)));
+    src.widths.push_back(BATCH_END_GAP_US);
+    return src;
+}
+
+// Cut after every gap of at least gap_us, joining pieces up to minWidths; with gap_us 0, one chunk per source
+static void makeChunks(const std::vector<Source>& sources, uint32_t gap_us, size_t minWidths, std::vector<Chunk>& chunks) {
+    for (size_t s = 0; s < sources.size(); s++) {
+        const auto& widths = sources[s].widths;
+        Chunk c = { s, 0, 0, 0 };
+        uint64_t t = 0;
+        for (size_t i = 0; i < widths.size(); i++) {
+            t += widths[i];
+            if (gap_us && widths[i] >= gap_us && i + 1 - c.begin >= minWidths) {
+                c.end = i + 1;
+                chunks.push_back(c);
+                c = { s, i + 1, 0, t };
+            }
+        }
+        if (c.begin < widths.size()) {
+            c.end = widths.size();
+            chunks.push_back(c);
+        }
+    }
+}
+
+template <typename Decoder>
+static void decodeChunk(const Source& src, const Chunk& c, std::vector<Line>& out) {
+    Decoder decoder;
+    uint64_t t = c.start_us;
+    char line[256];
+    for (size_t i = c.begin; i < c.end; i++) {
+        t += src.widths[i];
+        if (!decoder.nextPulse(word(std::min<uint32_t>(src.widths[i], 0xffff)))) continue;
+        uint8_t len;
+        const uint8_t* data = decoder.getData(len);
+        int n = snprintf(line, sizeof line, "%s %llu OSV2 ", src.name.c_str(), (unsigned long long)(src.base_us + t));
+        for (uint8_t k = 0; k < len && n < int(sizeof line) - 40; k++) n += snprintf(line + n, sizeof line - n, "%02X", data[k]);
+        uint16_t type;
+        uint8_t channel, rollingCode, hum;
+        int16_t temp;
+        bool battOK;
+        if (decodeTempHumidity(data, len, type, channel, rollingCode, temp, hum, battOK)) {
+            int a = temp < 0 ? -temp : temp;
+            snprintf(line + n, sizeof line - n, " %04x,%d,%x,%s%d.%d,%d,%s\n", type, channel, rollingCode, temp < 0 ? "-" : "",
+                a / 10, a % 10, hum, battOK ? "ok" : "flat");
+        } else {
+            snprintf(line + n, sizeof line - n, " checksum\n");
+        }
+        out.push_back({ src.base_us + t, line });
+        decoder.resetDecoder();
+    }
+}
+
+// Decodes the chunks, on threads threads (1 without a pool at all); returns the time in ms
+static double decodeAll(const std::vector<Source>& sources, const std::vector<Chunk>& chunks, bool pll, size_t threads,
+                        std::vector<std::vector<Line>>& out, uint64_t* steals) {
+    out.assign(chunks.size(), std::vector<Line>());
+    auto one = [&](size_t i) {
+        if (pll) decodeChunk<OregonDecoderPLL>(sources[chunks[i].source], chunks[i], out[i]);
+        else decodeChunk<OregonDecoderV2>(sources[chunks[i].source], chunks[i], out[i]);
+    };
+    auto start = std::chrono::steady_clock::now();
+    if (threads <= 1) {
+        for (size_t i = 0; i < chunks.size(); i++) one(i);
+    } else {
+        WorkStealingPool pool(threads);
+        pool.run(chunks.size(), one);
+        if (steals) *steals = pool.steals();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every chunk's lines in time order; stable, so lines at the same time stay in input and chunk order
+static std::string merged(const std::vector<std::vector<Line>>& out) {
+    std::vector<const Line*> lines;
+    for (auto& chunk : out) {
+        for (auto& l : chunk) lines.push_back(&l);
+    }
+    std::stable_sort(lines.begin(), lines.end(), [](const Line* a, const Line* b) { return a->t_us < b->t_us; });
+    std::string all;
+    for (const Line* l : lines) all += l->text;
+    return all;
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> files;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool pll = false, single = false, verify = false;
+    uint32_t gap_us = 200000;
+    size_t minWidths = 65536;
+    double synthHours = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-j") && hasArg) threads = size_t(std::max(1, atoi(argv[++i])));
+        else if (!strcmp(argv[i], "--decoder") && hasArg && !strcmp(argv[i + 1], "v2")) { pll = false; i++; }
+        else if (!strcmp(argv[i], "--decoder") && hasArg && !strcmp(argv[i + 1], "pll")) { pll = true; i++; }
+        else if (!strcmp(argv[i], "--gap") && hasArg) gap_us = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--chunk") && hasArg) minWidths = size_t(atol(argv[++i]));
+        else if (!strcmp(argv[i], "--single")) single = true;
+        else if (!strcmp(argv[i], "--verify")) verify = true;
+        else if (!strcmp(argv[i], "--synth") && hasArg) synthHours = atof(argv[++i]);
+        else if (argv[i][0] != '-') files.push_back(argv[i]);
+        else {
+            fprintf(stderr, "Usage: batch-decode [-j N] [--decoder v2|pll] [--gap US] [--chunk N] [--single] [--verify] [--synth H] [FILE ...]\n");
+            return 2;
+        }
+    }
+    // Has to be a gap that resets both decoders
+    if (gap_us < 2500 || (files.empty() && synthHours <= 0)) {
+        fprintf(stderr, "Usage: batch-decode [-j N] [--decoder v2|pll] [--gap US] [--chunk N] [--single] [--verify] [--synth H] [FILE ...]\n");
+        return 2;
+    }
+
+    std::vector<Source> sources;
+    if (synthHours > 0) sources.push_back(synthesise(synthHours));
+    for (const char* path : files) {
+        if (!loadFile(path, sources)) {
+            fprintf(stderr, "batch-decode: can't read %s\n", path);
+            return 1;
+        }
+    }
+    uint64_t totalWidths = 0;
+    for (auto& s : sources) totalWidths += s.widths.size();
+
+    // The one pass per input that the chunks have to match
+    std::vector<Chunk> whole;
+    makeChunks(sources, 0, 0, whole);
+    std::vector<std::vector<Line>> wholeOut;
+    double single_ms = 0;
+    if (single || verify) single_ms = decodeAll(sources, whole, pll, 1, wholeOut, nullptr);
+    if (single) {
+        fputs(merged(wholeOut).c_str(), stdout);
+        return 0;
+    }
+
+    std::vector<Chunk> chunks;
+    makeChunks(sources, gap_us, minWidths, chunks);
+    std::vector<std::vector<Line>> out;
+    uint64_t steals = 0;
+    double parallel_ms = decodeAll(sources, chunks, pll, threads, out, &steals);
+    std::string all = merged(out);
+    fputs(all.c_str(), stdout);
+
+    if (verify) {
+        bool same = all == merged(wholeOut);
+        fprintf(stderr, "# %zu inputs, %llu widths, %zu chunks, %zu threads, %llu steals: single %.1fms, pool %.1fms, speedup %.2fx (%.0f%% of linear), output %s\n",
+            sources.size(), (unsigned long long)totalWidths, chunks.size(), threads, (unsigned long long)steals, single_ms, parallel_ms,
+            single_ms / parallel_ms, 100.0 * single_ms / parallel_ms / threads, same ? "identical" : "DIFFERENT");
+        return same ? 0 : 1;
+    }
+    return 0;
+}
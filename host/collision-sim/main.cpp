@@ -0,0 +1,292 @@
+// Readings per hour with many sensors, with and without apps/collision.h
+//
+// Synthetic Oregon sensors (oregonsynth.h), each with its own power at the antenna, period by
+// channel (39/41/43s, like the real ones, give or take their crystal) and a temperature that
+// wanders. Where transmissions overlap, DIO2 comes from a model of the SX1231 OOK slicer rather
+// than the union of the carriers: the peak threshold follows the strongest carrier, sits 6dB
+// under it and decays about 2dB per ms when it goes, so the stronger transmitter wins, the weaker
+// one is lost under it and for a few ms after, and when they are close both come through in bits.
+// Noise bursts go in between as usual.
+//
+// The same edges go through OregonDecoderV2 alone, which is what oregon-decode does, and through
+// OregonDecoderV2 plus BurstRecorder and CollisionResolver. A reading counts once per sensor per
+// cycle (either of the pair), and only if it matches what was sent; anything else with a good
+// checksum is a false reading.
+//
+// The with collision.h path also feeds SensorStats (apps/sensorstats.h), like oregon-decode does, and
+// its missed cycles, worked out from the periods it learned, are checked against what was really missed.
+//
+// Usage: collision-sim [--sensors S] [--hours H] [--noise B] [--jitter U] [--seed N]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/collision.h"
+#include "../../apps/sensorstats.h"
+#include "../oregonsynth.h"
+
+// The slicer model
+#define SLICER_MARGIN_DB 6.0
+#define SLICER_DECAY_DB_PER_US 0.002
+#define SLICER_FLOOR_DBM -100.0
+#define SLICER_STEP_US 5
+// How long after a transmission the threshold can still be up
+#define SLICER_TAIL_US 25000
+
+struct Transmission {
+    int sensor;
+    uint64_t cycle;
+    uint64_t start_us;
+    uint64_t end_us;
+    double power_dbm;
+    std::vector<OnInterval> on;
+};
+
+struct Cycle {
+    SynthReading reading;
+    uint64_t start_us;
+};
+
+// The receiver output for a set of overlapping transmissions, stepped through time
+static void slice(const std::vector<const Transmission*>& group, std::vector<OnInterval>& out) {
+    uint64_t from = group[0]->start_us, to = 0;
+    for (auto* tx : group) to = std::max(to, tx->end_us);
+    std::vector<size_t> next(group.size(), 0);
+    double peak = SLICER_FLOOR_DBM;
+    bool high = false;
+    uint64_t rose = 0;
+    for (uint64_t t = from; t <= to + SLICER_STEP_US; t += SLICER_STEP_US) {
+        double power = -200;
+        for (size_t k = 0; k < group.size(); k++) {
+            auto& on = group[k]->on;
+            while (next[k] < on.size() && on[next[k]].end_us <= t) next[k]++;
+            if (next[k] < on.size() && on[next[k]].start_us <= t) power = std::max(power, group[k]->power_dbm);
+        }
+        peak = std::max(peak - SLICER_DECAY_DB_PER_US * SLICER_STEP_US, power);
+        bool now = power > std::max(peak - SLICER_MARGIN_DB, SLICER_FLOOR_DBM);
+        if (now && !high) rose = t;
+        if (!now && high) out.push_back({ rose, t });
+        high = now;
+    }
+}
+
+static bool reading(const uint8_t* data, uint8_t len, SynthReading& r) {
+    return decodeTempHumidity(data, len, r.type, r.channel, r.rollingCode, r.temp, r.hum, r.battOK);
+}
+
+int main(int argc, char** argv) {
+    int numSensors = 30;
+    double hours = 12, noise = 20, jitter = 15;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--sensors") && hasArg) numSensors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && hasArg) jitter = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: collision-sim [--sensors S] [--hours H] [--noise B] [--jitter U] [--seed N]\n");
+            return 2;
+        }
+    }
+
+    std::mt19937_64 rng(seed);
+    uint64_t duration_us = uint64_t(hours * 3600e6);
+
+    // Every transmission, each of the pair separately
+    std::vector<Transmission> txs;
+    std::vector<std::vector<Cycle>> cycles(numSensors);
+    std::map<uint32_t, int> sensorById;
+    for (int s = 0; s < numSensors; s++) {
+        bool thn132 = s % 4 == 3;
+        uint8_t channel = uint8_t(1 + s % 3);
+        SynthReading r = { uint16_t(thn132 ? 0xec40 : 0x1d20), channel, uint8_t(0x11 + s * 7), int16_t(50 + rng() % 250),
+                           uint8_t(30 + rng() % 50), true };
+        sensorById[uint32_t(r.type) << 16 | r.channel << 8 | r.rollingCode] = s;
+        double drift = 1.0 + ((int(rng() % 200) - 100) / 50000.0);
+        double power = -95 + double(rng() % 4000) / 100.0;
+        uint64_t period_us = uint64_t((39000000 + (channel - 1) * 2000000) * drift);
+        for (uint64_t start = rng() % period_us; start + 500000 < duration_us; start += period_us) {
+            // Temperature wanders a tenth or two per cycle, humidity now and then
+            r.temp = int16_t(r.temp + int(rng() % 5) - 2);
+            if (r.temp < 10) r.temp = 10;
+            if (rng() % 4 == 0) r.hum = uint8_t(std::min(95, std::max(5, int(r.hum) + int(rng() % 3) - 1)));
+            cycles[s].push_back({ r, start });
+            uint8_t data[12];
+            int len = encodeOregonBytes(r, data);
+            std::vector<uint8_t> runs;
+            oregonRuns(data, len, runs);
+            uint64_t t = start;
+            for (int copy = 0; copy < 2; copy++) {
+                Transmission tx = { s, cycles[s].size() - 1, t, 0, power, {} };
+                tx.end_us = appendOnIntervals(runs, t, drift, jitter, rng, tx.on);
+                t = tx.end_us + SYNTH_PAIR_GAP_US;
+                txs.push_back(std::move(tx));
+            }
+        }
+    }
+    std::sort(txs.begin(), txs.end(), [](const Transmission& a, const Transmission& b) { return a.start_us < b.start_us; });
+
+    // Group the ones that overlap (threshold tail included), and slice each group
+    std::vector<OnInterval> on;
+    std::vector<OnInterval> heard;
+    // Power over time, for the RSSI samples: per group, the strongest carrier present
+    std::vector<std::pair<OnInterval, std::vector<const Transmission*>>> groups;
+    uint64_t overlapped = 0;
+    for (size_t i = 0; i < txs.size();) {
+        std::vector<const Transmission*> group = { &txs[i] };
+        uint64_t end = txs[i].end_us;
+        size_t j = i + 1;
+        for (; j < txs.size() && txs[j].start_us < end + SLICER_TAIL_US; j++) {
+            group.push_back(&txs[j]);
+            end = std::max(end, txs[j].end_us);
+        }
+        // The two of a pair are 10ms apart, which is only an overlap if someone else is in there too
+        bool others = false;
+        for (auto* tx : group) others |= tx->sensor != group[0]->sensor;
+        if (!others) {
+            for (auto* tx : group) on.insert(on.end(), tx->on.begin(), tx->on.end());
+        } else {
+            slice(group, on);
+            overlapped += group.size();
+        }
+        heard.push_back({ txs[i].start_us, end });
+        groups.push_back({ { txs[i].start_us, end }, group });
+        i = j;
+    }
+    appendNoise(0, duration_us, noise, rng, on, &heard);
+    std::vector<uint64_t> edges;
+    intervalsToEdges(on, edges);
+
+    // RSSI byte the radio would read at time t
+    size_t g = 0;
+    auto rssiAt = [&](uint64_t t) -> uint8_t {
+        while (g < groups.size() && groups[g].first.end_us < t) g++;
+        double power = -110;
+        if (g < groups.size() && groups[g].first.start_us <= t) {
+            for (auto* tx : groups[g].second) {
+                if (tx->start_us <= t && t <= tx->end_us) power = std::max(power, tx->power_dbm);
+            }
+        }
+        return uint8_t(-2 * power);
+    };
+
+    // Score a frame: which sensor and cycle, or false
+    std::set<std::pair<int, uint64_t>> baseline, aware;
+    uint64_t falseBaseline = 0, falseAware = 0;
+    uint64_t byMethod[4] = { 0, 0, 0, 0 };
+    uint64_t falseByMethod[4] = { 0, 0, 0, 0 };
+    auto score = [&](const uint8_t* data, uint8_t len, uint64_t t, std::set<std::pair<int, uint64_t>>& got) -> bool {
+        SynthReading r;
+        if (!reading(data, len, r)) return true;
+        auto it = sensorById.find(uint32_t(r.type) << 16 | r.channel << 8 | r.rollingCode);
+        if (it == sensorById.end()) return false;
+        auto& cs = cycles[it->second];
+        for (size_t k = 0; k < cs.size(); k++) {
+            if (cs[k].start_us <= t && t < cs[k].start_us + 2000000) {
+                if (cs[k].reading.temp != r.temp || (r.type == 0x1d20 && cs[k].reading.hum != r.hum)) return false;
+                got.insert({ it->second, k });
+                return true;
+            }
+        }
+        return false;
+    };
+
+    OregonDecoderV2 plain;
+    OregonDecoderV2 decoder;
+    static BurstRecorder recorder;
+    static CollisionResolver resolver;
+    static SensorStats sensorStats;
+    uint64_t nextRssi_us = 0;
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+        uint64_t t = edges[i + 1];
+        uint32_t w = uint32_t(std::min<uint64_t>(t - edges[i], 0xffff));
+        uint32_t now_ms = uint32_t(t / 1000);
+        if (plain.nextPulse(w)) {
+            uint8_t len;
+            const uint8_t* data = plain.getData(len);
+            if (!score(data, len, t, baseline)) falseBaseline++;
+            plain.resetDecoder();
+        }
+
+        // What oregon-decode does with COLLISION_RECOVERY
+        if (decoder.nextPulse(w)) {
+            uint8_t len;
+            const uint8_t* data = decoder.getData(len);
+            SynthReading r;
+            if (data) sensorStats.frame(data, len, reading(data, len, r), rssiAt(t), now_ms);
+            if (checkedLength(data, len)) {
+                if (!score(data, len, t, aware)) falseAware++;
+                resolver.decoded(data, len, now_ms);
+                recorder.frameDecoded();
+            }
+            decoder.resetDecoder();
+        }
+        if (recorder.width(w, now_ms)) {
+            RecoveredFrame found[2];
+            int n = resolver.resolve(recorder.burst(), now_ms, found, 2);
+            for (int k = 0; k < n; k++) {
+                sensorStats.frame(found[k].data, found[k].len, true, recorder.burst().rssiStrongest, now_ms);
+                if (score(found[k].data, found[k].len, t, aware)) {
+                    byMethod[found[k].how]++;
+                } else {
+                    falseAware++;
+                    falseByMethod[found[k].how]++;
+                }
+            }
+        }
+        // The main loop reads RSSI every couple of ms while a burst is going
+        if (recorder.inBurst() && t >= nextRssi_us) {
+            recorder.rssi(rssiAt(t));
+            nextRssi_us = t + 2000;
+        }
+    }
+
+    uint64_t total = 0;
+    for (auto& cs : cycles) total += cs.size();
+    const auto& rs = resolver.stats();
+    printf("%d sensors, %.1f h, %llu readings sent (each as a pair), %llu of %zu transmissions overlapping another sensor's, noise %.0f bursts/s\n",
+        numSensors, hours, (unsigned long long)total, (unsigned long long)overlapped, txs.size(), noise);
+    printf("  OregonDecoderV2:        %7.1f readings/h  %5.1f%%  false %llu\n", baseline.size() / hours,
+        100.0 * baseline.size() / total, (unsigned long long)falseBaseline);
+    printf("  with collision.h:       %7.1f readings/h  %5.1f%%  false %llu\n", aware.size() / hours,
+        100.0 * aware.size() / total, (unsigned long long)falseAware);
+    for (int m = RECOVERED_REDECODE; m <= RECOVERED_FILLED; m++) {
+        printf("    %-10s %6llu frames (%llu false)\n", recoveryName(RecoveryMethod(m)), (unsigned long long)byMethod[m],
+            (unsigned long long)falseByMethod[m]);
+    }
+    // What SensorStats made of it, against the truth, per sensor
+    uint32_t end_ms = uint32_t(duration_us / 1000);
+    uint64_t estMissed = 0, estReceived = 0, actualMissed = 0, worst = 0;
+    sensorStats.forEach([&](const SensorStats::Sensor& st) {
+        uint16_t type;
+        uint8_t channel, rollingCode;
+        SensorStats::identity(st, type, channel, rollingCode);
+        auto it = sensorById.find(uint32_t(type) << 16 | channel << 8 | rollingCode);
+        if (it == sensorById.end()) return;
+        int s = it->second;
+        // Cycles from the first one heard to the end that got nothing, as SensorStats can only count those
+        size_t k0 = 0;
+        while (k0 < cycles[s].size() && !aware.count({ s, k0 })) k0++;
+        uint64_t missed = 0;
+        for (size_t k = k0; k < cycles[s].size(); k++) missed += !aware.count({ s, k });
+        uint64_t est = SensorStats::missedNow(st, end_ms);
+        estMissed += est;
+        estReceived += st.received;
+        actualMissed += missed;
+        worst = std::max<uint64_t>(worst, est > missed ? est - missed : missed - est);
+    });
+    printf("  sensorstats: %d sensors, %llu readings, missed %llu estimated / %llu actual, worst sensor off by %llu\n",
+        sensorStats.forEach([](const SensorStats::Sensor&) {}), (unsigned long long)estReceived,
+        (unsigned long long)estMissed, (unsigned long long)actualMissed, (unsigned long long)worst);
+    printf("  resolver: %u bursts looked at, %u looked like collisions, %u unresolved\n", rs.bursts, rs.collisions, rs.unresolved);
+    return 0;
+}
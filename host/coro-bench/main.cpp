@@ -0,0 +1,327 @@
+// Host checks and measurements for apps/corotask.h
+//
+// 1. Deterministic scheduling, against a simulated clock: periodic tasks, a Signal raised by a
+//    simulated edge ISR, and a Queue between tasks. The wakeup trace is compared against
+//    the order the scheduler promises (deadline order, ties in the order set, FIFO resume)
+//    and against a second identical run.
+// 2. No heap: global operator new is counted, and must not be called at all once the tasks exist.
+// 3. Overhead on the real clock: cost of a yield round trip between two tasks, against calling
+//    the same work from a plain loop, and timer / event wakeup latency with a busy neighbour task.
+//
+// Exits non zero if a check fails.
+//
+// Usage: coro-bench [--switches N] [--seconds S]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../../apps/corotask.h"
+
+using namespace corotask;
+
+static size_t heapAllocations = 0;
+
+void* operator new(size_t n) {
+    heapAllocations++;
+    void* p = malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static uint64_t simNow_us = 0;
+static uint64_t simClock() { return simNow_us; }
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+// Simulated run ---------------------------------------------------------------
+
+struct TraceEntry {
+    uint64_t t_us;
+    char task;
+    uint32_t value;
+};
+
+struct SimWorld {
+    std::vector<TraceEntry> trace;
+    Signal edges;
+    Queue<uint32_t, 4> frames;
+    uint64_t end_us;
+};
+
+static SimWorld* world;
+
+static Task periodic(char name, uint32_t period_us, uint32_t work_us) {
+    uint64_t next = now_us();
+    while (true) {
+        next += period_us;
+        co_await sleep_until(next);
+        if (now_us() >= world->end_us) co_return;
+        world->trace.push_back({ now_us(), name, 0 });
+        simNow_us += work_us; // pretend to do something
+    }
+}
+
+// Wakes on the "ISR" Signal, passes every third edge on down the Queue
+static Task decoder() {
+    uint32_t seen = 0;
+    while (true) {
+        uint32_t n = co_await world->edges;
+        if (now_us() >= world->end_us) co_return;
+        world->trace.push_back({ now_us(), 'D', n });
+        for (uint32_t i = 0; i < n; i++) {
+            if (++seen % 3 == 0) world->frames.push(seen);
+        }
+    }
+}
+
+static Task reporter() {
+    while (true) {
+        uint32_t v = co_await world->frames.pop();
+        world->trace.push_back({ now_us(), 'R', v });
+        if (now_us() >= world->end_us) co_return;
+    }
+}
+
+static Task stopper() {
+    // Ends the run: gives the waiting tasks one more wakeup after end_us so they can return
+    co_await sleep_until(world->end_us);
+    world->edges.notify();
+    world->frames.push(0);
+}
+
+static std::vector<TraceEntry> runSimulation(const std::vector<uint64_t>& isrTimes, uint64_t end_us,
+    Scheduler::Stats& stats, size_t& allocsDuringRun) {
+    SimWorld w;
+    w.end_us = end_us;
+    w.trace.reserve(10000); // so the only allocations that could show up are the scheduler's
+    world = &w;
+    simNow_us = 0;
+    pinhal::host::clock_us = simClock;
+    scheduler.resetStats();
+    arena.reset();
+
+    scheduler.spawn(periodic('A', 3000, 100));
+    scheduler.spawn(periodic('B', 5000, 200));
+    scheduler.spawn(decoder());
+    scheduler.spawn(reporter());
+    scheduler.spawn(stopper());
+
+    size_t allocs0 = heapAllocations;
+    size_t nextIsr = 0;
+    uint32_t idle = scheduler.stats().idleLoops;
+    while (scheduler.tasks() > 0) {
+        // The "ISR" fires between passes, at its own time
+        for (; nextIsr < isrTimes.size() && isrTimes[nextIsr] <= simNow_us; nextIsr++) {
+            w.edges.notify();
+        }
+        scheduler.runOnce();
+        if (scheduler.stats().idleLoops != idle) {
+            idle = scheduler.stats().idleLoops;
+            // Nothing to do, jump to whichever comes first
+            uint64_t t = UINT64_MAX, d;
+            if (scheduler.nextDeadline(d)) t = d;
+            if (nextIsr < isrTimes.size() && isrTimes[nextIsr] < t) t = isrTimes[nextIsr];
+            if (t == UINT64_MAX) break;
+            simNow_us = std::max(simNow_us, t);
+        }
+    }
+    allocsDuringRun = heapAllocations - allocs0;
+    stats = scheduler.stats();
+    pinhal::host::clock_us = nullptr;
+    world = nullptr;
+    return w.trace;
+}
+
+static std::string traceString(const std::vector<TraceEntry>& trace, size_t limit) {
+    std::string s;
+    char buf[64];
+    for (size_t i = 0; i < trace.size() && i < limit; i++) {
+        snprintf(buf, sizeof buf, "%c@%llu%s", trace[i].task, (unsigned long long)trace[i].t_us, i + 1 < limit ? " " : "");
+        s += buf;
+    }
+    return s;
+}
+
+static void simulationChecks() {
+    printf("Simulated clock:\n");
+    // Edges in bursts, some landing exactly on timer deadlines
+    std::vector<uint64_t> isr;
+    for (uint64_t t = 1000; t < 100000; t += 7000) {
+        for (int k = 0; k < 4; k++) isr.push_back(t + k * 250);
+    }
+    isr.push_back(15000);
+    std::sort(isr.begin(), isr.end());
+
+    Scheduler::Stats s1, s2;
+    size_t allocs1, allocs2;
+    auto t1 = runSimulation(isr, 100000, s1, allocs1);
+    size_t arenaUsed = arena.bytesUsed();
+    auto t2 = runSimulation(isr, 100000, s2, allocs2);
+
+    bool same = t1.size() == t2.size();
+    for (size_t i = 0; same && i < t1.size(); i++) {
+        same = t1[i].t_us == t2[i].t_us && t1[i].task == t2[i].task && t1[i].value == t2[i].value;
+    }
+    check(same, "two identical runs give the identical trace");
+    check(allocs1 == 0 && allocs2 == 0, "no heap allocation while running");
+
+    // A every 3ms (100us of work), B every 5ms (200us): both are due at 15ms, B set its timer first
+    // (at 10.2ms, A at 12.1ms) so B must run first and A after B's 200us
+    bool tieOrder = false;
+    for (size_t i = 0; i + 1 < t1.size(); i++) {
+        if (t1[i].t_us >= 15000) {
+            tieOrder = t1[i].task == 'B' && t1[i].t_us == 15000 && t1[i + 1].task == 'A' && t1[i + 1].t_us == 15200;
+            break;
+        }
+    }
+    check(tieOrder, "equal deadlines run in the order they were set");
+
+    // Periodic tasks never drift: deadline based, and late only by the work queued ahead of them
+    bool onTime = true;
+    for (auto& e : t1) {
+        if (e.task == 'A' && e.t_us % 3000 > 300) onTime = false;
+        if (e.task == 'B' && e.t_us % 5000 > 300) onTime = false;
+    }
+    check(onTime, "periodic tasks keep to their deadlines");
+
+    // Every edge reached the decoder, every third edge reached the reporter, in order
+    uint32_t edgesSeen = 0, lastFrame = 0;
+    bool inOrder = true;
+    for (auto& e : t1) {
+        if (e.task == 'D') edgesSeen += e.value;
+        if (e.task == 'R' && e.value) {
+            if (e.value != lastFrame + 3) inOrder = false;
+            lastFrame = e.value;
+        }
+    }
+    check(edgesSeen == isr.size(), "signal counts every edge, none lost to coalescing");
+    check(inOrder && lastFrame == (isr.size() / 3) * 3, "queue delivers every value in order");
+
+    printf("  %zu wakeups, %u passes, arena %zu of %zu bytes for 5 tasks\n", t1.size(), s1.loops, arenaUsed,
+        arena.capacity());
+    printf("  trace starts: %s\n", traceString(t1, 12).c_str());
+}
+
+// Real clock ------------------------------------------------------------------
+
+static double wallSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile uint32_t sink = 0;
+
+static void work(uint32_t i) { sink = sink + i; }
+
+static uint32_t remaining = 0;
+
+static Task pingPong() {
+    while (remaining) {
+        remaining--;
+        work(remaining);
+        co_await yield();
+    }
+}
+
+static Task sleeper(uint32_t period_us, uint64_t end_us) {
+    uint64_t next = now_us();
+    while (true) {
+        next += period_us;
+        if (next >= end_us) co_return;
+        co_await sleep_until(next);
+    }
+}
+
+static Task busy(uint32_t chunk_us, uint64_t end_us) {
+    while (now_us() < end_us) {
+        uint64_t until = now_us() + chunk_us;
+        while (now_us() < until) {}
+        co_await yield();
+    }
+}
+
+static Signal realEdges;
+
+static Task edgeWaiter(uint64_t end_us) {
+    while (now_us() < end_us) {
+        co_await realEdges;
+    }
+}
+
+static void realClockMeasurements(uint32_t switches, double seconds) {
+    printf("Real clock:\n");
+    arena.reset();
+    scheduler.resetStats();
+
+    // Baseline: the work called from a plain loop
+    double w0 = wallSeconds();
+    for (uint32_t i = switches; i > 0; i--) work(i - 1);
+    double plain = wallSeconds() - w0;
+
+    remaining = switches;
+    scheduler.spawn(pingPong());
+    scheduler.spawn(pingPong());
+    w0 = wallSeconds();
+    scheduler.run();
+    double coro = wallSeconds() - w0;
+    printf("  %u yields: %.1f ns per resume (plain loop %.1f ns per call), scheduler's own share %.0f%%\n",
+        switches, coro / switches * 1e9, plain / switches * 1e9,
+        100.0 * scheduler.stats().schedTime_us / std::max<uint64_t>(1, scheduler.stats().schedTime_us + scheduler.stats().taskTime_us));
+
+    // Latency: a 1ms periodic task and an edge waiter, next to a task that hogs the CPU in 50us chunks
+    arena.reset();
+    scheduler.resetStats();
+    uint64_t end = now_us() + uint64_t(seconds * 1e6);
+    scheduler.spawn(sleeper(1000, end));
+    scheduler.spawn(busy(50, end));
+    scheduler.spawn(edgeWaiter(end));
+    uint64_t nextEdge = now_us() + 333;
+    while (scheduler.tasks() > 0) {
+        if (now_us() >= nextEdge) {
+            realEdges.notify();
+            nextEdge += 333;
+        }
+        if (now_us() >= end) realEdges.notify();
+        scheduler.runOnce();
+    }
+    const Scheduler::Stats& s = scheduler.stats();
+    printf("  timer wakeups %u, late by mean %.1f us, max %u us (neighbour runs 50 us at a time)\n", s.timerWakeups,
+        s.timerWakeups ? double(s.timerLateSum_us) / s.timerWakeups : 0.0, s.timerLateMax_us);
+    printf("  event wakeups %u, latency mean %.1f us, max %u us\n", s.eventWakeups,
+        s.eventWakeups ? double(s.eventLatSum_us) / s.eventWakeups : 0.0, s.eventLatMax_us);
+    printf("  %u passes (%u idle), %u resumes\n", s.loops, s.idleLoops, s.resumes);
+}
+
+int main(int argc, char** argv) {
+    uint32_t switches = 2000000;
+    double seconds = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--switches") && hasArg) switches = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && hasArg) seconds = atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: coro-bench [--switches N] [--seconds S]\n");
+            return 2;
+        }
+    }
+    simulationChecks();
+    realClockMeasurements(switches, seconds);
+    if (failures) {
+        printf("%d check(s) FAILED\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+// Yield of OregonDecoderV2 against OregonDecoderPLL (apps/oregonpll.h) as the transmitter clock drifts
+//
+// Synthetic: for each combination of clock error and OOK asymmetry (highs stretched and lows
+// shrunk by the same amount, which is what the SX1231 threshold does to a strong or weak signal),
+// --frames transmissions with jitter, and noise bursts between them, go through both decoders.
+// Within each transmission the clock also wanders by --wander (a fraction, spread over the frame),
+// which is what the PLL tracking is for. A frame only counts if it decodes to the reading sent.
+//
+// Recorded: --trace FILE runs both decoders over a width trace (see host/trace.h; ook-timing with
+// DUMP_WIDTHS writes them), scaled by --stretch and with --asym added to alternate pulses, and
+// counts readings with a good checksum. --write-trace FILE saves a synthetic run in that format.
+//
+// Usage: drift-bench [--frames N] [--jitter U] [--wander F] [--noise B] [--seed N]
+//                    [--trace FILE] [--stretch F] [--asym U] [--write-trace FILE]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/oregonpll.h"
+#include "../oregonsynth.h"
+#include "../trace.h"
+
+struct Decoded {
+    uint16_t type;
+    uint8_t channel, rollingCode, hum;
+    int16_t temp;
+    bool battOK;
+};
+
+static bool decodeFrame(DecodeOOK& decoder, Decoded& d) {
+    uint8_t len;
+    const uint8_t* data = decoder.getData(len);
+    return data && decodeTempHumidity(data, len, d.type, d.channel, d.rollingCode, d.temp, d.hum, d.battOK);
+}
+
+static bool matches(const Decoded& d, const SynthReading& r) {
+    return d.type == r.type && d.channel == r.channel && d.rollingCode == r.rollingCode && d.temp == r.temp;
+}
+
+// appendOnIntervals, but the chip length goes from drift0 to drift1 across the transmission,
+// and every carrier on interval is stretched by asym_us
+template <typename Rng>
+static uint64_t appendWandering(const std::vector<uint8_t>& runs, uint64_t start_us, double drift0, double drift1,
+                                double jitter_us, double asym_us, Rng& rng, std::vector<OnInterval>& out) {
+    std::normal_distribution<double> jitter(0, jitter_us > 0 ? jitter_us : 1e-9);
+    double total = 0;
+    for (uint8_t r : runs) total += r;
+    double t = double(start_us);
+    double done = 0;
+    bool on = true;
+    for (uint8_t r : runs) {
+        double chip = SYNTH_CHIP_US * (drift0 + (drift1 - drift0) * (done / total));
+        double t1 = t + r * chip;
+        if (on) {
+            double a = t + jitter(rng);
+            double b = t1 + asym_us + jitter(rng);
+            if (b > a) out.push_back({ uint64_t(a), uint64_t(b) });
+        }
+        done += r;
+        t = t1;
+        on = !on;
+    }
+    return uint64_t(t);
+}
+
+struct Yield {
+    uint32_t v2 = 0;
+    uint32_t pll = 0;
+};
+
+static std::vector<uint32_t> lastWidths;
+
+static Yield runCell(int frames, double drift, double asym_us, double wander, double jitter, double noise, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<OnInterval> on;
+    std::vector<OnInterval> quiet;
+    std::vector<SynthReading> sent;
+    uint64_t t = 10000;
+    for (int i = 0; i < frames; i++) {
+        // (THN132N has no sign in its checksum, so only give it positive temperatures)
+        bool thn132 = i % 3 == 2;
+        SynthReading r = { uint16_t(thn132 ? 0xec40 : 0x1d20), uint8_t(1 + i % 3), uint8_t(0x10 + (i % 7) * 13),
+                           int16_t((i * 37) % 400 - (thn132 ? 0 : 50)), uint8_t(20 + i % 70), true };
+        uint8_t data[12];
+        int len = encodeOregonBytes(r, data);
+        std::vector<uint8_t> runs;
+        oregonRuns(data, len, runs);
+        double d1 = drift * (1 + ((i & 1) ? wander : -wander));
+        uint64_t end = appendWandering(runs, t, drift, d1, jitter, asym_us, rng, on);
+        quiet.push_back({ t, end + 3000 });
+        sent.push_back(r);
+        t = end + 20000 + rng() % 20000;
+    }
+    appendNoise(0, t, noise, rng, on, &quiet);
+    std::vector<uint64_t> edges;
+    intervalsToEdges(on, edges);
+    lastWidths.clear();
+    for (size_t i = 0; i + 1 < edges.size(); i++) lastWidths.push_back(uint32_t(edges[i + 1] - edges[i]));
+    lastWidths.push_back(100000);
+
+    // Frames come out in order, so match each against the next ones sent
+    OregonDecoderV2 v2;
+    OregonDecoderPLL pll;
+    Yield y;
+    size_t nextV2 = 0, nextPll = 0;
+    for (uint32_t w : lastWidths) {
+        Decoded d;
+        if (v2.nextPulse(w)) {
+            if (decodeFrame(v2, d)) {
+                for (size_t k = nextV2; k < sent.size() && k < nextV2 + 4; k++) {
+                    if (matches(d, sent[k])) { y.v2++; nextV2 = k + 1; break; }
+                }
+            }
+            v2.resetDecoder();
+        }
+        if (pll.nextPulse(w)) {
+            if (decodeFrame(pll, d)) {
+                for (size_t k = nextPll; k < sent.size() && k < nextPll + 4; k++) {
+                    if (matches(d, sent[k])) { y.pll++; nextPll = k + 1; break; }
+                }
+            }
+            pll.resetDecoder();
+        }
+    }
+    return y;
+}
+
+static int runTrace(const char* path, double stretch, double asym_us) {
+    std::vector<uint32_t> widths;
+    if (!readWidthTrace(path, widths)) {
+        fprintf(stderr, "drift-bench: can't read %s\n", path);
+        return 1;
+    }
+    OregonDecoderV2 v2;
+    OregonDecoderPLL pll;
+    uint32_t v2Frames = 0, pllFrames = 0;
+    double chipSum = 0, asymSum = 0;
+    for (size_t i = 0; i < widths.size(); i++) {
+        double w = widths[i] * stretch + ((i & 1) ? -asym_us : asym_us);
+        uint32_t width = w < 1 ? 1 : uint32_t(w);
+        Decoded d;
+        if (v2.nextPulse(width)) {
+            if (decodeFrame(v2, d)) v2Frames++;
+            v2.resetDecoder();
+        }
+        if (pll.nextPulse(width)) {
+            if (decodeFrame(pll, d)) {
+                pllFrames++;
+                chipSum += pll.chipPeriod_us();
+                asymSum += pll.asymmetry_us();
+            }
+            pll.resetDecoder();
+        }
+    }
+    printf("%s: %zu widths, stretch %.3f, asymmetry %+.0f us\n", path, widths.size(), stretch, asym_us);
+    printf("  OregonDecoderV2   %u readings\n", v2Frames);
+    printf("  OregonDecoderPLL  %u readings", pllFrames);
+    if (pllFrames) printf(", chip period %.1f us, asymmetry %+.1f us on average", chipSum / pllFrames, asymSum / pllFrames);
+    printf("\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int frames = 200;
+    double jitter = 20, wander = 0.01, noise = 20, stretch = 1, asym = 0;
+    unsigned seed = 1;
+    const char* tracePath = nullptr;
+    const char* writePath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && hasArg) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && hasArg) jitter = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--wander") && hasArg) wander = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--trace") && hasArg) tracePath = argv[++i];
+        else if (!strcmp(argv[i], "--stretch") && hasArg) stretch = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--asym") && hasArg) asym = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--write-trace") && hasArg) writePath = argv[++i];
+        else {
+            fprintf(stderr, "Usage: drift-bench [--frames N] [--jitter U] [--wander F] [--noise B] [--seed N]\n"
+                            "                   [--trace FILE] [--stretch F] [--asym U] [--write-trace FILE]\n");
+            return 2;
+        }
+    }
+    if (tracePath) return runTrace(tracePath, stretch, asym);
+
+    static const double drifts[] = { -0.12, -0.08, -0.04, 0, 0.04, 0.08, 0.12 };
+    static const double asyms[] = { -150, 0, 100, 200, 250 };
+    printf("Frames decoded correctly out of %d, OregonDecoderV2 / OregonDecoderPLL\n", frames);
+    printf("jitter %.0f us, clock wanders %.1f%% within a frame, noise %.0f bursts/s between frames\n\n", jitter,
+        wander * 100, noise);
+    printf("clock error ");
+    for (double a : asyms) printf("| asym %+4.0fus  ", a);
+    printf("\n");
+    Yield total;
+    int cells = 0;
+    for (double drift : drifts) {
+        printf("   %+5.0f%%   ", drift * 100);
+        for (double a : asyms) {
+            Yield y = runCell(frames, 1 + drift, a, wander, jitter, noise, seed + cells++);
+            printf("| %4u / %4u  ", y.v2, y.pll);
+            total.v2 += y.v2;
+            total.pll += y.pll;
+        }
+        printf("\n");
+    }
+    printf("\ntotal %.1f%% / %.1f%%\n", 100.0 * total.v2 / (frames * cells), 100.0 * total.pll / (frames * cells));
+
+    if (writePath) {
+        // The nominal cell, as a trace for --trace
+        runCell(frames, 1, 0, wander, jitter, noise, seed);
+        char comment[128];
+        snprintf(comment, sizeof comment, "drift-bench synthetic, %d frames, jitter %.0fus, noise %.0f/s", frames, jitter, noise);
+        if (!writeWidthTrace(writePath, lastWidths, comment)) {
+            fprintf(stderr, "drift-bench: can't write %s\n", writePath);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Fetch and unpack the failed decode journal of apps/oregon-decode (apps/tracejournal.h)
+//
+// With -d it sends 'J' to the receiver and reads until the "J end" line; otherwise it reads a
+// saved capture (-i, or stdin) with the "J <hex>" lines in it. Each record's CRC is checked,
+// the widths unpacked, and a line printed per record. Then:
+//   -o PREFIX     each record as a width trace, PREFIX-<seq>.txt (see host/trace.h), for
+//                 drift-bench --trace and the rest of the replay tooling
+//   --replay      run OregonDecoderV2 and OregonDecoderPLL over each record and say what they made of it
+//   --selftest N  no receiver: N random records through TraceJournal on a RAM flash, rebooting
+//                 part way, checking every record that should still be there comes back the same,
+//                 and how evenly the sectors were erased
+//
+// Usage: journal-dump [-d device | -i file] [-o prefix] [--replay] [--selftest N]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <random>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/oregon.h"
+#include "../../apps/oregonpll.h"
+#include "../../apps/tracejournal.h"
+#include "../journalrecord.h"
+#include "../trace.h"
+
+static int openSerial(const char* device) {
+    int fd = open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+template <typename Decoder>
+static int replay(const std::vector<uint16_t>& widths) {
+    Decoder decoder;
+    int readings = 0;
+    for (size_t i = 0; i <= widths.size(); i++) {
+        // and a gap at the end, which the burst was ended by
+        if (!decoder.nextPulse(i < widths.size() ? widths[i] : 10000)) continue;
+        uint8_t len;
+        const uint8_t* data = decoder.getData(len);
+        uint16_t type;
+        uint8_t channel, rollingCode, hum;
+        int16_t temp;
+        bool battOK;
+        if (data && decodeTempHumidity(data, len, type, channel, rollingCode, temp, hum, battOK)) readings++;
+        decoder.resetDecoder();
+    }
+    return readings;
+}
+
+// Flash stand in for the self test: erase sets 0xff, program can only clear bits, like the real thing
+template <uint32_t Size>
+struct RamFlash {
+    static constexpr uint32_t SECTOR = 4096;
+    static constexpr uint32_t PAGE = 256;
+    uint8_t mem[Size];
+    uint32_t eraseCount[Size / SECTOR] = {};
+
+    RamFlash() { memset(mem, 0xff, sizeof mem); }
+    uint32_t size() const { return Size; }
+    void erase(uint32_t offset) {
+        memset(mem + offset, 0xff, SECTOR);
+        eraseCount[offset / SECTOR]++;
+    }
+    void program(uint32_t offset, const uint8_t* page) {
+        for (uint32_t i = 0; i < PAGE; i++) mem[offset + i] &= page[i];
+    }
+    const uint8_t* read(uint32_t offset) const { return mem + offset; }
+};
+
+static int selftest(int records) {
+    typedef RamFlash<64 * 1024> Flash;
+    static Flash flash;
+    std::mt19937_64 rng(1);
+    std::vector<std::vector<uint16_t>> written;
+    uint32_t time_ms = 0;
+    uint64_t widths = 0, pages = 0;
+    for (int boot = 0; boot < 2; boot++) {
+        // A new journal on the same flash is a reboot
+        static TraceJournal<Flash>* journal;
+        journal = new TraceJournal<Flash>(flash);
+        uint32_t found = journal->begin();
+        if (boot) printf("after reboot: %u records found\n", found);
+        for (int i = 0; i < records / 2; i++) {
+            // Something like a frame: preamble, then one and two chip widths with jitter, sometimes junk
+            std::vector<uint16_t> w;
+            int n = 100 + rng() % 500;
+            for (int k = 0; k < n; k++) {
+                int base = k < 64 ? 976 : (rng() % 2 ? 488 : 976);
+                if (rng() % 20 == 0) base = 50 + rng() % 3000;
+                w.push_back(uint16_t(base + int(rng() % 61) - 30));
+            }
+            time_ms += JOURNAL_REFILL_MS;
+            if (!journal->add(JOURNAL_NO_FRAME, 160, time_ms, w.data(), uint16_t(w.size()))) {
+                printf("add refused\n");
+                return 1;
+            }
+            while (journal->service()) {}
+            written.push_back(w);
+            widths += w.size();
+        }
+        const auto& st = journal->stats();
+        pages += st.pages;
+        printf("boot %d: %u records, %u truncated, %u pages, %u erases\n", boot, st.records, st.truncated, st.pages, st.erases);
+        if (boot) {
+            // Oldest first, and each must match what was written (truncated ones up to where they stop)
+            std::vector<Record> back;
+            uint32_t n = journal->forEach([&](const uint8_t* rec, uint32_t bytes) {
+                Record r;
+                memcpy(&r.header, rec, sizeof r.header);
+                r.widths.resize(r.header.widths);
+                if (!journalDecode(rec + JOURNAL_HEADER_BYTES, r.header.bytes, r.header.widths, r.widths.data())) r.widths.clear();
+                back.push_back(r);
+                (void)bytes;
+            });
+            uint32_t bad = 0;
+            for (size_t i = 0; i < back.size(); i++) {
+                const Record& r = back[i];
+                if (i && r.header.seq != back[i - 1].header.seq + 1) bad++;
+                size_t k = r.header.seq - 1;
+                if (k >= written.size() || r.widths.empty() ||
+                    memcmp(r.widths.data(), written[k].data(), r.widths.size() * sizeof(uint16_t))) {
+                    bad++;
+                }
+            }
+            if (back.empty() || back.back().header.seq != written.size()) bad++;
+            uint32_t lo = UINT32_MAX, hi = 0;
+            for (uint32_t e : flash.eraseCount) {
+                lo = std::min(lo, e);
+                hi = std::max(hi, e);
+            }
+            printf("read back %u records (newest %zu written), %u bad; sector erases min %u max %u\n", n, written.size(), bad, lo, hi);
+            printf("%.2f bytes per width, %.1f pages per record\n", 256.0 * pages / widths, double(pages) / written.size());
+            return bad ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* device = nullptr;
+    const char* input = nullptr;
+    const char* prefix = nullptr;
+    bool doReplay = false;
+    int selftestRecords = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-d") && hasArg) device = argv[++i];
+        else if (!strcmp(argv[i], "-i") && hasArg) input = argv[++i];
+        else if (!strcmp(argv[i], "-o") && hasArg) prefix = argv[++i];
+        else if (!strcmp(argv[i], "--replay")) doReplay = true;
+        else if (!strcmp(argv[i], "--selftest") && hasArg) selftestRecords = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: journal-dump [-d device | -i file] [-o prefix] [--replay] [--selftest N]\n");
+            return 2;
+        }
+    }
+    if (selftestRecords) return selftest(selftestRecords);
+
+    FILE* in = stdin;
+    if (device) {
+        int fd = openSerial(device);
+        if (fd < 0 || write(fd, "J", 1) != 1) {
+            fprintf(stderr, "journal-dump: can't open %s\n", device);
+            return 1;
+        }
+        in = fdopen(fd, "r");
+    } else if (input) {
+        in = fopen(input, "r");
+        if (!in) {
+            fprintf(stderr, "journal-dump: can't read %s\n", input);
+            return 1;
+        }
+    }
+
+    // Records are at most a few kB of hex
+    static char line[16384];
+    uint32_t records = 0, damaged = 0;
+    while (fgets(line, sizeof line, in)) {
+        // The spinner line ends in \r, so the J line can come after one
+        char* p = strrchr(line, '\r');
+        p = p && p[1] ? p + 1 : line;
+        if (!strncmp(p, "J end", 5)) break;
+        Record r;
+        bool bad;
+        if (!parseRecord(p, r, bad)) {
+            if (bad) damaged++;
+            continue;
+        }
+        records++;
+        const JournalHeader& h = r.header;
+        printf("%6u  t=%10.3fs  %-8s  %6.1fdBm  %4u widths  %4u bytes", h.seq, h.time_ms / 1000.0, journalReasonName(h.reason),
+            h.rssi == 0xff ? 0.0 : h.rssi / -2.0, h.widths, h.bytes);
+        if (doReplay) printf("  replay: v2 %d pll %d", replay<OregonDecoderV2>(r.widths), replay<OregonDecoderPLL>(r.widths));
+        printf("\n");
+        if (prefix) {
+            char path[512], comment[128];
+            snprintf(path, sizeof path, "%s-%u.txt", prefix, h.seq);
+            snprintf(comment, sizeof comment, "journal record %u, %s, t=%ums, rssi byte %u", h.seq, journalReasonName(h.reason),
+                h.time_ms, h.rssi);
+            std::vector<uint32_t> widths(r.widths.begin(), r.widths.end());
+            widths.push_back(100000);
+            if (!writeWidthTrace(path, widths, comment)) {
+                fprintf(stderr, "journal-dump: can't write %s\n", path);
+                return 1;
+            }
+        }
+    }
+    printf("%u records, %u damaged\n", records, damaged);
+    return 0;
+}
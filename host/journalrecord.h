@@ -0,0 +1,46 @@
+#ifndef HOST_JOURNALRECORD_H_
+#define HOST_JOURNALRECORD_H_
+
+// The "J <hex>" lines oregon-decode prints for its failed decode journal (apps/tracejournal.h),
+// back into a record: header and widths, with the CRC checked. journal-dump and batch-decode read them.
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../apps/tracejournal.h"
+
+struct Record {
+    JournalHeader header;
+    std::vector<uint16_t> widths;
+};
+
+inline int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// One "J <hex>" line; false if it isn't one, or the record is damaged
+inline bool parseRecord(const char* line, Record& r, bool& damaged) {
+    damaged = false;
+    if (line[0] != 'J' || line[1] != ' ' || !strncmp(line, "J end", 5)) return false;
+    std::vector<uint8_t> bytes;
+    for (const char* p = line + 2; hexNibble(p[0]) >= 0 && hexNibble(p[1]) >= 0; p += 2) {
+        bytes.push_back(uint8_t(hexNibble(p[0]) << 4 | hexNibble(p[1])));
+    }
+    damaged = true;
+    if (bytes.size() < JOURNAL_HEADER_BYTES + 2) return false;
+    memcpy(&r.header, bytes.data(), sizeof r.header);
+    uint32_t total = JOURNAL_HEADER_BYTES + r.header.bytes;
+    if (r.header.magic != JOURNAL_MAGIC || bytes.size() != total + 2) return false;
+    uint16_t crc = journalCrc(bytes.data(), total);
+    if (bytes[total] != uint8_t(crc) || bytes[total + 1] != uint8_t(crc >> 8)) return false;
+    r.widths.resize(r.header.widths);
+    if (!journalDecode(bytes.data() + JOURNAL_HEADER_BYTES, r.header.bytes, r.header.widths, r.widths.data())) return false;
+    damaged = false;
+    return true;
+}
+
+#endif
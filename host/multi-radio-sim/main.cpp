@@ -0,0 +1,246 @@
+// Host simulation of apps/multi-radio
+//
+// Part 1 runs the same capture / decode / merge code as the firmware against simulated radios:
+// a set of synthetic Oregon sensors, each radio hearing each transmission with its own loss rate
+// and its own noise, edges delivered through the pinhal host fallback into per radio EdgeCapture rings
+// (so the ISR path is the real one), and the loop draining them every loop period.
+// It reports decoded frames per radio, merged readings against what was transmitted, and host throughput.
+//
+// Part 2 checks SPI arbitration: one thread per radio doing RSSI polls through SpiArbiter,
+// with one shared bus or one bus per radio, and reports achieved poll rate and contention.
+//
+// Usage: multi-radio-sim [--radios N] [--sensors S] [--hours H] [--loss P] [--noise B]
+//                        [--loop-us U] [--poll-us U] [--spi-us U] [--seconds S]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/pinhal.h"
+#include "../../apps/edgecapture.h"
+#include "../../apps/framededupe.h"
+#include "../../apps/spibus.h"
+#include "../oregonsynth.h"
+
+#define MAX_RADIOS 4
+
+struct SimRadio {
+    EdgeCapture capture;
+    OregonDecoderV2 decoder;
+    uint32_t frames = 0;
+    uint32_t decoded = 0;
+};
+
+static SimRadio simRadios[MAX_RADIOS];
+static const unsigned simPins[MAX_RADIOS] = { 11, 21, 2, 3 };
+static uint64_t simNow_us = 0;
+
+static uint64_t simClock() { return simNow_us; }
+
+template <int Index>
+void simIsr() {
+    simRadios[Index].capture.onEdge(pinhal::micros32());
+}
+
+static void attachAll() {
+    pinhal::EdgeIrq<11, simIsr<0>>::attach();
+    pinhal::EdgeIrq<21, simIsr<1>>::attach();
+    pinhal::EdgeIrq<2, simIsr<2>>::attach();
+    pinhal::EdgeIrq<3, simIsr<3>>::attach();
+}
+
+struct TimedEdge {
+    uint64_t t_us;
+    uint8_t radio;
+    uint8_t level;
+};
+
+static double wallSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void runDecodeSimulation(int numRadios, int numSensors, double hours, double loss, double noise, uint32_t loop_us) {
+    std::mt19937_64 rng(1234);
+    uint64_t duration_us = uint64_t(hours * 3600e6);
+
+    std::vector<SynthTransmitter> tx;
+    for (int s = 0; s < numSensors; s++) {
+        SynthTransmitter t;
+        t.reading = { uint16_t(s % 3 == 2 ? 0xec40 : 0x1d20), uint8_t(1 + s % 3), uint8_t(0x10 + s * 7),
+                      int16_t(100 + s * 13), uint8_t(40 + s % 50), true };
+        // The real sensors are around 39s, differing a little per channel; spread the phase
+        t.period_us = 39000000 + uint64_t(s % 3) * 1000000 + uint64_t(s) * 50000;
+        t.phase_us = uint64_t(rng() % t.period_us);
+        t.drift = 1.0 + ((int(rng() % 200) - 100) / 10000.0);
+        tx.push_back(t);
+    }
+
+    // Each radio hears each pair (or not) independently, plus its own noise
+    std::uniform_real_distribution<double> u(0, 1);
+    std::vector<TimedEdge> timeline;
+    uint64_t transmitted = 0;
+    for (int r = 0; r < numRadios; r++) {
+        std::vector<OnInterval> on;
+        std::vector<OnInterval> heard;
+        std::mt19937_64 txRng(99); // same jitter for every radio, the transmission is the same
+        for (auto& t : tx) {
+            for (uint64_t start = t.phase_us; start + 500000 < duration_us; start += t.period_us) {
+                std::vector<OnInterval> pair;
+                uint64_t end = appendPair(t.reading, start, t.drift, 15, txRng, pair);
+                if (r == 0) transmitted++;
+                if (u(rng) >= loss) {
+                    on.insert(on.end(), pair.begin(), pair.end());
+                    heard.push_back({ start, end });
+                }
+            }
+        }
+        std::sort(heard.begin(), heard.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+        appendNoise(0, duration_us, noise, rng, on, &heard);
+        std::vector<uint64_t> edges;
+        intervalsToEdges(on, edges);
+        for (size_t i = 0; i < edges.size(); i++) {
+            timeline.push_back({ edges[i], uint8_t(r), uint8_t(i & 1 ? 0 : 1) });
+        }
+    }
+    std::sort(timeline.begin(), timeline.end(), [](const TimedEdge& a, const TimedEdge& b) { return a.t_us < b.t_us; });
+
+    pinhal::host::clock_us = simClock;
+    attachAll();
+    FrameDedupe<8> dedupe(500);
+    uint64_t merged = 0, multiRadio = 0;
+
+    double w0 = wallSeconds();
+    size_t next = 0;
+    for (uint64_t loopAt = 0; loopAt < duration_us + 1000000; loopAt += loop_us) {
+        // Edges that happened since the last loop pass go in through the "ISR"
+        for (; next < timeline.size() && timeline[next].t_us <= loopAt; next++) {
+            simNow_us = timeline[next].t_us;
+            pinhal::host::setInput(simPins[timeline[next].radio], timeline[next].level);
+        }
+        simNow_us = loopAt;
+        uint32_t now_ms = uint32_t(loopAt / 1000);
+        for (int r = 0; r < numRadios; r++) {
+            SimRadio& radio = simRadios[r];
+            uint32_t width_us;
+            while (radio.capture.nextWidth(width_us)) {
+                if (!radio.decoder.nextPulse(width_us)) continue;
+                radio.frames++;
+                uint8_t len;
+                const uint8_t* data = radio.decoder.getData(len);
+                uint16_t actualType;
+                uint8_t channel, rollingCode, hum;
+                int16_t temp;
+                bool battOK;
+                if (decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK)) {
+                    radio.decoded++;
+                    dedupe.offer(uint8_t(r), data, checkedLength(data, len), -80.0f - r, now_ms);
+                }
+                radio.decoder.resetDecoder();
+            }
+        }
+        MergedFrame f;
+        while (dedupe.poll(now_ms, f)) {
+            merged++;
+            if (f.radios & (f.radios - 1)) multiRadio++;
+        }
+    }
+    double w1 = wallSeconds();
+
+    printf("Decode: %d radios, %d sensors, %.1f h simulated, loss %.0f%% per radio, noise %.0f bursts/s\n",
+        numRadios, numSensors, hours, loss * 100, noise);
+    for (int r = 0; r < numRadios; r++) {
+        printf("  radio %c  edges %9u  overflow %6u  frames %7u  decoded %7u (%.1f%% of pairs)\n", 'A' + r,
+            simRadios[r].capture.edgeCount(), simRadios[r].capture.overflowCount(), simRadios[r].frames,
+            simRadios[r].decoded, 100.0 * simRadios[r].decoded / 2 / transmitted);
+    }
+    printf("  transmitted %llu pairs, merged output %llu (%.1f%%), %llu heard on more than one radio\n",
+        (unsigned long long)transmitted, (unsigned long long)merged, 100.0 * merged / transmitted,
+        (unsigned long long)multiRadio);
+    printf("  expected with independent loss: %.1f%%\n", 100.0 * (1 - std::pow(loss, numRadios)));
+    printf("  %zu edges in %.2f s host time, %.1f M edges/s\n", timeline.size(), w1 - w0, timeline.size() / (w1 - w0) / 1e6);
+    pinhal::host::clock_us = nullptr;
+}
+
+static void busyWait_us(uint32_t us) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < end) {}
+}
+
+static void runSpiSimulation(int numRadios, bool shared, uint32_t poll_us, uint32_t spi_us, double seconds) {
+    std::vector<std::unique_ptr<SpiArbiter>> buses;
+    for (int i = 0; i < (shared ? 1 : numRadios); i++) buses.emplace_back(new SpiArbiter());
+    std::vector<uint64_t> polls(numRadios, 0);
+    std::vector<std::thread> threads;
+    auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    for (int r = 0; r < numRadios; r++) {
+        threads.emplace_back([&, r] {
+            SpiArbiter& bus = *buses[shared ? 0 : r];
+            auto next = std::chrono::steady_clock::now();
+            while (std::chrono::steady_clock::now() < end) {
+                {
+                    SpiArbiter::Lock lock(bus);
+                    busyWait_us(spi_us);    // the bit banged RSSI read
+                }
+                polls[r]++;
+                next += std::chrono::microseconds(poll_us);
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    uint64_t total = 0, transactions = 0, contended = 0, waited = 0;
+    for (auto p : polls) total += p;
+    for (auto& b : buses) {
+        transactions += b->stats().transactions;
+        contended += b->stats().contended;
+        waited += b->stats().waited_us;
+    }
+    double demanded = numRadios * seconds * 1e6 / poll_us;
+    printf("SPI: %d radios on %s, poll every %u us, %u us per transaction (bus load demanded %.0f%%)\n",
+        numRadios, shared ? "one shared bus" : "separate buses", poll_us, spi_us,
+        100.0 * numRadios * spi_us / poll_us / (shared ? 1 : numRadios));
+    printf("  polls %llu of %.0f demanded (%.1f%%), contended %.1f%%, mean wait %.1f us\n",
+        (unsigned long long)total, demanded, 100.0 * total / demanded,
+        transactions ? 100.0 * contended / transactions : 0.0, contended ? double(waited) / contended : 0.0);
+}
+
+int main(int argc, char** argv) {
+    int numRadios = 2, numSensors = 6;
+    double hours = 2, loss = 0.2, noise = 20, seconds = 2;
+    uint32_t loop_us = 1000, poll_us = 1000, spi_us = 40;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--radios") && hasArg) numRadios = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--sensors") && hasArg) numSensors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loss") && hasArg) loss = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--loop-us") && hasArg) loop_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--poll-us") && hasArg) poll_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--spi-us") && hasArg) spi_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && hasArg) seconds = atof(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: multi-radio-sim [--radios N] [--sensors S] [--hours H] [--loss P] [--noise B]\n"
+                            "                       [--loop-us U] [--poll-us U] [--spi-us U] [--seconds S]\n");
+            return 2;
+        }
+    }
+    if (numRadios < 1 || numRadios > MAX_RADIOS) {
+        fprintf(stderr, "multi-radio-sim: 1 to %d radios\n", MAX_RADIOS);
+        return 2;
+    }
+    runDecodeSimulation(numRadios, numSensors, hours, loss, noise, loop_us);
+    runSpiSimulation(numRadios, true, poll_us, spi_us, seconds);
+    runSpiSimulation(numRadios, false, poll_us, spi_us, seconds);
+    return 0;
+}
@@ -0,0 +1,311 @@
+// Host side ingest daemon
+// Reads the serial output of apps/oregon-decode (from a tty or stdin), parses the reading lines
+// and appends them to the columnar store described in tsstore.h
+//
+// Usage: ook-ingest [-d /dev/ttyACM0] [-b 115200] [-r receiver] [-s store] [--dedupe-ms 500] [--rtl433]
+//
+// With --rtl433 each reading line is also written to stdout the way rtl_433 -F json prints it
+// (apps/rtl433.h), with the time it arrived, so consumers of rtl_433 can be pointed at this instead.
+//
+// Everything on the hot path is fixed size: one read buffer, one table of open sensors,
+// and the per sensor pending rows, so a busy receiver costs a parse and a 24 byte write() per reading.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+
+#include "../tsstore.h"
+#include "../readingparser.h"
+#include "../../apps/rtl433.h"
+
+using namespace tsstore;
+
+#define MAX_SENSORS 256
+#define READ_BUFFER_BYTES 4096
+
+struct SensorSink {
+    bool used;
+    SensorKey key;
+    int walFd;
+    int otsFd;
+    int pending;
+    Row last;
+    Row rows[BLOCK_ROWS];
+};
+
+static SensorSink sinks[MAX_SENSORS];
+static char storeDir[512];
+static volatile sig_atomic_t stopping = 0;
+
+static int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool writeAll(int fd, const void* buf, size_t n) {
+    const uint8_t* p = (const uint8_t*)buf;
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= size_t(w);
+    }
+    return true;
+}
+
+static void sealBlock(SensorSink& s) {
+    static uint8_t payload[MAX_PAYLOAD];
+    BlockHeader hdr;
+    size_t n = encodeBlock(s.rows, s.pending, hdr, payload);
+    if (!writeAll(s.otsFd, &hdr, sizeof hdr) || !writeAll(s.otsFd, payload, n)) {
+        fprintf(stderr, "ook-ingest: writing block failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    fsync(s.otsFd);
+    // Only discard the wal once the block is durable
+    if (ftruncate(s.walFd, 0) != 0) {
+        fprintf(stderr, "ook-ingest: truncating wal failed: %s\n", strerror(errno));
+    }
+    s.pending = 0;
+}
+
+// A crash part way through sealBlock() leaves a block cut short at the end of the .ots; ook-query stops at the
+// first bad block, so anything appended after it would be lost. Cut the file back to the end of the last whole
+// block, and return that block's tLast_ms (INT64_MIN if there are none) for the wal replay
+static int64_t repairOts(int fd, const char* path) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return INT64_MIN;
+    off_t size = st.st_size;
+    off_t off = 0;
+    int64_t tLast_ms = INT64_MIN;
+    BlockHeader hdr;
+    while (off + off_t(sizeof hdr) <= size && pread(fd, &hdr, sizeof hdr, off) == ssize_t(sizeof hdr)) {
+        if (hdr.magic != BLOCK_MAGIC || hdr.payloadBytes > MAX_PAYLOAD || off + off_t(sizeof hdr + hdr.payloadBytes) > size) break;
+        off += sizeof hdr + hdr.payloadBytes;
+        tLast_ms = hdr.tLast_ms;
+    }
+    if (off < size) {
+        fprintf(stderr, "ook-ingest: %s: %lld bytes after the last whole block, cutting them off\n", path, (long long)(size - off));
+        if (ftruncate(fd, off) != 0) {
+            fprintf(stderr, "ook-ingest: truncating %s failed: %s\n", path, strerror(errno));
+        }
+    }
+    return tLast_ms;
+}
+
+static SensorSink* openSink(const SensorKey& key) {
+    uint32_t h = key.packed() * 2654435761u;
+    for (int i = 0; i < MAX_SENSORS; i++) {
+        SensorSink& s = sinks[(h + i) % MAX_SENSORS];
+        if (s.used && s.key == key) return &s;
+        if (!s.used) {
+            char stem[32];
+            char path[600];
+            sensorFileStem(key, stem, sizeof stem);
+            snprintf(path, sizeof path, "%s/%s.ots", storeDir, stem);
+            s.otsFd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+            int64_t sealed_ms = s.otsFd >= 0 ? repairOts(s.otsFd, path) : INT64_MIN;
+            snprintf(path, sizeof path, "%s/%s.wal", storeDir, stem);
+            s.walFd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+            if (s.otsFd < 0 || s.walFd < 0) {
+                fprintf(stderr, "ook-ingest: cannot open %s: %s\n", path, strerror(errno));
+                exit(1);
+            }
+            // Recover anything a previous run left in the wal
+            s.pending = 0;
+            ssize_t n = pread(s.walFd, s.rows, sizeof s.rows, 0);
+            if (n > 0) s.pending = int(n / sizeof(Row));
+            // So the second copy of a pair straddling the restart is still dropped
+            if (s.pending > 0) s.last = s.rows[s.pending - 1];
+            else memset(&s.last, 0, sizeof s.last);
+            // Rows already in the last block are there from a crash between sealing it and truncating the wal;
+            // the wal is in time order, so they are the front of it
+            int sealed = 0;
+            while (sealed < s.pending && s.rows[sealed].t_ms <= sealed_ms) sealed++;
+            if (sealed) {
+                s.pending -= sealed;
+                memmove(s.rows, s.rows + sealed, s.pending * sizeof(Row));
+            }
+            // A row cut short by the crash would sit in front of every row appended after it
+            if (ftruncate(s.walFd, sealed ? 0 : off_t(s.pending) * sizeof(Row)) != 0 ||
+                (sealed && !writeAll(s.walFd, s.rows, s.pending * sizeof(Row)))) {
+                fprintf(stderr, "ook-ingest: rewriting wal failed: %s\n", strerror(errno));
+            }
+            s.key = key;
+            s.used = true;
+            if (s.pending == BLOCK_ROWS) sealBlock(s);
+            return &s;
+        }
+    }
+    fprintf(stderr, "ook-ingest: more than %d sensors, ignoring %04x\n", MAX_SENSORS, key.type);
+    return nullptr;
+}
+
+static void appendReading(const Reading& r, int64_t t_ms, int dedupe_ms) {
+    SensorKey key = { r.type, r.channel, r.rollingCode };
+    SensorSink* s = openSink(key);
+    if (!s) return;
+
+    // Each transmission is sent twice ~10ms apart, and oregon-decode prints both if they decode
+    if (dedupe_ms > 0 && t_ms - s->last.t_ms < dedupe_ms &&
+        s->last.temp == r.temp && s->last.humidity == r.humidity) {
+        return;
+    }
+    Row& row = s->rows[s->pending];
+    memset(&row, 0, sizeof row);
+    row.t_ms = t_ms;
+    row.seq = r.seq;
+    row.temp = r.temp;
+    row.rssi = r.rssi;
+    row.humidity = r.humidity;
+    row.battOK = r.battOK;
+    if (!writeAll(s->walFd, &row, sizeof row)) {
+        fprintf(stderr, "ook-ingest: wal write failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    s->last = row;
+    s->pending++;
+    if (s->pending == BLOCK_ROWS) {
+        sealBlock(*s);
+    }
+}
+
+static speed_t baudConstant(int baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return B115200;
+    }
+}
+
+static int openSerial(const char* device, int baud) {
+    int fd = open(device, O_RDONLY | O_NOCTTY);
+    if (fd < 0) return -1;
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        // USB CDC ignores the baud rate, but a Pi UART (as I used for the console) does not
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baudConstant(baud));
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static void onSignal(int) { stopping = 1; }
+
+static void usage() {
+    fprintf(stderr, "Usage: ook-ingest [-d device] [-b baud] [-r receiver] [-s storedir] [--dedupe-ms N] [--rtl433]\n");
+    fprintf(stderr, "Reads oregon-decode output from device (default stdin) into storedir/receiver\n");
+}
+
+int main(int argc, char** argv) {
+    const char* device = nullptr;
+    const char* receiver = "default";
+    const char* store = "ookstore";
+    int baud = 115200;
+    int dedupe_ms = 500;
+    bool rtl433 = false;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-d") && hasArg) device = argv[++i];
+        else if (!strcmp(argv[i], "-b") && hasArg) baud = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && hasArg) receiver = argv[++i];
+        else if (!strcmp(argv[i], "-s") && hasArg) store = argv[++i];
+        else if (!strcmp(argv[i], "--dedupe-ms") && hasArg) dedupe_ms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rtl433")) rtl433 = true;
+        else { usage(); return 2; }
+    }
+
+    mkdir(store, 0755);
+    snprintf(storeDir, sizeof storeDir, "%s/%s", store, receiver);
+    if (mkdir(storeDir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "ook-ingest: cannot create %s: %s\n", storeDir, strerror(errno));
+        return 1;
+    }
+
+    int fd = 0;
+    if (device) {
+        fd = openSerial(device, baud);
+        if (fd < 0) {
+            fprintf(stderr, "ook-ingest: cannot open %s: %s\n", device, strerror(errno));
+            return 1;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    static char buf[READ_BUFFER_BYTES];
+    size_t have = 0;
+    uint64_t lines = 0, readings = 0;
+    while (!stopping) {
+        ssize_t n = read(fd, buf + have, sizeof buf - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        have += size_t(n);
+
+        // The spinner lines end in \r only, so treat either as a line end
+        int64_t t_ms = nowMs();
+        const char* p = buf;
+        const char* end = buf + have;
+        for (const char* q = p; q < end; q++) {
+            if (*q == '\n' || *q == '\r') {
+                Reading r;
+                if (q > p && parseReadingLine(p, q, r)) {
+                    appendReading(r, t_ms, dedupe_ms);
+                    readings++;
+                    if (rtl433) {
+                        // Every copy, as rtl_433 does
+                        char when[32], json[256];
+                        time_t secs = time_t(t_ms / 1000);
+                        strftime(when, sizeof when, "%Y-%m-%d %H:%M:%S", localtime(&secs));
+                        if (rtl433Json(json, sizeof json, when, r.type, r.channel, r.rollingCode, r.temp, r.humidity, r.battOK)) {
+                            printf("%s\n", json);
+                            fflush(stdout);
+                        }
+                    }
+                }
+                lines++;
+                p = q + 1;
+            }
+        }
+        have = size_t(end - p);
+        if (have == sizeof buf) {
+            // A line longer than the buffer cannot be a reading
+            have = 0;
+        } else if (have > 0) {
+            memmove(buf, p, have);
+        }
+    }
+    // Rows still pending stay in the wal, and get picked up on the next start (or by ook-query)
+    for (auto& s : sinks) {
+        if (s.used) {
+            fsync(s.walFd);
+            close(s.walFd);
+            close(s.otsFd);
+        }
+    }
+    fprintf(stderr, "ook-ingest: %llu lines, %llu readings\n", (unsigned long long)lines, (unsigned long long)readings);
+    return 0;
+}
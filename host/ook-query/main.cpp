@@ -0,0 +1,227 @@
+// Range query over the store written by ook-ingest
+//
+// Usage: ook-query [-s store] [-r receiver] [-S sensor] [--from T] [--to T] [--summary]
+//   T is unix seconds or an ISO date/time in UTC (2022-07-01 or 2022-07-01T12:00[:00])
+//   sensor is the file stem, e.g. 1d20-1-27
+//
+// Files are mapped rather than read, and only the block headers are touched for blocks
+// outside the time range, so a query over months of data is dominated by the rows it returns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+
+#include "../tsstore.h"
+
+using namespace tsstore;
+
+struct Summary {
+    uint64_t count;
+    int64_t tFirst_ms;
+    int64_t tLast_ms;
+    int tempMin;
+    int tempMax;
+    int64_t tempSum;
+    int64_t rssiSum;
+};
+
+struct Query {
+    int64_t from_ms;
+    int64_t to_ms;
+    bool summary;
+    uint64_t rows;
+    uint64_t blocksRead;
+    uint64_t blocksSkipped;
+};
+
+static bool parseTime(const char* s, int64_t& ms) {
+    struct tm tm;
+    memset(&tm, 0, sizeof tm);
+    const char* rest = strptime(s, "%Y-%m-%d", &tm);
+    if (rest) {
+        if (*rest == 'T' || *rest == ' ') {
+            const char* r2 = strptime(rest + 1, "%H:%M:%S", &tm);
+            if (!r2) r2 = strptime(rest + 1, "%H:%M", &tm);
+            rest = r2;
+        }
+        if (!rest || *rest) return false;
+        ms = int64_t(timegm(&tm)) * 1000;
+        return true;
+    }
+    char* end;
+    double v = strtod(s, &end);
+    if (end == s || *end) return false;
+    ms = int64_t(v * 1000);
+    return true;
+}
+
+static void emitRow(Query& q, const char* receiver, const char* sensor, const Row& r, Summary& sum) {
+    if (r.t_ms < q.from_ms || r.t_ms >= q.to_ms) return;
+    q.rows++;
+    if (q.summary) {
+        if (sum.count == 0) {
+            sum.tFirst_ms = r.t_ms;
+            sum.tempMin = sum.tempMax = r.temp;
+        }
+        sum.count++;
+        sum.tLast_ms = r.t_ms;
+        if (r.temp < sum.tempMin) sum.tempMin = r.temp;
+        if (r.temp > sum.tempMax) sum.tempMax = r.temp;
+        sum.tempSum += r.temp;
+        sum.rssiSum += r.rssi;
+    } else {
+        printf("%lld.%03d,%s,%s,%d,%.1f,%d,%s,%.1f\n",
+            (long long)(r.t_ms / 1000), int(r.t_ms % 1000), receiver, sensor, r.seq,
+            r.temp / 10.F, r.humidity, r.battOK ? "ok" : "flat", r.rssi / 10.F);
+    }
+}
+
+static const uint8_t* mapFile(const char* path, size_t& size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    const uint8_t* p = nullptr;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = size_t(st.st_size);
+        void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            madvise(m, size, MADV_SEQUENTIAL);
+            p = (const uint8_t*)m;
+        }
+    }
+    close(fd);
+    return p;
+}
+
+static void querySensor(Query& q, const char* dir, const char* receiver, const char* stem) {
+    static Row rows[BLOCK_ROWS];
+    Summary sum;
+    memset(&sum, 0, sizeof sum);
+    char path[1400];
+
+    snprintf(path, sizeof path, "%s/%s.ots", dir, stem);
+    size_t size = 0;
+    const uint8_t* base = mapFile(path, size);
+    if (base) {
+        size_t off = 0;
+        while (off + sizeof(BlockHeader) <= size) {
+            BlockHeader hdr;
+            memcpy(&hdr, base + off, sizeof hdr);
+            if (hdr.magic != BLOCK_MAGIC || off + sizeof hdr + hdr.payloadBytes > size) {
+                fprintf(stderr, "ook-query: %s: bad block at offset %zu, ignoring the rest\n", path, off);
+                break;
+            }
+            const uint8_t* payload = base + off + sizeof hdr;
+            off += sizeof hdr + hdr.payloadBytes;
+            if (hdr.tLast_ms < q.from_ms || hdr.tFirst_ms >= q.to_ms) {
+                q.blocksSkipped++;
+                continue;
+            }
+            q.blocksRead++;
+            if (!decodeBlock(hdr, payload, rows)) {
+                fprintf(stderr, "ook-query: %s: corrupt block payload\n", path);
+                continue;
+            }
+            for (int i = 0; i < hdr.count; i++) {
+                emitRow(q, receiver, stem, rows[i], sum);
+            }
+        }
+        munmap((void*)base, size);
+    }
+
+    // The unsealed tail
+    snprintf(path, sizeof path, "%s/%s.wal", dir, stem);
+    base = mapFile(path, size);
+    if (base) {
+        for (size_t off = 0; off + sizeof(Row) <= size; off += sizeof(Row)) {
+            Row r;
+            memcpy(&r, base + off, sizeof r);
+            emitRow(q, receiver, stem, r, sum);
+        }
+        munmap((void*)base, size);
+    }
+
+    if (q.summary && sum.count > 0) {
+        printf("%s,%s,%llu,%lld,%lld,%.1f,%.1f,%.1f,%.1f\n", receiver, stem,
+            (unsigned long long)sum.count, (long long)(sum.tFirst_ms / 1000), (long long)(sum.tLast_ms / 1000),
+            sum.tempMin / 10.F, sum.tempMax / 10.F, sum.tempSum / 10.0 / sum.count, sum.rssiSum / 10.0 / sum.count);
+    }
+}
+
+static void queryReceiver(Query& q, const char* store, const char* receiver, const char* sensor) {
+    char dir[1024];
+    snprintf(dir, sizeof dir, "%s/%s", store, receiver);
+    DIR* d = opendir(dir);
+    if (!d) return;
+    while (struct dirent* e = readdir(d)) {
+        const char* dot = strrchr(e->d_name, '.');
+        if (!dot || strcmp(dot, ".ots")) continue;
+        char stem[256];
+        snprintf(stem, sizeof stem, "%.*s", int(dot - e->d_name), e->d_name);
+        SensorKey k;
+        if (!parseSensorFileStem(stem, k)) continue;
+        if (sensor && strcmp(sensor, stem)) continue;
+        querySensor(q, dir, receiver, stem);
+    }
+    closedir(d);
+}
+
+static void usage() {
+    fprintf(stderr, "Usage: ook-query [-s store] [-r receiver] [-S sensor] [--from T] [--to T] [--summary]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* store = "ookstore";
+    const char* receiver = nullptr;
+    const char* sensor = nullptr;
+    Query q;
+    memset(&q, 0, sizeof q);
+    q.from_ms = INT64_MIN;
+    q.to_ms = INT64_MAX;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-s") && hasArg) store = argv[++i];
+        else if (!strcmp(argv[i], "-r") && hasArg) receiver = argv[++i];
+        else if (!strcmp(argv[i], "-S") && hasArg) sensor = argv[++i];
+        else if (!strcmp(argv[i], "--from") && hasArg) {
+            if (!parseTime(argv[++i], q.from_ms)) { usage(); return 2; }
+        } else if (!strcmp(argv[i], "--to") && hasArg) {
+            if (!parseTime(argv[++i], q.to_ms)) { usage(); return 2; }
+        } else if (!strcmp(argv[i], "--summary")) q.summary = true;
+        else { usage(); return 2; }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (q.summary) {
+        printf("receiver,sensor,count,first,last,temp_min,temp_max,temp_mean,rssi_mean\n");
+    } else {
+        printf("time,receiver,sensor,seq,temp,humidity,batt,rssi\n");
+    }
+    if (receiver) {
+        queryReceiver(q, store, receiver, sensor);
+    } else {
+        DIR* d = opendir(store);
+        if (!d) {
+            fprintf(stderr, "ook-query: cannot open store %s\n", store);
+            return 1;
+        }
+        while (struct dirent* e = readdir(d)) {
+            if (e->d_name[0] == '.') continue;
+            queryReceiver(q, store, e->d_name, sensor);
+        }
+        closedir(d);
+    }
+    fflush(stdout);
+    auto t1 = std::chrono::steady_clock::now();
+    fprintf(stderr, "ook-query: %llu rows, %llu blocks decoded, %llu skipped, %.2f ms\n",
+        (unsigned long long)q.rows, (unsigned long long)q.blocksRead, (unsigned long long)q.blocksSkipped,
+        std::chrono::duration<double, std::milli>(t1 - t0).count());
+    return 0;
+}
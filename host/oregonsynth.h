@@ -0,0 +1,181 @@
+#ifndef HOST_OREGONSYNTH_H_
+#define HOST_OREGONSYNTH_H_
+
+// Synthetic Oregon Scientific V2 transmissions, for host simulations and benchmarks
+//
+// This is the inverse of OregonDecoderV2 + decodeTempHumidity() in apps/oregon.h:
+// a reading is packed into the decoder's byte layout (sync nibble in the low nibble of data[0],
+// nibble swapped ID and rolling code, BCD temperature, checksum), each data bit is doubled
+// with its complement as V2 does, Manchester coded into chips at OREGON_CHIPRATE,
+// and preceded by the run of long pulses that is the preamble.
+//
+// Timing is produced as carrier-on intervals rather than edges, so several transmitters can be
+// overlaid (a receiver just sees the union of the carriers) before turning them into DIO2 edges.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../apps/oregon.h"
+
+#define SYNTH_CHIP_US (1000000.0 / 2048)
+
+struct SynthReading {
+    uint16_t type;          // 0x1d20 (THGR122N etc) or 0xec40 (THN132N), as decodeTempHumidity reports it
+    uint8_t channel;
+    uint8_t rollingCode;
+    int16_t temp;           // tenths of a degree
+    uint8_t hum;
+    bool battOK;
+};
+
+struct OnInterval {
+    uint64_t start_us;
+    uint64_t end_us;
+};
+
+// Pack a reading the way OregonDecoderV2 will collect it; returns the number of bytes
+inline int encodeOregonBytes(const SynthReading& r, uint8_t* data) {
+    memset(data, 0, 12);
+    int t = r.temp < 0 ? -r.temp : r.temp;
+    data[0] = uint8_t(((r.type >> 12) & 0xf) << 4) | 0xA;                 // 0xA is the sync nibble
+    data[1] = uint8_t((((r.type >> 4) & 0xf) << 4) | ((r.type >> 8) & 0xf));
+    data[2] = uint8_t((r.channel << 4) | (r.type & 0xf));
+    data[3] = uint8_t(((r.rollingCode & 0xf) << 4) | (r.rollingCode >> 4));
+    data[4] = uint8_t(((t % 10) << 4) | (r.battOK ? 0 : 0x4));
+    data[5] = uint8_t(((t / 100 % 10) << 4) | (t / 10 % 10));
+    if (r.type == 0x1d20) {
+        data[6] = uint8_t(((r.hum % 10) << 4) | (r.temp < 0 ? 0x8 : 0));
+        data[7] = uint8_t(r.hum / 10 % 10);
+        data[8] = uint8_t((sum(8, data) - 0xa) & 0xff);
+        // Trailing byte so nothing that matters is in the last, possibly merged with the gap, pulse
+        return 10;
+    }
+    // THN132N: no humidity, and the checksum as isSummOK() expects it (which has no room for a sign)
+    uint8_t s = uint8_t((sum(6, data) - 0xa) & 0xff);
+    data[6] = uint8_t((s & 0x0f) << 4);
+    data[7] = uint8_t(s >> 4);
+    return 9;
+}
+
+// Manchester pulse lengths in chips (1 = short, 2 = long), first one is carrier on
+inline void oregonRuns(const uint8_t* data, int len, std::vector<uint8_t>& runs, int preambleLongs = 32) {
+    runs.clear();
+    for (int i = 0; i < preambleLongs; i++) runs.push_back(2);
+    // The short pulse that ends the preamble
+    runs.push_back(1);
+    int prev = -1;
+    for (int i = 0; i < len * 8; i++) {
+        int bit = (data[i >> 3] >> (i & 7)) & 1;
+        // V2 sends every bit twice, the second time inverted; the decoder keeps the first
+        for (int half = 0; half < 2; half++) {
+            int b = half ? !bit : bit;
+            if (prev < 0) {
+                // Straight after the preamble the decoder expects a second short (the sync nibble starts with 0)
+                runs.push_back(1);
+            } else if (b != prev) {
+                runs.push_back(2);
+            } else {
+                runs.push_back(1);
+                runs.push_back(1);
+            }
+            prev = b;
+        }
+    }
+}
+
+// Chip stream (one entry per chip, 1 = carrier) for the same runs, used by the packet mode experiments
+inline void runsToChips(const std::vector<uint8_t>& runs, std::vector<uint8_t>& chips) {
+    chips.clear();
+    uint8_t level = 1;
+    for (uint8_t r : runs) {
+        for (int i = 0; i < r; i++) chips.push_back(level);
+        level ^= 1;
+    }
+}
+
+// Turn runs into carrier-on intervals starting at start_us
+// drift scales the chip length (a transmitter crystal off by +2% is 1.02), jitter_us is gaussian per edge
+template <typename Rng>
+inline uint64_t appendOnIntervals(const std::vector<uint8_t>& runs, uint64_t start_us, double drift, double jitter_us,
+                                  Rng& rng, std::vector<OnInterval>& out) {
+    std::normal_distribution<double> jitter(0, jitter_us > 0 ? jitter_us : 1e-9);
+    double chip = SYNTH_CHIP_US * drift;
+    double t = double(start_us);
+    bool on = true;
+    for (uint8_t r : runs) {
+        double t1 = t + r * chip;
+        if (on) {
+            double a = t + jitter(rng);
+            double b = t1 + jitter(rng);
+            if (b > a) out.push_back({ uint64_t(a), uint64_t(b) });
+        }
+        t = t1;
+        on = !on;
+    }
+    return uint64_t(t);
+}
+
+// Union of (possibly overlapping) intervals as DIO2 edge times: rising, falling, rising, ...
+inline void intervalsToEdges(std::vector<OnInterval>& on, std::vector<uint64_t>& edges) {
+    std::sort(on.begin(), on.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+    edges.clear();
+    size_t i = 0;
+    while (i < on.size()) {
+        uint64_t s = on[i].start_us;
+        uint64_t e = on[i].end_us;
+        for (i++; i < on.size() && on[i].start_us <= e; i++) {
+            e = std::max(e, on[i].end_us);
+        }
+        edges.push_back(s);
+        edges.push_back(e);
+    }
+}
+
+// Short random bursts, like the junk DIO2 shows between transmissions
+// While a real transmission is being received the OOK threshold sits well above the noise,
+// so no bursts are generated inside the (sorted) quiet windows
+template <typename Rng>
+inline void appendNoise(uint64_t from_us, uint64_t to_us, double burstsPerSecond, Rng& rng, std::vector<OnInterval>& out,
+                        const std::vector<OnInterval>* quiet = nullptr) {
+    if (burstsPerSecond <= 0) return;
+    std::exponential_distribution<double> gap(burstsPerSecond / 1e6);
+    std::uniform_int_distribution<int> width(20, 400);
+    size_t q = 0;
+    for (double t = from_us + gap(rng); t < to_us; t += gap(rng)) {
+        uint64_t s = uint64_t(t);
+        uint64_t e = s + uint64_t(width(rng));
+        if (quiet) {
+            while (q < quiet->size() && (*quiet)[q].end_us < s) q++;
+            if (q < quiet->size() && (*quiet)[q].start_us <= e) continue;
+        }
+        out.push_back({ s, e });
+    }
+}
+
+// One sensor: sends the pair every period, starting at phase
+struct SynthTransmitter {
+    SynthReading reading;
+    uint64_t period_us;
+    uint64_t phase_us;
+    double drift;
+};
+
+#define SYNTH_PAIR_GAP_US 10000
+
+// Both transmissions of the pair, returns the end time
+template <typename Rng>
+inline uint64_t appendPair(const SynthReading& r, uint64_t start_us, double drift, double jitter_us, Rng& rng,
+                           std::vector<OnInterval>& out) {
+    uint8_t data[12];
+    int len = encodeOregonBytes(r, data);
+    std::vector<uint8_t> runs;
+    oregonRuns(data, len, runs);
+    uint64_t t = appendOnIntervals(runs, start_us, drift, jitter_us, rng, out);
+    return appendOnIntervals(runs, t + SYNTH_PAIR_GAP_US, drift, jitter_us, rng, out);
+}
+
+#endif
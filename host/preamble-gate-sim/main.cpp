@@ -0,0 +1,182 @@
+// Host simulation of apps/oregon-gate against the ISR path of apps/oregon-decode
+//
+// Synthetic Oregon sensors (oregonsynth.h) plus two kinds of noise on DIO2: the short bursts
+// the other simulations use, and trains of random width pulses, which is what the gate has to
+// tell apart from a preamble. The same edges then go through:
+//   - the ISR path: one interrupt per edge, every width into OregonDecoderV2
+//   - the gate: PreambleModel standing in for the oregon_preamble state machine, the widths
+//     into a ring the way the DMA fills it, and GatedDecode polling it after each trigger
+// and it reports, for each, CPU wakeups per hour, time spent in decode windows after a trigger, and frames missed
+// out of those transmitted.
+//
+// Usage: preamble-gate-sim [--sensors S] [--hours H] [--noise B] [--chatter C] [--jitter U]
+//                          [--poll-us U] [--latency-us U] [--seed N]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/preamblegate.h"
+#include "../oregonsynth.h"
+
+struct Pulse {
+    uint64_t end_us;
+    uint32_t width_us;
+    bool high;
+};
+
+static bool isReading(OregonDecoderV2& decoder) {
+    uint8_t len;
+    const uint8_t* data = decoder.getData(len);
+    uint16_t actualType;
+    uint8_t channel, rollingCode, hum;
+    int16_t temp;
+    bool battOK;
+    return data && decodeTempHumidity(data, len, actualType, channel, rollingCode, temp, hum, battOK);
+}
+
+// Trains of pulses of any width from 100us to 1.5ms, like DIO2 does when the threshold sits in the noise
+template <typename Rng>
+static void appendChatter(uint64_t from_us, uint64_t to_us, double trainsPerSecond, Rng& rng, std::vector<OnInterval>& out,
+                          const std::vector<OnInterval>& quiet) {
+    if (trainsPerSecond <= 0) return;
+    std::exponential_distribution<double> gap(trainsPerSecond / 1e6);
+    std::uniform_int_distribution<int> pulses(4, 60);
+    std::uniform_int_distribution<int> width(100, 1500);
+    size_t q = 0;
+    for (double t = from_us + gap(rng); t < to_us; t += gap(rng)) {
+        uint64_t s = uint64_t(t);
+        std::vector<OnInterval> train;
+        int n = pulses(rng);
+        uint64_t e = s;
+        for (int i = 0; i < n; i++) {
+            uint64_t on = e + width(rng);
+            train.push_back({ e, on });
+            e = on + width(rng);
+        }
+        while (q < quiet.size() && quiet[q].end_us < s) q++;
+        if (q < quiet.size() && quiet[q].start_us <= e) continue;
+        out.insert(out.end(), train.begin(), train.end());
+        t = double(e);
+    }
+}
+
+int main(int argc, char** argv) {
+    int numSensors = 6;
+    double hours = 24, noise = 200, chatter = 2, jitter = 15;
+    uint32_t poll_us = 2000, latency_us = 20;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--sensors") && hasArg) numSensors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--chatter") && hasArg) chatter = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && hasArg) jitter = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--poll-us") && hasArg) poll_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--latency-us") && hasArg) latency_us = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: preamble-gate-sim [--sensors S] [--hours H] [--noise B] [--chatter C] [--jitter U]\n"
+                            "                         [--poll-us U] [--latency-us U] [--seed N]\n");
+            return 2;
+        }
+    }
+
+    std::mt19937_64 rng(seed);
+    uint64_t duration_us = uint64_t(hours * 3600e6);
+
+    std::vector<OnInterval> on;
+    std::vector<OnInterval> heard;
+    uint64_t transmitted = 0;
+    for (int s = 0; s < numSensors; s++) {
+        SynthReading r = { uint16_t(s % 3 == 2 ? 0xec40 : 0x1d20), uint8_t(1 + s % 3), uint8_t(0x10 + s * 7),
+                           int16_t(100 + s * 13), uint8_t(40 + s % 50), true };
+        uint64_t period_us = 39000000 + uint64_t(s % 3) * 1000000 + uint64_t(s) * 50000;
+        double drift = 1.0 + ((int(rng() % 200) - 100) / 10000.0);
+        for (uint64_t start = rng() % period_us; start + 500000 < duration_us; start += period_us) {
+            uint64_t end = appendPair(r, start, drift, jitter, rng, on);
+            heard.push_back({ start, end });
+            transmitted += 2;
+        }
+    }
+    std::sort(heard.begin(), heard.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+    appendNoise(0, duration_us, noise, rng, on, &heard);
+    appendChatter(0, duration_us, chatter, rng, on, heard);
+
+    std::vector<uint64_t> edges;
+    intervalsToEdges(on, edges);
+    std::vector<Pulse> pulses;
+    pulses.reserve(edges.size());
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+        pulses.push_back({ edges[i + 1], uint32_t(edges[i + 1] - edges[i]), (i & 1) == 0 });
+    }
+
+    // ISR path: every edge an interrupt, every width to the decoder
+    OregonDecoderV2 isrDecoder;
+    uint64_t isrFrames = 0;
+    for (auto& p : pulses) {
+        if (isrDecoder.nextPulse(p.width_us)) {
+            if (isReading(isrDecoder)) isrFrames++;
+            isrDecoder.resetDecoder();
+        }
+    }
+
+    // The gate
+    static uint32_t ring[GATE_RING_SIZE];
+    OregonDecoderV2 gateDecoder;
+    typedef GatedDecode<OregonDecoderV2, GATE_RING_SIZE> Gate;
+    Gate gate(gateDecoder, ring);
+    PreambleModel matcher;
+    uint64_t gateFrames = 0, awake_us = 0, maxAwake_us = 0;
+    size_t next = 0;
+    bool matched = false;
+    // What the edge timer and DMA do, up to time t; the matcher sees every pulse too (and ignores them while stalled)
+    auto dmaUntil = [&](uint64_t t) {
+        for (; next < pulses.size() && pulses[next].end_us <= t; next++) {
+            const Pulse& p = pulses[next];
+            // edge_timer loses a cycle or three between pulses
+            ring[next & (GATE_RING_SIZE - 1)] = p.width_us > 1 ? p.width_us - 1 : p.width_us;
+            if (matcher.pulse(p.high, p.width_us)) matched = true;
+        }
+    };
+    while (next < pulses.size()) {
+        dmaUntil(pulses[next].end_us);
+        if (!matched) continue;
+        matched = false;
+        uint64_t t0 = pulses[next - 1].end_us + latency_us;
+        uint64_t t = t0;
+        dmaUntil(t);
+        gate.trigger(uint32_t(next), uint32_t(t));
+        Gate::Result r;
+        do {
+            t += poll_us;
+            dmaUntil(t);
+            r = gate.poll(uint32_t(next), uint32_t(t));
+        } while (r == Gate::BUSY);
+        if (r == Gate::FRAME) {
+            if (isReading(gateDecoder)) gateFrames++;
+            gateDecoder.resetDecoder();
+        }
+        matcher.rearm();
+        awake_us += t - t0;
+        maxAwake_us = std::max(maxAwake_us, t - t0);
+    }
+
+    const Gate::Stats& gs = gate.stats();
+    printf("%d sensors, %.1f h, %llu frames transmitted, noise %.0f bursts/s, chatter %.1f trains/s, %zu edges (%.0f/s)\n",
+        numSensors, hours, (unsigned long long)transmitted, noise, chatter, edges.size(), edges.size() / (hours * 3600));
+    printf("  ISR path:  %10.0f wakeups/h  frames %7llu  missed %5.2f%%\n", pulses.size() / hours,
+        (unsigned long long)isrFrames, 100.0 * (transmitted - std::min(transmitted, isrFrames)) / transmitted);
+    printf("  gate:      %10.0f wakeups/h  frames %7llu  missed %5.2f%%  (plus 3600/h for the one second timer)\n",
+        gs.triggers / hours, (unsigned long long)gateFrames, 100.0 * (transmitted - std::min(transmitted, gateFrames)) / transmitted);
+    printf("  gate triggers %u, no frame %u (%.1f/h), decode windows %.2f s/h (max %.0f ms per trigger), %u widths decoded of %zu\n",
+        gs.triggers, gs.noFrame, gs.noFrame / hours, awake_us / 1e6 / hours, maxAwake_us / 1e3, gs.widthsDecoded, pulses.size());
+    printf("  gate missed %lld frames the ISR path decoded, %.0fx fewer wakeups\n",
+        (long long)isrFrames - (long long)gateFrames, gs.triggers ? double(pulses.size()) / gs.triggers : 0.0);
+    return 0;
+}
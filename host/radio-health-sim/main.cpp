@@ -0,0 +1,356 @@
+// Host simulation of apps/radiohealth.h against a fault injecting SX1231 stand in
+//
+// FakeSx1231 is a register file with the same interface RadioHealth uses on Rfm69Common, costs simulated
+// time for each SPI access and for a full reset, and produces DIO2 edges and RSSI noise only while
+// it is actually receiving (in RX, configured as we left it, PLL locked...).
+// Every so often one fault is injected:
+//   brownout     every register back to its reset value
+//   spi-glitch   one configured register gets a bit flipped
+//   mode-drop    drops out of RX into standby
+//   pll-unlock   registers fine but deaf until the receiver is restarted
+//   spi-wedge    reads return 0 and writes are lost until the reset pin is pulsed
+//   latchup      registers fine but deaf until the reset pin is pulsed
+// and the health monitor is called once a simulated second, as the apps do.
+//
+// The full reset goes the way Rfm69Common::fullReset() does: reset pulse, RadioHead's register defaults,
+// our configuration. FakeRadioHead keeps what RH_RF69::init() does besides registers: every call takes
+// the next of its static interrupt slots (never given back; the fourth is written past the end of the
+// table and init() fails from then on) and attaches its DIO0 ISR, which clears the pin's edge enables.
+// --init-on-reset calls init() in every full reset, as fullReset() used to, to show what that comes to.
+// DIO0 is PayloadReady, as in oregon-packet: each sensor transmission heard raises it and the app's
+// pinhal::EdgeIrq counts it. The app re-arms it from RadioHealth::onFullReset(); --no-reset-hook leaves
+// that out, and then every transmission after a full reset that went through init() goes unheard.
+// Reports per fault type: time to detect and to recover (from the injection, i.e. ground truth),
+// how it recovered, and any recoveries with no fault present (false alarms).
+//
+// Usage: radio-health-sim [--hours H] [--fault-every-s S] [--seed N] [--init-on-reset] [--no-reset-hook]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+
+#include "../../apps/radiohealth.h"
+
+// Register numbers (RH_RF69.h names)
+#define REG_DATAMODUL 0x02
+#define REG_BITRATEMSB 0x03
+#define REG_BITRATELSB 0x04
+#define REG_FRFMSB 0x07
+#define REG_FRFMID 0x08
+#define REG_FRFLSB 0x09
+#define REG_RXBW 0x19
+#define REG_DIOMAPPING1 0x25
+#define REG_DIOMAPPING2 0x26
+#define REG_PACKETCONFIG2 0x3d
+
+#define PIN_DIO0 21
+
+#define SPI_ACCESS_US 40        // one register access bit banged, as measured on the Pico
+#define FULL_RESET_US 25000     // two 10ms delays plus init and configure
+
+static uint64_t simNow_us = 0;
+static uint64_t simClock() { return simNow_us; }
+
+enum Fault { FAULT_NONE, FAULT_BROWNOUT, FAULT_SPI_GLITCH, FAULT_MODE_DROP, FAULT_PLL_UNLOCK, FAULT_SPI_WEDGE, FAULT_LATCHUP, NUM_FAULTS };
+static const char* const faultNames[NUM_FAULTS] = { "none", "brownout", "spi-glitch", "mode-drop", "pll-unlock", "spi-wedge", "latchup" };
+
+// The app's PayloadReady interrupt
+void dio0Handler();
+typedef pinhal::EdgeIrq<PIN_DIO0, dio0Handler, GPIO_IRQ_EDGE_RISE> Dio0Irq;
+static uint32_t payloadIrqs = 0;
+void dio0Handler() { payloadIrqs++; }
+
+// RH_RF69::init(), as far as it matters here
+struct FakeRadioHead {
+    static constexpr int NUM_INTERRUPTS = 3;
+    int interruptCount = 0;     // RH_RF69::_interruptCount, static, so shared by every driver object
+    uint32_t initCalls = 0;
+    uint32_t outOfBounds = 0;   // _deviceForInterrupt[] written past its end
+    bool dio0Attached = false;  // its ISR on DIO0, instead of the apps' pinhal EdgeIrq
+
+    // A new RH_RF69 each time, as rfm69module.emplace() then init() did
+    bool init() {
+        initCalls++;
+        // RadioHead checks _interruptCount <= RH_RF69_NUM_INTERRUPTS
+        if (interruptCount > NUM_INTERRUPTS) return false;
+        if (interruptCount == NUM_INTERRUPTS) outOfBounds++;
+        interruptCount++;
+        dio0Attached = true;
+        return true;
+    }
+    // Rfm69Common::begin() takes it off again; detachInterrupt() clears every edge enable on the pin,
+    // the app's included
+    void detach() {
+        dio0Attached = false;
+        pinhal::host::enabled &= ~(1u << PIN_DIO0);
+    }
+};
+
+class FakeSx1231 {
+    uint8_t regs[0x80];
+    RegisterShadow<RADIO_SHADOW_REGISTERS> configured;
+    bool pllUnlocked = false;
+    bool wedged = false;
+    bool latchedUp = false;
+    std::mt19937& rng;
+    bool initOnReset;
+
+    void powerOnDefaults() {
+        memset(regs, 0, sizeof regs);
+        regs[sx1231::REG_OPMODE] = 0x04;
+        regs[REG_BITRATEMSB] = 0x1a;
+        regs[REG_BITRATELSB] = 0x0b;
+        regs[REG_FRFMSB] = 0xe4;
+        regs[REG_FRFMID] = 0xc0;
+        regs[sx1231::REG_VERSION] = sx1231::VERSION;
+        regs[REG_RXBW] = 0x86;
+        regs[REG_DIOMAPPING2] = 0x07;
+        regs[sx1231::REG_IRQFLAGS1] = sx1231::IRQFLAGS1_MODEREADY;
+        regs[REG_PACKETCONFIG2] = 0x02;
+    }
+
+    void writeConfig(uint8_t reg, uint8_t v) {
+        writeReg(reg, v);
+        configured.record(reg, v);
+    }
+
+    // What Rfm69Common::configure() leaves behind
+    void configure() {
+        configured.clear();
+        uint32_t frf = uint32_t((uint64_t(433920000) << 19) / 32000000);
+        writeConfig(REG_FRFMSB, uint8_t(frf >> 16));
+        writeConfig(REG_FRFMID, uint8_t(frf >> 8));
+        writeConfig(REG_FRFLSB, uint8_t(frf));
+        writeConfig(REG_DATAMODUL, 0x68);
+        writeConfig(REG_BITRATEMSB, uint8_t((32000000 / 2048) >> 8));
+        writeConfig(REG_BITRATELSB, uint8_t(32000000 / 2048));
+        writeConfig(REG_RXBW, 0x49);
+        writeConfig(REG_DIOMAPPING1, 0x02);
+        writeConfig(REG_DIOMAPPING2, 0x05);
+        writeReg(sx1231::REG_OPMODE, sx1231::OPMODE_MODE_RX);
+    }
+
+public:
+    uint32_t spiAccesses = 0;
+    FakeRadioHead radioHead;
+
+    FakeSx1231(std::mt19937& r, bool initOnReset) : rng(r), initOnReset(initOnReset) {
+        powerOnDefaults();
+        radioHead.init();
+        radioHead.detach();
+        configure();
+    }
+
+    // Port interface, as Rfm69Common
+    uint8_t readReg(uint8_t reg) {
+        simNow_us += SPI_ACCESS_US;
+        spiAccesses++;
+        if (wedged) return 0;
+        if (reg == sx1231::REG_RSSIVALUE) {
+            // Frozen when deaf; otherwise noise around -103dBm
+            return receiving() ? uint8_t(200 + rng() % 12) : 0xff;
+        }
+        return regs[reg & 0x7f];
+    }
+
+    void writeReg(uint8_t reg, uint8_t v) {
+        simNow_us += SPI_ACCESS_US;
+        spiAccesses++;
+        if (wedged || reg == sx1231::REG_VERSION || reg == sx1231::REG_IRQFLAGS1) return;
+        regs[reg & 0x7f] = v;
+    }
+
+    RegisterShadow<RADIO_SHADOW_REGISTERS>& shadow() { return configured; }
+
+    void restartRx() {
+        writeReg(REG_PACKETCONFIG2, regs[REG_PACKETCONFIG2] | 0x04);
+        regs[REG_PACKETCONFIG2] &= ~0x04;
+        if (!wedged) pllUnlocked = false;
+    }
+
+    bool fullReset() {
+        simNow_us += FULL_RESET_US;
+        wedged = latchedUp = pllUnlocked = false;
+        powerOnDefaults();
+        pinhal::host::setInput(PIN_DIO0, false);
+        if (initOnReset) {
+            if (!radioHead.init()) return false;
+            radioHead.detach();
+        }
+        configure();
+        return true;
+    }
+
+    // A block in the FIFO: PayloadReady up, and down again once the app has read it
+    void payload() {
+        pinhal::host::setInput(PIN_DIO0, true);
+        pinhal::host::setInput(PIN_DIO0, false);
+    }
+
+    // Ground truth
+    bool receiving() {
+        if (wedged || pllUnlocked || latchedUp) return false;
+        if ((regs[sx1231::REG_OPMODE] & sx1231::OPMODE_MODE) != sx1231::OPMODE_MODE_RX) return false;
+        // Straight at the registers, no SPI cost, this is the simulation looking, not the firmware
+        struct Raw {
+            const uint8_t* regs;
+            uint8_t readReg(uint8_t reg) { return regs[reg & 0x7f]; }
+            void writeReg(uint8_t, uint8_t) {}
+        } raw{ regs };
+        return configured.verify(raw, false) == 0;
+    }
+
+    void inject(Fault f) {
+        switch (f) {
+        case FAULT_BROWNOUT: powerOnDefaults(); break;
+        case FAULT_SPI_GLITCH: {
+            // Flip a bit in a register that matters
+            static const uint8_t victims[] = { REG_DATAMODUL, REG_FRFMID, REG_RXBW, REG_BITRATELSB, REG_DIOMAPPING1 };
+            uint8_t reg = victims[rng() % sizeof victims];
+            regs[reg] ^= uint8_t(1u << (rng() % 8));
+            break;
+        }
+        case FAULT_MODE_DROP: regs[sx1231::REG_OPMODE] = (regs[sx1231::REG_OPMODE] & ~sx1231::OPMODE_MODE) | 0x04; break;
+        case FAULT_PLL_UNLOCK: pllUnlocked = true; break;
+        case FAULT_SPI_WEDGE: wedged = true; break;
+        case FAULT_LATCHUP: latchedUp = true; break;
+        default: break;
+        }
+    }
+};
+
+struct FaultResult {
+    uint32_t injected = 0;
+    uint32_t detected = 0;
+    uint32_t recovered = 0;
+    uint32_t byResync = 0;
+    uint32_t byFullReset = 0;
+    uint64_t detectSum_ms = 0;
+    uint32_t detectMax_ms = 0;
+    uint64_t recoverSum_ms = 0;
+    uint32_t recoverMax_ms = 0;
+};
+
+int main(int argc, char** argv) {
+    double hours = 24;
+    double faultEvery_s = 600;
+    unsigned seed = 1;
+    bool initOnReset = false;
+    bool resetHook = true;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--fault-every-s") && hasArg) faultEvery_s = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--init-on-reset")) initOnReset = true;
+        else if (!strcmp(argv[i], "--no-reset-hook")) resetHook = false;
+        else {
+            fprintf(stderr, "Usage: radio-health-sim [--hours H] [--fault-every-s S] [--seed N] [--init-on-reset] [--no-reset-hook]\n");
+            return 2;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    pinhal::host::clock_us = simClock;
+    FakeSx1231 radio(rng, initOnReset);
+    RadioHealth<FakeSx1231> health(radio);
+    Dio0Irq::attach();
+    if (resetHook) health.onFullReset([] { Dio0Irq::enable(true); });
+
+    FaultResult results[NUM_FAULTS];
+    uint32_t falseAlarms = 0;
+    uint32_t edges = 0;
+    const uint64_t end_us = uint64_t(hours * 3600e6);
+    std::exponential_distribution<double> nextFault(1.0 / faultEvery_s);
+    std::poisson_distribution<int> noiseEdges(3.0);     // per second, through the OOK threshold
+    const uint64_t sensorPeriod_us = 39000000;
+
+    Fault active = FAULT_NONE;
+    uint64_t injectedAt_us = 0;
+    bool detected = false;
+    uint32_t resetsAtInjection = 0;
+    uint64_t faultAt_us = uint64_t(nextFault(rng) * 1e6);
+    uint64_t tick_us = 0;
+    uint32_t spiAtStart = radio.spiAccesses;
+    uint32_t blocks = 0;
+
+    while (tick_us < end_us) {
+        tick_us += 1000000;
+        // A second of receiving, or not
+        if (active == FAULT_NONE && faultAt_us < tick_us) {
+            active = Fault(1 + rng() % (NUM_FAULTS - 1));
+            simNow_us = faultAt_us;
+            radio.inject(active);
+            injectedAt_us = faultAt_us;
+            detected = false;
+            resetsAtInjection = health.stats().fullResets;
+            results[active].injected++;
+        }
+        if (radio.receiving()) {
+            edges += noiseEdges(rng);
+            if (tick_us % sensorPeriod_us < 1000000) {
+                edges += 200;
+                blocks++;
+                radio.payload();
+            }
+        }
+        simNow_us = std::max(simNow_us, tick_us);
+
+        uint32_t detectedBefore = health.stats().detected;
+        health.check(uint32_t(simNow_us / 1000), edges);
+        if (health.stats().detected != detectedBefore) {
+            if (active == FAULT_NONE) {
+                falseAlarms++;
+            } else if (!detected) {
+                detected = true;
+                FaultResult& r = results[active];
+                uint32_t ms = uint32_t((simNow_us - injectedAt_us) / 1000);
+                r.detected++;
+                r.detectSum_ms += ms;
+                r.detectMax_ms = std::max(r.detectMax_ms, ms);
+            }
+        }
+        if (active != FAULT_NONE && detected && radio.receiving()) {
+            FaultResult& r = results[active];
+            uint32_t ms = uint32_t((simNow_us - injectedAt_us) / 1000);
+            r.recovered++;
+            r.recoverSum_ms += ms;
+            r.recoverMax_ms = std::max(r.recoverMax_ms, ms);
+            if (health.stats().fullResets != resetsAtInjection) r.byFullReset++;
+            else r.byResync++;
+            active = FAULT_NONE;
+            faultAt_us = simNow_us + uint64_t(nextFault(rng) * 1e6);
+        }
+    }
+
+    printf("%.1f h simulated, a fault every %.0f s on average, health check once a second\n", hours, faultEvery_s);
+    printf("  fault        injected detected recovered  resync  reset   detect mean/max s   recover mean/max s\n");
+    uint32_t injected = 0, recovered = 0;
+    for (int f = 1; f < NUM_FAULTS; f++) {
+        const FaultResult& r = results[f];
+        injected += r.injected;
+        recovered += r.recovered;
+        printf("  %-12s %8u %8u %9u %7u %6u %9.1f / %5.1f %10.1f / %5.1f\n", faultNames[f], r.injected, r.detected,
+            r.recovered, r.byResync, r.byFullReset, r.detected ? r.detectSum_ms / 1000.0 / r.detected : 0.0,
+            r.detectMax_ms / 1000.0, r.recovered ? r.recoverSum_ms / 1000.0 / r.recovered : 0.0, r.recoverMax_ms / 1000.0);
+    }
+    const auto& s = health.stats();
+    printf("  %u of %u faults recovered, %u false alarms\n", recovered, injected, falseAlarms);
+    printf("  monitor's own numbers: %u detected, detect mean %.1f s, max %.1f s; %u recovered in mean %.1f ms, max %.1f ms;\n"
+           "    %u resyncs (%u registers rewritten), %u full resets, %u failed\n",
+        s.detected, s.detected ? s.detectSum_ms / 1000.0 / s.detected : 0.0, s.detectMax_ms / 1000.0, s.recovered,
+        s.recovered ? s.recoverSum_us / 1000.0 / s.recovered : 0.0, s.recoverMax_us / 1000.0, s.resyncs,
+        s.registersFixed, s.fullResets, s.failed);
+    printf("  SPI cost: %.1f register accesses per check\n", double(radio.spiAccesses - spiAtStart) / s.checks);
+    const FakeRadioHead& rh = radio.radioHead;
+    printf("  RadioHead: %u init() calls, %d of %d interrupt slots taken, %u written out of bounds\n", rh.initCalls,
+        std::min(rh.interruptCount, FakeRadioHead::NUM_INTERRUPTS + 1), FakeRadioHead::NUM_INTERRUPTS, rh.outOfBounds);
+    printf("  DIO0: %u of %u transmissions heard took the interrupt, DIO0 %s at the end\n", payloadIrqs, blocks,
+        pinhal::host::enabled & (1u << PIN_DIO0) ? "armed" : "NOT armed");
+    pinhal::host::clock_us = nullptr;
+    bool ok = recovered + (active != FAULT_NONE ? 1 : 0) == injected && falseAlarms == 0 && s.failed == 0 && rh.outOfBounds == 0 &&
+        payloadIrqs == blocks;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// Parser for the reading lines printed by apps/oregon-decode, e.g.
+//
+//   12,1d20,1,27,14.5,75,Batt=ok,-80.5dB
+//
+// which is "%d,%04x,%d,%x,%.1f,%d,Batt=%s,%.1fdB" in the firmware (extra trailing fields are ignored).
+// The serial stream also contains the "- 12 -95.0    \r" spinner and the "OSV2 ..." hex dumps,
+// so anything that does not match exactly is rejected rather than guessed at.
+//
+// This works directly on the bytes in the read buffer, no copies and no allocation;
+// the decimal fields are parsed as fixed point (tenths) so there is no float round trip either.
+
+#ifndef HOST_READINGPARSER_H_
+#define HOST_READINGPARSER_H_
+
+#include <stdint.h>
+
+struct Reading {
+    int32_t seq;
+    uint16_t type;
+    uint8_t channel;
+    uint8_t rollingCode;
+    int16_t temp;   // tenths of a degree
+    uint8_t humidity;
+    bool battOK;
+    int16_t rssi;   // tenths of a dB
+};
+
+namespace readingparser {
+
+inline bool parseInt(const char*& p, const char* end, int32_t& v) {
+    bool neg = false;
+    if (p < end && *p == '-') { neg = true; p++; }
+    const char* start = p;
+    int32_t r = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        r = r * 10 + (*p - '0');
+        p++;
+    }
+    if (p == start || p - start > 9) return false;
+    v = neg ? -r : r;
+    return true;
+}
+
+inline bool parseHex(const char*& p, const char* end, uint32_t& v) {
+    const char* start = p;
+    uint32_t r = 0;
+    while (p < end) {
+        char c = *p;
+        if (c >= '0' && c <= '9') r = (r << 4) | uint32_t(c - '0');
+        else if (c >= 'a' && c <= 'f') r = (r << 4) | uint32_t(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') r = (r << 4) | uint32_t(c - 'A' + 10);
+        else break;
+        p++;
+    }
+    if (p == start || p - start > 8) return false;
+    v = r;
+    return true;
+}
+
+// %.1f as tenths; the firmware always prints exactly one decimal place
+inline bool parseTenths(const char*& p, const char* end, int32_t& v) {
+    bool neg = (p < end && *p == '-');
+    int32_t whole;
+    if (!parseInt(p, end, whole)) return false;
+    if (p + 2 > end || p[0] != '.' || p[1] < '0' || p[1] > '9') return false;
+    int32_t frac = p[1] - '0';
+    p += 2;
+    // "-0.5" parses whole as 0 so carry the sign separately
+    v = neg ? -(-whole * 10 + frac) : whole * 10 + frac;
+    return true;
+}
+
+inline bool expect(const char*& p, const char* end, const char* s) {
+    while (*s) {
+        if (p >= end || *p != *s) return false;
+        p++;
+        s++;
+    }
+    return true;
+}
+
+} // namespace readingparser
+
+// Parse one line (without the terminator); returns false if it is not a reading line
+inline bool parseReadingLine(const char* p, const char* end, Reading& r) {
+    using namespace readingparser;
+    int32_t i;
+    uint32_t h;
+    if (!parseInt(p, end, i) || !expect(p, end, ",")) return false;
+    r.seq = i;
+    if (!parseHex(p, end, h) || h > 0xffff || !expect(p, end, ",")) return false;
+    r.type = uint16_t(h);
+    if (!parseInt(p, end, i) || i < 0 || i > 255 || !expect(p, end, ",")) return false;
+    r.channel = uint8_t(i);
+    if (!parseHex(p, end, h) || h > 0xff || !expect(p, end, ",")) return false;
+    r.rollingCode = uint8_t(h);
+    if (!parseTenths(p, end, i) || i < -32768 || i > 32767 || !expect(p, end, ",")) return false;
+    r.temp = int16_t(i);
+    if (!parseInt(p, end, i) || i < 0 || i > 255 || !expect(p, end, ",Batt=")) return false;
+    r.humidity = uint8_t(i);
+    if (expect(p, end, "ok")) {
+        r.battOK = true;
+    } else if (expect(p, end, "flat")) {
+        r.battOK = false;
+    } else {
+        return false;
+    }
+    if (!expect(p, end, ",") || !parseTenths(p, end, i) || !expect(p, end, "dB")) return false;
+    r.rssi = int16_t(i);
+    // multi-radio appends ,radios=..,best=.. after the fields oregon-decode prints
+    return p == end || *p == ',';
+}
+
+#endif
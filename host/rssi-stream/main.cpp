@@ -0,0 +1,255 @@
+// Put ook-scope's RSSI stream (STREAM_MODE 1) back together, sample for sample
+//
+// Usage: rssi-stream [-o samples.csv] [--selftest SECONDS] [file]
+//   reads stdin if no file, e.g.  cat /dev/ttyACM0 | rssi-stream -o rssi.csv
+//
+// Each R line is a block of samples packed by apps/rssicodec.h, with the time of its first sample;
+// the rest are STREAM_POLL_US apart. G lines are samples the Pico didn't send (a late poll, or the
+// serial link not keeping up). The CSV is one line per sample, time in us since the Pico booted and
+// dBm, with an empty line at each gap so gnuplot doesn't draw across it.
+// The summary says how many samples came back, how much was missing and why, the compression ratio and
+// the sample rate actually sustained, next to the Pico's own stats lines.
+//
+// --selftest makes SECONDS of synthetic RSSI, a wandering noise floor with OOK transmissions in it,
+// packs it the way ook-scope does, and checks it all comes back exactly.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../apps/rssicodec.h"
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+struct Sample {
+    uint64_t t_us;
+    uint8_t rssi;
+};
+
+struct StreamReader {
+    unsigned poll_us = 0;
+    unsigned blockSamples = 0;
+    std::vector<Sample> samples;
+    std::vector<size_t> gapsBefore;     // sample indices with a gap just before them
+    uint64_t blocks = 0, codedBytes = 0, chars = 0;
+    uint64_t badLines = 0, skippedBlocks = 0;
+    uint64_t gapLines = 0, gapSamples = 0;
+    uint64_t unexplained = 0;           // missing samples no G line accounts for, e.g. a line lost on the host side
+    bool haveNext = false;
+    uint64_t tNext = 0;
+    uint64_t tGapEnd = 0;
+    unsigned long nextSeq = 0;
+    double statSamples = 0, statSent = 0, statChars = 0, statRatio = 0, statMaxLate_us = 0;
+    int statLines = 0;
+
+    void line(const char* line) {
+        if (!strncmp(line, "# stream ", 9)) {
+            if (sscanf(line, "# stream poll_us=%u block=%u", &poll_us, &blockSamples) != 2) poll_us = 0;
+            return;
+        }
+        if (!strncmp(line, "# stats ", 8)) {
+            double s, sent, c, r, late;
+            unsigned long gaps;
+            if (sscanf(line, "# stats samples/s=%lf sent/s=%lf chars/s=%lf ratio=%lf gaps=%lu max_late_us=%lf", &s, &sent, &c, &r,
+                    &gaps, &late) == 6) {
+                statSamples += s;
+                statSent += sent;
+                statChars += c;
+                statRatio += r;
+                statMaxLate_us = std::max(statMaxLate_us, late);
+                statLines++;
+            }
+            return;
+        }
+        if (!poll_us) return;
+        if (line[0] == 'G') {
+            unsigned long long t;
+            unsigned long n;
+            if (sscanf(line, "G %llu %lu", &t, &n) != 2) {
+                badLines++;
+                return;
+            }
+            gapLines++;
+            gapSamples += n;
+            tGapEnd = t + uint64_t(n) * poll_us;
+            return;
+        }
+        if (line[0] != 'R') return;
+        unsigned long seq;
+        unsigned long long t;
+        int n, off = 0;
+        if (sscanf(line, "R %lu %llu %d %n", &seq, &t, &n, &off) != 3 || !off || n < 1 || n > RSSI_BLOCK_SAMPLES) {
+            badLines++;
+            return;
+        }
+        uint8_t block[RSSI_BLOCK_MAX_BYTES];
+        uint32_t bytes = 0;
+        const char* p = line + off;
+        for (; bytes < sizeof block && hexDigit(p[0]) >= 0 && hexDigit(p[1]) >= 0; p += 2) {
+            block[bytes++] = uint8_t(hexDigit(p[0]) << 4 | hexDigit(p[1]));
+        }
+        uint8_t out[RSSI_BLOCK_SAMPLES];
+        if (!rssiDecodeBlock(block, bytes, n, out)) {
+            // Cut short, e.g. the port was opened part way through it
+            badLines++;
+            return;
+        }
+        if (haveNext && seq > nextSeq) skippedBlocks += seq - nextSeq;
+        if (haveNext && t != tNext) {
+            gapsBefore.push_back(samples.size());
+            if (t > tNext && t > tGapEnd) unexplained += (t - std::max(tNext, tGapEnd)) / poll_us;
+        }
+        for (int i = 0; i < n; i++) samples.push_back({ t + uint64_t(i) * poll_us, out[i] });
+        blocks++;
+        codedBytes += bytes;
+        chars += strlen(line);
+        haveNext = true;
+        tNext = t + uint64_t(n) * poll_us;
+        nextSeq = seq + 1;
+    }
+};
+
+// As ook-scope's runStream() would send it, minus the timing
+static std::string streamLines(const std::vector<uint8_t>& series, unsigned poll_us, uint64_t t0_us) {
+    char buf[64 + 2 * RSSI_BLOCK_MAX_BYTES];
+    std::string out;
+    snprintf(buf, sizeof buf, "# stream poll_us=%u block=%u\n", poll_us, RSSI_BLOCK_SAMPLES);
+    out += buf;
+    uint32_t seq = 0;
+    for (size_t at = 0; at < series.size(); at += RSSI_BLOCK_SAMPLES) {
+        int n = int(std::min<size_t>(RSSI_BLOCK_SAMPLES, series.size() - at));
+        uint8_t block[RSSI_BLOCK_MAX_BYTES];
+        uint32_t bytes = rssiEncodeBlock(&series[at], n, block);
+        int len = snprintf(buf, sizeof buf, "R %lu %llu %d ", (unsigned long)seq++, (unsigned long long)(t0_us + at * poll_us), n);
+        for (uint32_t i = 0; i < bytes; i++) len += snprintf(buf + len, sizeof buf - len, "%02x", block[i]);
+        out += buf;
+        out += '\n';
+    }
+    return out;
+}
+
+static int selftest(double seconds) {
+    const unsigned poll_us = 100;
+    std::mt19937_64 rng(1);
+    std::normal_distribution<double> noise(0, 1.2);
+    size_t count = size_t(seconds * 1e6 / poll_us);
+    std::vector<uint8_t> series(count);
+    // RSSI byte is -2 x dBm: a floor wandering around -100dBm, and a transmission every few seconds at
+    // -60 to -90dBm, on and off at the Oregon chip rate (about 5 samples a chip)
+    double floor = 200;
+    size_t nextTx = 20000, txEnd = 0;
+    double txLevel = 0;
+    bool on = false;
+    for (size_t i = 0; i < count; i++) {
+        floor = std::min(215.0, std::max(185.0, floor + noise(rng) * 0.05));
+        if (i == nextTx) {
+            txEnd = i + 2000;
+            txLevel = 120 + double(rng() % 60);
+            nextTx = i + 20000 + rng() % 40000;
+        }
+        if (i < txEnd && i % 5 == 0) on = rng() & 1;
+        double v = (i < txEnd && on ? txLevel : floor) + noise(rng);
+        series[i] = uint8_t(std::min(255.0, std::max(0.0, v + 0.5)));
+    }
+
+    std::string text = streamLines(series, poll_us, 1000000);
+    StreamReader reader;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        reader.line(text.substr(start, end - start).c_str());
+        start = end + 1;
+    }
+    bool same = reader.samples.size() == series.size() && reader.badLines == 0 && reader.gapsBefore.empty();
+    for (size_t i = 0; same && i < series.size(); i++) {
+        same = reader.samples[i].rssi == series[i] && reader.samples[i].t_us == 1000000 + i * poll_us;
+    }
+    printf("selftest: %zu samples in %llu blocks, %llu coded bytes, ratio %.2f (%.2f bits a sample), %.0f chars/s at %u us, %s\n",
+        series.size(), (unsigned long long)reader.blocks, (unsigned long long)reader.codedBytes,
+        double(series.size()) / reader.codedBytes, 8.0 * reader.codedBytes / series.size(), text.size() / seconds, poll_us,
+        same ? "all back exactly" : "MISMATCH");
+    return same ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    const char* inPath = nullptr;
+    double selftestSeconds = 0;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-o") && hasArg) csvPath = argv[++i];
+        else if (!strcmp(argv[i], "--selftest") && hasArg) selftestSeconds = atof(argv[++i]);
+        else if (argv[i][0] != '-' && !inPath) inPath = argv[i];
+        else {
+            fprintf(stderr, "Usage: rssi-stream [-o samples.csv] [--selftest SECONDS] [file]\n");
+            return 2;
+        }
+    }
+    if (selftestSeconds > 0) return selftest(selftestSeconds);
+
+    FILE* in = inPath ? fopen(inPath, "r") : stdin;
+    if (!in) {
+        perror(inPath);
+        return 1;
+    }
+    StreamReader reader;
+    char line[4096];
+    while (fgets(line, sizeof line, in)) {
+        // The spinner line ends in \r, if the build printed one before
+        char* p = strrchr(line, '\r');
+        p = p && p[1] ? p + 1 : line;
+        reader.line(p);
+    }
+    if (in != stdin) fclose(in);
+
+    if (reader.samples.empty()) {
+        fprintf(stderr, "rssi-stream: no complete blocks (is ook-scope built with STREAM_MODE 1?)\n");
+        return 1;
+    }
+    const auto& s = reader.samples;
+    double span_s = (s.back().t_us - s.front().t_us + reader.poll_us) / 1e6;
+    printf("%zu samples in %llu blocks over %.3fs, poll %u us", s.size(), (unsigned long long)reader.blocks, span_s, reader.poll_us);
+    if (reader.badLines) printf(", %llu damaged lines skipped", (unsigned long long)reader.badLines);
+    printf("\n");
+    printf("sustained %.1f samples/s of %.1f polled; gaps: %llu (%llu samples), %llu block numbers skipped, %llu samples missing with no G line\n",
+        s.size() / span_s, 1e6 / reader.poll_us, (unsigned long long)reader.gapLines, (unsigned long long)reader.gapSamples,
+        (unsigned long long)reader.skippedBlocks, (unsigned long long)reader.unexplained);
+    printf("compression %.2f (%.2f bits a sample), %.0f chars/s on the link against %.0f for plain hex\n",
+        double(s.size()) / reader.codedBytes, 8.0 * reader.codedBytes / s.size(), reader.chars / span_s, 2 * s.size() / span_s);
+    if (reader.statLines) {
+        printf("device reports %.1f samples/s polled, %.1f sent, %.0f chars/s, ratio %.2f, max late %.0f us\n",
+            reader.statSamples / reader.statLines, reader.statSent / reader.statLines, reader.statChars / reader.statLines,
+            reader.statRatio / reader.statLines, reader.statMaxLate_us);
+    }
+
+    if (csvPath) {
+        FILE* out = fopen(csvPath, "w");
+        if (!out) {
+            perror(csvPath);
+            return 1;
+        }
+        fprintf(out, "t_us,dbm\n");
+        size_t g = 0;
+        for (size_t i = 0; i < s.size(); i++) {
+            if (g < reader.gapsBefore.size() && reader.gapsBefore[g] == i) {
+                fprintf(out, "\n");
+                g++;
+            }
+            // RSSI byte is -2 x dBm
+            fprintf(out, "%llu,%.1f\n", (unsigned long long)s[i].t_us, s[i].rssi / -2.0);
+        }
+        fclose(out);
+        printf("samples written to %s\n", csvPath);
+    }
+    return 0;
+}
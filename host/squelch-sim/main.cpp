@@ -0,0 +1,280 @@
+// DIO2 interrupt load and readings per hour with and without the RSSI squelch (apps/squelch.h)
+//
+// Synthetic Oregon sensors (oregonsynth.h), each with its own power at the antenna, noise bursts on
+// DIO2 between transmissions like the OOK threshold lets through at the floor, and now and then an
+// interferer above the floor (someone's car key, a doorbell) with its own junk edges.
+// The RSSI the radio would report is the power averaged over two chips, sampled every two chips, so
+// an OOK signal reads a few dB under its carrier. RssiIrq goes high on the first sample over the
+// threshold and stays there until restartRx(), like the SX1231, and that is DIO0.
+//
+// The real Squelch drives the host pinhal.h EdgeIrq for DIO2 and DIO0; the DIO2 handler times the
+// widths and feeds OregonDecoderV2, as oregon-decode does. First with the gate off, then with it on
+// at each threshold. A reading counts once per sensor per cycle, and only if it matches what was sent.
+//
+// Usage: squelch-sim [--sensors S] [--hours H] [--noise B] [--interferers M] [--hang MS] [--preroll U] [--seed N]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <set>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/squelch.h"
+#include "../oregonsynth.h"
+
+#define PIN_DIO0 10
+#define PIN_DIO2 11
+
+#define FLOOR_DBM -105.0
+// RSSI is averaged over, and sampled every, two chips
+#define RSSI_SAMPLE_US 977
+// OOK is on about half the time, so the RSSI of a sensor reads about 3dB under its carrier; a little more for margin
+#define SQUELCH_MARGIN_DB 4
+
+// Carrier on for a while at some power; sensors and interferers alike
+struct Carrier {
+    uint64_t start_us;
+    uint64_t end_us;
+    double mw;
+};
+
+static uint64_t now_us = 0;
+static uint64_t simClock() { return now_us; }
+
+struct SimRadio {
+    uint8_t threshold = 0;
+    uint8_t rssi = 210;
+    bool latched = false;
+    uint64_t restarted_us = 0;
+
+    uint8_t readRSSIByte() { return rssi; }
+    void setRssiThreshold(uint8_t v) { threshold = v; }
+    void restartRx() {
+        latched = false;
+        restarted_us = now_us;
+        pinhal::host::setInput(PIN_DIO0, false);
+    }
+};
+
+void dio2Handler();
+void dio0Handler();
+typedef pinhal::EdgeIrq<PIN_DIO2, dio2Handler> Dio2Irq;
+typedef pinhal::EdgeIrq<PIN_DIO0, dio0Handler, GPIO_IRQ_EDGE_RISE> Dio0Irq;
+typedef Squelch<SimRadio, Dio2Irq, Dio0Irq, pinhal::InputPin<PIN_DIO2>> SimSquelch;
+
+static SimRadio radio;
+static SimSquelch* squelch;
+static uint32_t prevEdge_us = 0;
+static uint64_t isrEdges = 0;
+static OregonDecoderV2 decoder;
+static std::vector<std::pair<uint64_t, std::vector<uint8_t>>> frames;
+
+// oregon-decode does this in the loop, straight after the ISR; same thing here
+static void pulse(uint32_t w) {
+    if (decoder.nextPulse(w)) {
+        uint8_t len;
+        const uint8_t* data = decoder.getData(len);
+        if (data) frames.push_back({ now_us, std::vector<uint8_t>(data, data + len) });
+        decoder.resetDecoder();
+    }
+}
+
+void dio2Handler() {
+    uint32_t now = pinhal::micros32();
+    pulse(now - prevEdge_us);
+    prevEdge_us = now;
+    isrEdges++;
+}
+
+void dio0Handler() {
+    uint32_t prev = squelch->opened(pinhal::micros32());
+    if (prev) prevEdge_us = prev;
+}
+
+struct Cycle {
+    SynthReading reading;
+    uint64_t start_us;
+};
+
+struct Result {
+    double edgesPerSecond;
+    double openPercent;
+    uint32_t opens;
+    uint32_t prerolls;
+    size_t readings;
+    std::vector<size_t> perSensor;
+};
+
+// One run over the same traffic; threshold 0 is the gate off
+static Result run(const std::vector<uint64_t>& edges, const std::vector<Carrier>& carriers, uint64_t duration_us,
+                  uint8_t threshold, uint32_t hang_ms, uint32_t preroll_us, const std::vector<std::vector<Cycle>>& cycles) {
+    now_us = 0;
+    pinhal::host::pinState = 0;
+    prevEdge_us = 0;
+    isrEdges = 0;
+    decoder.resetDecoder();
+    frames.clear();
+    radio = SimRadio();
+    static SimSquelch* s;
+    delete s;
+    s = squelch = new SimSquelch(radio);
+    Dio2Irq::attach();
+    Dio0Irq::attach();
+    if (threshold) {
+        squelch->config().threshold = threshold;
+        squelch->config().hang_ms = hang_ms;
+        squelch->config().preroll_us = preroll_us;
+    }
+    squelch->begin(threshold != 0);
+
+    size_t e = 0, c = 0;
+    std::vector<const Carrier*> active;
+    for (uint64_t tick = RSSI_SAMPLE_US; tick < duration_us; tick += RSSI_SAMPLE_US) {
+        // DIO2 edges up to this sample
+        for (; e < edges.size() && edges[e] < tick; e++) {
+            now_us = edges[e];
+            pinhal::host::setInput(PIN_DIO2, (e & 1) == 0);
+        }
+        now_us = tick;
+
+        // Average power over the last sample period
+        uint64_t from = tick - RSSI_SAMPLE_US;
+        for (; c < carriers.size() && carriers[c].start_us < tick; c++) active.push_back(&carriers[c]);
+        double energy = pow(10, FLOOR_DBM / 10) * RSSI_SAMPLE_US;
+        for (size_t k = 0; k < active.size();) {
+            const Carrier* a = active[k];
+            if (a->end_us <= from) {
+                active[k] = active.back();
+                active.pop_back();
+                continue;
+            }
+            energy += a->mw * double(std::min(a->end_us, tick) - std::max(a->start_us, from));
+            k++;
+        }
+        double dbm = 10 * log10(energy / RSSI_SAMPLE_US);
+        radio.rssi = uint8_t(std::min(255.0, std::max(0.0, -2 * dbm)));
+        // RestartRx throws away the average, so the first sample after one is not compared
+        if (!radio.latched && radio.threshold && radio.rssi <= radio.threshold && tick - radio.restarted_us > RSSI_SAMPLE_US) {
+            radio.latched = true;
+            pinhal::host::setInput(PIN_DIO0, true);
+        }
+        if (squelch->poll(pinhal::micros32())) pulse(pinhal::micros32() - prevEdge_us);
+    }
+
+    // Score
+    std::set<std::pair<int, size_t>> got;
+    for (auto& f : frames) {
+        SynthReading r;
+        if (!decodeTempHumidity(f.second.data(), uint8_t(f.second.size()), r.type, r.channel, r.rollingCode, r.temp, r.hum, r.battOK)) {
+            continue;
+        }
+        for (size_t s = 0; s < cycles.size(); s++) {
+            if (cycles[s].empty() || cycles[s][0].reading.rollingCode != r.rollingCode || cycles[s][0].reading.type != r.type) continue;
+            for (size_t k = 0; k < cycles[s].size(); k++) {
+                const Cycle& cy = cycles[s][k];
+                if (cy.start_us <= f.first && f.first < cy.start_us + 1000000 && cy.reading.temp == r.temp) got.insert({ int(s), k });
+            }
+        }
+    }
+    std::vector<size_t> perSensor(cycles.size(), 0);
+    for (auto& g : got) perSensor[g.first]++;
+    const auto& st = squelch->stats();
+    double seconds = duration_us / 1e6;
+    return { isrEdges / seconds, threshold ? 100.0 * st.open_ms / (seconds * 1000) : 100.0, st.opens, st.prerolls, got.size(), perSensor };
+}
+
+int main(int argc, char** argv) {
+    int numSensors = 12;
+    double hours = 2, noise = 100, interferers = 2, preroll = 1000;
+    uint32_t hang = 20;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--sensors") && hasArg) numSensors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--interferers") && hasArg) interferers = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--hang") && hasArg) hang = uint32_t(atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--preroll") && hasArg) preroll = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: squelch-sim [--sensors S] [--hours H] [--noise B] [--interferers M] [--hang MS] [--preroll U] [--seed N]\n");
+            return 2;
+        }
+    }
+    pinhal::host::clock_us = simClock;
+
+    std::mt19937_64 rng(seed);
+    uint64_t duration_us = uint64_t(hours * 3600e6);
+    std::vector<OnInterval> on;
+    std::vector<OnInterval> quiet;
+    std::vector<Carrier> carriers;
+    std::vector<std::vector<Cycle>> cycles(numSensors);
+    std::vector<double> powers;
+    uint64_t sent = 0;
+    for (int s = 0; s < numSensors; s++) {
+        bool thn132 = s % 4 == 3;
+        uint8_t channel = uint8_t(1 + s % 3);
+        SynthReading r = { uint16_t(thn132 ? 0xec40 : 0x1d20), channel, uint8_t(0x11 + s * 7), int16_t(50 + rng() % 250),
+                           uint8_t(30 + rng() % 50), true };
+        // Spread evenly from barely there to next door
+        double power = -100 + 40.0 * s / std::max(1, numSensors - 1);
+        powers.push_back(power);
+        double mw = pow(10, power / 10);
+        double drift = 1.0 + ((int(rng() % 200) - 100) / 50000.0);
+        uint64_t period_us = uint64_t((39000000 + (channel - 1) * 2000000) * drift);
+        for (uint64_t start = rng() % period_us; start + 500000 < duration_us; start += period_us) {
+            r.temp = int16_t(r.temp + int(rng() % 3) - 1);
+            cycles[s].push_back({ r, start });
+            size_t first = on.size();
+            uint64_t end = appendPair(r, start, drift, 15, rng, on);
+            for (size_t k = first; k < on.size(); k++) carriers.push_back({ on[k].start_us, on[k].end_us, mw });
+            quiet.push_back({ start, end + 3000 });
+            sent++;
+        }
+    }
+    // Interferers: a few hundred ms of junk well above the floor
+    std::exponential_distribution<double> gap(interferers / 60e6);
+    for (double t = gap(rng); interferers > 0 && t < duration_us; t += gap(rng)) {
+        uint64_t start = uint64_t(t), end = start + 100000 + rng() % 400000;
+        double mw = pow(10, (-85 + double(rng() % 25)) / 10);
+        for (uint64_t u = start; u < end;) {
+            uint64_t w = 50 + rng() % 2000;
+            on.push_back({ u, u + w });
+            carriers.push_back({ u, u + w, mw });
+            u += w + 50 + rng() % 2000;
+        }
+        quiet.push_back({ start, end });
+    }
+    std::sort(quiet.begin(), quiet.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+    std::sort(carriers.begin(), carriers.end(), [](const Carrier& a, const Carrier& b) { return a.start_us < b.start_us; });
+    appendNoise(0, duration_us, noise, rng, on, &quiet);
+    std::vector<uint64_t> edges;
+    intervalsToEdges(on, edges);
+
+    printf("%d sensors from %.0f to %.0f dBm, %.1f h, %llu readings sent (each as a pair), noise %.0f bursts/s, %.1f interferers/min\n",
+        numSensors, powers.front(), powers.back(), hours, (unsigned long long)sent, noise, interferers);
+    printf("hang %ums, pre-roll %.0fus\n\n", hang, preroll);
+    // The last column is only the sensors at least SQUELCH_MARGIN_DB over the threshold, against what the
+    // ungated run got from the same ones: the gate should cost nothing there
+    printf("gate          DIO2 edges/s    open   opens  prerolls   readings/h          in range\n");
+    Result off = run(edges, carriers, duration_us, 0, hang, uint32_t(preroll), cycles);
+    printf("off           %10.1f   %5.1f%%  %6s  %8s   %8.1f  %5.1f%%\n", off.edgesPerSecond, off.openPercent, "-", "-",
+        off.readings / hours, 100.0 * off.readings / sent);
+    for (int db : { -100, -97, -94, -91, -88, -85, -80 }) {
+        Result r = run(edges, carriers, duration_us, uint8_t(-2 * db), hang, uint32_t(preroll), cycles);
+        size_t inRange = 0, inRangeOff = 0;
+        for (size_t k = 0; k < powers.size(); k++) {
+            if (powers[k] < db + SQUELCH_MARGIN_DB) continue;
+            inRange += r.perSensor[k];
+            inRangeOff += off.perSensor[k];
+        }
+        printf("on %4ddBm    %10.1f   %5.1f%%  %6u  %8u   %8.1f  %5.1f%%   %5.1f%% of off\n", db, r.edgesPerSecond, r.openPercent,
+            r.opens, r.prerolls, r.readings / hours, 100.0 * r.readings / sent, inRangeOff ? 100.0 * inRange / inRangeOff : 0.0);
+    }
+    return 0;
+}
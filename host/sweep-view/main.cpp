@@ -0,0 +1,174 @@
+// Turn the waterfall from ook-scope (SWEEP_MODE 1) into a picture and a per bin summary
+//
+// Usage: sweep-view [-o waterfall.pgm] [--floor-db D] [file]
+//   reads stdin if no file, e.g.  cat /dev/ttyACM0 | sweep-view -o wf.pgm
+//
+// The picture is a greyscale PGM, one row per sweep (time down), one column per bin (frequency across),
+// -120dBm black to -40dBm white. The summary shows, per bin, the mean and peak RSSI and how often it was
+// more than --floor-db above the overall median, which is where the transmitters are; plus the device's own
+// sweeps/s and per bin dwell from its stats lines, to compare bandwidth / settle settings.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+struct SweepHeader {
+    unsigned long start_hz = 0;
+    unsigned long step_hz = 0;
+    int bins = 0;
+    unsigned rxbw = 0;
+    unsigned settle_us = 0;
+};
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    const char* pgmPath = nullptr;
+    const char* inPath = nullptr;
+    double floor_db = 6;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "-o") && hasArg) pgmPath = argv[++i];
+        else if (!strcmp(argv[i], "--floor-db") && hasArg) floor_db = atof(argv[++i]);
+        else if (argv[i][0] != '-' && !inPath) inPath = argv[i];
+        else {
+            fprintf(stderr, "Usage: sweep-view [-o waterfall.pgm] [--floor-db D] [file]\n");
+            return 2;
+        }
+    }
+    FILE* in = inPath ? fopen(inPath, "r") : stdin;
+    if (!in) {
+        perror(inPath);
+        return 1;
+    }
+
+    SweepHeader h;
+    std::vector<uint8_t> rows;    // raw RSSI bytes, sweeps x bins
+    size_t sweeps = 0, badLines = 0;
+    unsigned long tFirst_ms = 0, tLast_ms = 0;
+    double statSweeps = 0, statBin_us = 0, statMaxBin_us = 0;
+    int statLines = 0;
+
+    char line[4096];
+    while (fgets(line, sizeof line, in)) {
+        if (!strncmp(line, "# sweep ", 8)) {
+            SweepHeader nh;
+            if (sscanf(line, "# sweep start_hz=%lu step_hz=%lu bins=%d rxbw=%x settle_us=%u",
+                    &nh.start_hz, &nh.step_hz, &nh.bins, &nh.rxbw, &nh.settle_us) == 5 && nh.bins > 0) {
+                if (h.bins && (nh.bins != h.bins || nh.start_hz != h.start_hz || nh.step_hz != h.step_hz)) {
+                    fprintf(stderr, "sweep-view: sweep settings changed part way, only using the first\n");
+                    break;
+                }
+                h = nh;
+            }
+            continue;
+        }
+        if (!strncmp(line, "# stats ", 8)) {
+            double s, b, m, o;
+            unsigned settle;
+            if (sscanf(line, "# stats sweeps/s=%lf bin_us=%lf settle_us=%u overhead_us=%lf max_bin_us=%lf",
+                    &s, &b, &settle, &o, &m) == 5) {
+                statSweeps += s;
+                statBin_us += b;
+                statMaxBin_us = std::max(statMaxBin_us, m);
+                statLines++;
+            }
+            continue;
+        }
+        if (line[0] != 'W' || !h.bins) continue;
+        unsigned long seq, t_ms;
+        int off = 0;
+        if (sscanf(line, "W %lu %lu %n", &seq, &t_ms, &off) != 2 || !off) {
+            badLines++;
+            continue;
+        }
+        const char* p = line + off;
+        size_t at = rows.size();
+        rows.resize(at + h.bins);
+        bool ok = true;
+        for (int k = 0; k < h.bins; k++) {
+            int hi = hexDigit(p[2 * k]), lo = hi < 0 ? -1 : hexDigit(p[2 * k + 1]);
+            if (hi < 0 || lo < 0) { ok = false; break; }
+            rows[at + k] = uint8_t(hi << 4 | lo);
+        }
+        if (!ok) {
+            // A sweep cut short, e.g. the port was opened part way through
+            rows.resize(at);
+            badLines++;
+            continue;
+        }
+        if (!sweeps) tFirst_ms = t_ms;
+        tLast_ms = t_ms;
+        sweeps++;
+    }
+    if (in != stdin) fclose(in);
+
+    if (!sweeps) {
+        fprintf(stderr, "sweep-view: no complete sweeps (is ook-scope built with SWEEP_MODE 1?)\n");
+        return 1;
+    }
+
+    // RSSI byte is -2 x dBm
+    std::vector<uint8_t> sorted(rows);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    double median_dbm = sorted[sorted.size() / 2] / -2.0;
+
+    printf("%zu sweeps of %d bins, %.3f to %.3f MHz in %.1f kHz steps, rxbw %02x, settle %u us",
+        sweeps, h.bins, h.start_hz / 1e6, (h.start_hz + (h.bins - 1) * h.step_hz) / 1e6, h.step_hz / 1e3, h.rxbw,
+        h.settle_us);
+    if (badLines) printf(", %zu partial lines skipped", badLines);
+    printf("\n");
+    if (sweeps > 1 && tLast_ms > tFirst_ms) {
+        printf("%.1f sweeps/s from timestamps", (sweeps - 1) * 1000.0 / (tLast_ms - tFirst_ms));
+        if (statLines) {
+            printf(", device reports %.1f sweeps/s, %.1f us per bin (max %.0f)", statSweeps / statLines,
+                statBin_us / statLines, statMaxBin_us);
+        }
+        printf("\n");
+    }
+    printf("median %.1f dBm; occupancy is the fraction of sweeps more than %.0f dB above that\n", median_dbm, floor_db);
+    printf("     MHz    mean    peak  occupancy\n");
+    for (int k = 0; k < h.bins; k++) {
+        double sum = 0;
+        uint8_t peak = 255;
+        size_t above = 0;
+        for (size_t s = 0; s < sweeps; s++) {
+            uint8_t v = rows[s * h.bins + k];
+            sum += v;
+            peak = std::min(peak, v);
+            if (v / -2.0 > median_dbm + floor_db) above++;
+        }
+        double occupancy = double(above) / sweeps;
+        printf("%9.4f %7.1f %7.1f %6.1f%%  ", (h.start_hz + k * h.step_hz) / 1e6, sum / sweeps / -2.0, peak / -2.0,
+            occupancy * 100);
+        for (int i = 0; i < int(occupancy * 40 + 0.5); i++) putchar('*');
+        putchar('\n');
+    }
+
+    if (pgmPath) {
+        FILE* out = fopen(pgmPath, "wb");
+        if (!out) {
+            perror(pgmPath);
+            return 1;
+        }
+        fprintf(out, "P5\n%d %zu\n255\n", h.bins, sweeps);
+        std::vector<uint8_t> pixels(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            double dbm = rows[i] / -2.0;
+            double v = (dbm + 120) / 80 * 255;
+            pixels[i] = uint8_t(std::min(255.0, std::max(0.0, v)));
+        }
+        fwrite(pixels.data(), 1, pixels.size(), out);
+        fclose(out);
+        printf("waterfall written to %s (%d x %zu)\n", pgmPath, h.bins, sweeps);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef HOST_TRACE_H_
+#define HOST_TRACE_H_
+
+// Pulse width traces, for running decoders over recorded or synthetic DIO2 timing
+//
+// Text, one width in microseconds per line; a line that isn't just a number (comments,
+// the spinner, anything else the firmware printed) is skipped. So the serial output of
+// ook-timing with DUMP_WIDTHS set can be saved and used as it is.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+inline bool readWidthTrace(const char* path, std::vector<uint32_t>& widths) {
+    FILE* f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+    if (!f) return false;
+    char line[256];
+    while (fgets(line, sizeof line, f)) {
+        char* end;
+        unsigned long w = strtoul(line, &end, 10);
+        if (end == line) continue;
+        while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n') end++;
+        if (*end) continue;
+        widths.push_back(uint32_t(w));
+    }
+    if (f != stdin) fclose(f);
+    return true;
+}
+
+inline bool writeWidthTrace(const char* path, const std::vector<uint32_t>& widths, const char* comment) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    if (comment) fprintf(f, "# %s\n", comment);
+    for (uint32_t w : widths) fprintf(f, "%u\n", w);
+    return fclose(f) == 0;
+}
+
+#endif
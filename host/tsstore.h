@@ -0,0 +1,199 @@
+// Columnar time series store for decoded Oregon readings
+//
+// Layout on disk:
+//   <root>/<receiver>/<type>-<channel>-<rollingcode>.ots   sealed column blocks
+//   <root>/<receiver>/<type>-<channel>-<rollingcode>.wal   raw rows not yet sealed
+//
+// An .ots file is just a sequence of blocks, each a fixed header followed by the columns
+// for up to BLOCK_ROWS readings of one sensor. Each column is stored contiguously:
+//   time     - unsigned varint delta from the previous row (first row relative to tFirst_ms)
+//   seq      - zigzag varint delta of the device counter (the leading %d on the serial line)
+//   temp     - zigzag varint delta, tenths of a degree
+//   humidity - zigzag varint delta, percent
+//   rssi     - zigzag varint delta, tenths of a dB
+//   battery  - one bit per row, packed LSB first
+// Because the sensors transmit slowly changing values on a fixed cadence almost every
+// column delta is a single byte, a reading costs ~6 bytes instead of ~45 bytes of text.
+//
+// The header carries the time range so a range query only has to walk headers
+// (skipping payloadBytes each time) and decode the blocks that overlap.
+//
+// Rows arrive one every ~39s per sensor, so they are first appended to the .wal as fixed
+// size records (so a crash of the ingest daemon loses nothing) and sealed into a block
+// once BLOCK_ROWS have accumulated.
+
+#ifndef HOST_TSSTORE_H_
+#define HOST_TSSTORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace tsstore {
+
+static const uint32_t BLOCK_MAGIC = 0x4253544f; // "OTSB"
+static const int BLOCK_ROWS = 256;
+
+struct SensorKey {
+    uint16_t type;
+    uint8_t channel;
+    uint8_t rollingCode;
+
+    bool operator==(const SensorKey& o) const {
+        return type == o.type && channel == o.channel && rollingCode == o.rollingCode;
+    }
+    uint32_t packed() const { return (uint32_t(type) << 16) | (uint32_t(channel) << 8) | rollingCode; }
+};
+
+struct Row {
+    int64_t t_ms;       // host receive time, ms since the unix epoch
+    int32_t seq;        // device counter
+    int16_t temp;       // tenths of a degree C
+    int16_t rssi;       // tenths of a dB
+    uint8_t humidity;
+    uint8_t battOK;
+    uint8_t pad[6];
+};
+static_assert(sizeof(Row) == 24, "Row is the .wal record format, keep it fixed");
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t payloadBytes;
+    uint16_t count;
+    uint16_t reserved;
+    uint32_t reserved2;
+    int64_t tFirst_ms;
+    int64_t tLast_ms;
+};
+static_assert(sizeof(BlockHeader) == 32, "BlockHeader is on-disk format");
+
+// Worst case payload is 10 bytes per varint column plus the battery bitmap
+static const size_t MAX_PAYLOAD = BLOCK_ROWS * 5 * 10 + BLOCK_ROWS / 8;
+
+inline uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = uint8_t(v) | 0x80;
+        v >>= 7;
+    }
+    *p++ = uint8_t(v);
+    return p;
+}
+
+// Returns nullptr if the varint runs past end (truncated or corrupt block)
+inline const uint8_t* getVarint(const uint8_t* p, const uint8_t* end, uint64_t& v) {
+    uint64_t r = 0;
+    int shift = 0;
+    while (p < end && shift < 64) {
+        uint8_t b = *p++;
+        r |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            v = r;
+            return p;
+        }
+        shift += 7;
+    }
+    return nullptr;
+}
+
+inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+// Encode rows[0..count) into out (at least MAX_PAYLOAD bytes); fills in hdr, returns payload size
+inline size_t encodeBlock(const Row* rows, int count, BlockHeader& hdr, uint8_t* out) {
+    if (count <= 0 || count > BLOCK_ROWS) return 0;
+    uint8_t* p = out;
+    int64_t prevT = rows[0].t_ms;
+    for (int i = 0; i < count; i++) {
+        // Rows are appended in arrival order so time never goes backwards within a sensor;
+        // clamp anyway in case the host clock steps back
+        int64_t d = rows[i].t_ms - prevT;
+        p = putVarint(p, d > 0 ? uint64_t(d) : 0);
+        if (d > 0) prevT = rows[i].t_ms;
+    }
+    int64_t prev = 0;
+    for (int i = 0; i < count; i++) { p = putVarint(p, zigzag(rows[i].seq - prev)); prev = rows[i].seq; }
+    prev = 0;
+    for (int i = 0; i < count; i++) { p = putVarint(p, zigzag(rows[i].temp - prev)); prev = rows[i].temp; }
+    prev = 0;
+    for (int i = 0; i < count; i++) { p = putVarint(p, zigzag(rows[i].humidity - prev)); prev = rows[i].humidity; }
+    prev = 0;
+    for (int i = 0; i < count; i++) { p = putVarint(p, zigzag(rows[i].rssi - prev)); prev = rows[i].rssi; }
+    size_t bitmapBytes = size_t(count + 7) / 8;
+    memset(p, 0, bitmapBytes);
+    for (int i = 0; i < count; i++) {
+        if (rows[i].battOK) p[i >> 3] |= 1 << (i & 7);
+    }
+    p += bitmapBytes;
+
+    hdr.magic = BLOCK_MAGIC;
+    hdr.payloadBytes = uint32_t(p - out);
+    hdr.count = uint16_t(count);
+    hdr.reserved = 0;
+    hdr.reserved2 = 0;
+    hdr.tFirst_ms = rows[0].t_ms;
+    hdr.tLast_ms = prevT;
+    return hdr.payloadBytes;
+}
+
+// Decode a block into rows (at least BLOCK_ROWS); returns false if the payload is corrupt
+inline bool decodeBlock(const BlockHeader& hdr, const uint8_t* payload, Row* rows) {
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + hdr.payloadBytes;
+    int count = hdr.count;
+    if (count > BLOCK_ROWS) return false;
+    uint64_t v;
+    int64_t t = hdr.tFirst_ms;
+    for (int i = 0; i < count; i++) {
+        if (!(p = getVarint(p, end, v))) return false;
+        t += int64_t(v);
+        rows[i].t_ms = t;
+    }
+    int64_t acc = 0;
+    for (int i = 0; i < count; i++) {
+        if (!(p = getVarint(p, end, v))) return false;
+        acc += unzigzag(v);
+        rows[i].seq = int32_t(acc);
+    }
+    acc = 0;
+    for (int i = 0; i < count; i++) {
+        if (!(p = getVarint(p, end, v))) return false;
+        acc += unzigzag(v);
+        rows[i].temp = int16_t(acc);
+    }
+    acc = 0;
+    for (int i = 0; i < count; i++) {
+        if (!(p = getVarint(p, end, v))) return false;
+        acc += unzigzag(v);
+        rows[i].humidity = uint8_t(acc);
+    }
+    acc = 0;
+    for (int i = 0; i < count; i++) {
+        if (!(p = getVarint(p, end, v))) return false;
+        acc += unzigzag(v);
+        rows[i].rssi = int16_t(acc);
+    }
+    if (end - p < (count + 7) / 8) return false;
+    for (int i = 0; i < count; i++) {
+        rows[i].battOK = (p[i >> 3] >> (i & 7)) & 1;
+    }
+    return true;
+}
+
+// File name for a sensor, without extension, e.g. "1d20-1-27"
+inline int sensorFileStem(const SensorKey& k, char* out, size_t n) {
+    return snprintf(out, n, "%04x-%u-%x", k.type, unsigned(k.channel), unsigned(k.rollingCode));
+}
+
+inline bool parseSensorFileStem(const char* s, SensorKey& k) {
+    unsigned type, channel, rc;
+    if (sscanf(s, "%x-%u-%x", &type, &channel, &rc) != 3) return false;
+    k.type = uint16_t(type);
+    k.channel = uint8_t(channel);
+    k.rollingCode = uint8_t(rc);
+    return true;
+}
+
+} // namespace tsstore
+
+#endif
@@ -0,0 +1,519 @@
+// Readings per sensor, false decodes and CPU time: this project's decoding against an rtl_433 style decoder
+//
+// Before the RTL-SDR and rtl_433 go, the Pico path should be shown to get at least as much out of
+// the same signal. Five decoders go over the same width traces:
+//   v2          OregonDecoderV2 alone
+//   pico        OregonDecoderV2 plus BurstRecorder and CollisionResolver, which is what oregon-decode does
+//   rtl_433     the way rtl_433 decodes Oregon v2.1: the OOK_PULSE_MANCHESTER_ZEROBIT slicer (short 440us,
+//               reset after a 2400us gap) into rows of bits, then the alternating preamble at the start of
+//               the row, the sync nibble within a few bits after it, and every other bit from there.
+//               This is a rewrite of the same steps, so it runs on the same widths; it is not rtl_433 itself,
+//               and it takes the sync in either polarity rather than at rtl_433's exact bit pattern.
+//   packet      apps/oregon-packet: the SX1231 in packet mode finds the sync word and hands over a block of
+//               chips, which chipdecoder.h decodes. The radio's part is PacketRadioModel below, and only
+//               the decoding is counted as CPU time, since that is all the Pico does.
+//   dclk        apps/oregon-dclk: continuous mode with the radio's bit synchroniser, every chip clocked
+//               into words by PIO, and OregonChipStream looking for the sync in them. Again only the
+//               decoding is CPU time; the words cost the CPU nothing until it looks at them.
+//
+// With --trace (any number of them, see host/trace.h) the widths are recorded ones. There is no truth
+// then, so a sensor's expected readings are the most any decoder accounts for (readings plus cycles
+// missed, by SensorStats from the learned period), and a reading is only called false if its sensor
+// turned up fewer than three times in that decoder's whole run.
+// Without --trace it makes its own: --sensors sensors with crystals off by up to --drift, jitter,
+// overlapping now and then, noise in between, and then a false reading is anything that was not sent.
+//
+// CPU time is each decoder's own pass over all the widths, on this machine. Interrupts are what the Pico
+// would take: one per width for the edge timing decoders, one per block in packet mode, and one per
+// 50ms poll of the word ring for dclk.
+//
+// Usage: yield-bench [--trace FILE ...] [--sensors S] [--hours H] [--drift F] [--jitter U] [--noise B] [--seed N]
+
+#include "../arduinohost.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "DecodeOOK.h"
+#include "OregonDecoderV2.h"
+#include "../../apps/chipdecoder.h"
+#include "../../apps/collision.h"
+#include "../../apps/sensorstats.h"
+#include "../oregonsynth.h"
+#include "../trace.h"
+
+#define REF_SHORT_US 440
+#define REF_RESET_US 2400
+#define REF_MAX_BITS 1024
+#define REF_MAX_BYTES 12
+
+// A frame with a good checksum, and when (from the start of the widths)
+struct Frame {
+    uint64_t t_us;
+    uint8_t data[REF_MAX_BYTES];
+    uint8_t len;
+};
+
+// The rtl_433 way: slice the whole transmission into bits first, then go looking for the message in them
+class ReferenceDecoder {
+    uint8_t bits[REF_MAX_BITS / 8];
+    int nbits = 0;
+    uint32_t sinceLast = 0;
+    uint32_t pulse = 0;
+    bool havePulse = false;
+
+    void addBit(int b) {
+        if (nbits >= REF_MAX_BITS) return;
+        // bitbuffer order, first bit in the top of the first byte
+        if (b) bits[nbits >> 3] |= uint8_t(0x80 >> (nbits & 7));
+        else bits[nbits >> 3] &= uint8_t(~(0x80 >> (nbits & 7)));
+        nbits++;
+    }
+    int bit(int i) const { return (bits[i >> 3] >> (7 - (i & 7))) & 1; }
+
+    void startRow() {
+        nbits = 0;
+        sinceLast = 0;
+        // The zero bit slicer starts every row with a 0
+        addBit(0);
+    }
+
+    // Every other bit from 'from', inverted or not, into bytes the way OregonDecoderV2 has them
+    // (first bit in the bottom, the sync nibble in the low nibble of data[0])
+    int extract(int from, bool invert, uint8_t* data) const {
+        memset(data, 0, REF_MAX_BYTES);
+        int n = 0;
+        for (int i = from; i < nbits && n < REF_MAX_BYTES * 8; i += 2, n++) {
+            if (bit(i) != invert) data[n >> 3] |= uint8_t(1 << (n & 7));
+        }
+        return n / 8;
+    }
+
+    // oregon_scientific_v2_1_decode: the row has to start with the preamble (skipping the first byte,
+    // which takes the startup bit errors), and the sync has to follow within a byte of where it ends
+    bool decodeRow(Frame& f) const {
+        if (nbits < 64) return false;
+        int end = 8;
+        while (end < nbits && bit(end) != bit(end - 1)) end++;
+        if (end < 32) return false;
+        for (int idx = -2; idx < 8; idx++) {
+            for (int invert = 0; invert < 2; invert++) {
+                int from = end + idx;
+                if (from < 0) continue;
+                uint8_t len = uint8_t(extract(from, invert, f.data));
+                if ((f.data[0] & 0x0f) != 0x0a) continue;
+                f.len = len;
+                if (checkedLength(f.data, f.len) && isSummOK(uint16_t(f.data[0] << 8 | f.data[1]), f.data, f.len)) return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    ReferenceDecoder() { startRow(); }
+
+    // Widths alternate carrier on (pulse) and off (gap); true with a frame at the end of a row
+    bool width(uint32_t w, bool high, Frame& f) {
+        if (high) {
+            pulse = w;
+            havePulse = true;
+            return false;
+        }
+        if (!havePulse) return false;
+        havePulse = false;
+        // pulse_slicer_manchester_zerobit: an edge more than 1.5 short since the last bit is a data edge,
+        // falling (end of the pulse) is a 1 and rising (end of the gap) a 0
+        if (pulse + sinceLast > REF_SHORT_US * 3 / 2) {
+            addBit(1);
+            sinceLast = 0;
+        } else {
+            sinceLast += pulse;
+        }
+        if (w > REF_RESET_US) {
+            bool got = decodeRow(f);
+            startRow();
+            return got;
+        }
+        if (w + sinceLast > REF_SHORT_US * 3 / 2) {
+            addBit(0);
+            sinceLast = 0;
+        } else {
+            sinceLast += w;
+        }
+        return false;
+    }
+};
+
+// The SX1231's bit synchroniser, near enough: it samples the middle of each chip, pulling its clock
+// into step at every edge. How many chips it clocks out for a width (at the nominal chip rate)
+static int bitSyncChips(uint32_t w) {
+    return w < SYNTH_CHIP_US / 2 ? 0 : int((w - SYNTH_CHIP_US / 2) / SYNTH_CHIP_US) + 1;
+}
+
+// The rest of packet mode: the last 32 chips are compared with the sync word, and after a match the
+// next block of chips goes into the FIFO. The RSSI threshold the sync search waits for, and the time
+// the receiver takes to restart after the FIFO is read, are left out.
+class PacketRadioModel {
+    uint32_t shift = 0;
+    int tolerance;
+    bool collecting = false;
+    int nchips = 0;
+    uint8_t fifo[OREGON_BLOCK_BYTES];
+
+    bool chip(int c) {
+        if (collecting) {
+            if (c) fifo[nchips >> 3] |= uint8_t(0x80 >> (nchips & 7));
+            if (++nchips < OREGON_BLOCK_BYTES * 8) return false;
+            collecting = false;
+            shift = 0;
+            return true;
+        }
+        shift = shift << 1 | c;
+        if (__builtin_popcount(shift ^ OREGON_SYNC_WORD) <= tolerance) {
+            collecting = true;
+            nchips = 0;
+            memset(fifo, 0, sizeof fifo);
+        }
+        return false;
+    }
+
+public:
+    explicit PacketRadioModel(int tol) : tolerance(tol) {}
+
+    const uint8_t* block() const { return fifo; }
+
+    // True with a block in the FIFO (PayloadReady) somewhere in this width
+    bool width(uint32_t w, bool high) {
+        int n = bitSyncChips(w);
+        bool ready = false;
+        for (int i = 0; i < n; i++) {
+            // A long gap only matters for as long as it takes to finish a block and fill the sync register
+            if (!collecting && i >= 33) break;
+            if (chip(high)) ready = true;
+        }
+        return ready;
+    }
+};
+
+enum { DEC_V2, DEC_PICO, DEC_REF, DEC_PACKET, DEC_DCLK, NUM_DECODERS };
+static const char* const decoderNames[NUM_DECODERS] = { "v2", "pico", "rtl_433", "packet", "dclk" };
+
+static void keep(std::vector<Frame>& out, uint64_t t, const uint8_t* data, uint8_t len) {
+    int n = checkedLength(data, len);
+    if (!n || !isSummOK(uint16_t(data[0] << 8 | data[1]), data, len)) return;
+    Frame f = { t, {}, uint8_t(n) };
+    memcpy(f.data, data, n);
+    out.push_back(f);
+}
+
+// Packet mode: the radio model is the SX1231's work, so it runs first and only the decoding is timed
+static double runPacket(const std::vector<uint32_t>& widths, bool firstHigh, std::vector<Frame>& out, uint64_t& irqs) {
+    PacketRadioModel radio(1);
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> blocks;
+    uint64_t t = 0;
+    for (size_t i = 0; i < widths.size(); i++) {
+        t += widths[i];
+        if (radio.width(widths[i], ((i & 1) == 0) == firstHigh)) {
+            blocks.push_back({ t, std::vector<uint8_t>(radio.block(), radio.block() + OREGON_BLOCK_BYTES) });
+        }
+    }
+    irqs += blocks.size();
+    OregonChipDecoder decoder;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& b : blocks) {
+        uint8_t len;
+        const uint8_t* data = decoder.decode(b.second.data(), OREGON_BLOCK_BYTES, len);
+        keep(out, b.first, data, len);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Continuous mode with the bit synchroniser: every chip, frame or not, in the words the PIO would make.
+// oregon-dclk wakes every 50ms to go through them, which is the interrupt count
+static double runDclk(const std::vector<uint32_t>& widths, bool firstHigh, std::vector<Frame>& out, uint64_t& irqs) {
+    std::vector<std::pair<uint64_t, uint32_t>> words;
+    uint32_t w = 0;
+    int nchips = 0;
+    uint64_t t = 0;
+    for (size_t i = 0; i < widths.size(); i++) {
+        t += widths[i];
+        int high = ((i & 1) == 0) == firstHigh;
+        for (int n = bitSyncChips(widths[i]); n > 0; n--) {
+            w = w << 1 | high;
+            if (++nchips == 32) {
+                words.push_back({ t, w });
+                nchips = 0;
+            }
+        }
+    }
+    irqs += t / 50000;
+    OregonChipStream stream(1);
+    auto start = std::chrono::steady_clock::now();
+    for (auto& word : words) {
+        uint8_t len;
+        const uint8_t* data = stream.word(word.second, len);
+        if (data) keep(out, word.first, data, len);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One decoder over all the widths; returns the CPU time in ms
+static double runDecoder(int which, const std::vector<uint32_t>& widths, bool firstHigh, std::vector<Frame>& out, uint64_t& irqs) {
+    if (which == DEC_PACKET) return runPacket(widths, firstHigh, out, irqs);
+    if (which == DEC_DCLK) return runDclk(widths, firstHigh, out, irqs);
+    static OregonDecoderV2 v2;
+    static BurstRecorder recorder;
+    static CollisionResolver* resolver;
+    static ReferenceDecoder* ref;
+    v2.resetDecoder();
+    delete resolver;
+    resolver = new CollisionResolver();
+    delete ref;
+    ref = new ReferenceDecoder();
+    irqs += widths.size();
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t t = 0;
+    for (size_t i = 0; i < widths.size(); i++) {
+        uint32_t w = widths[i];
+        t += w;
+        uint32_t now_ms = uint32_t(t / 1000);
+        if (which == DEC_REF) {
+            Frame f;
+            if (ref->width(w, ((i & 1) == 0) == firstHigh, f)) {
+                f.t_us = t;
+                out.push_back(f);
+            }
+            continue;
+        }
+        uint32_t pw = std::min<uint32_t>(w, 0xffff);
+        if (v2.nextPulse(pw)) {
+            uint8_t len;
+            const uint8_t* data = v2.getData(len);
+            if (data) {
+                size_t before = out.size();
+                keep(out, t, data, len);
+                if (which == DEC_PICO && out.size() > before) {
+                    resolver->decoded(data, len, now_ms);
+                    recorder.frameDecoded();
+                }
+            }
+            v2.resetDecoder();
+        }
+        if (which == DEC_PICO && recorder.width(pw, now_ms)) {
+            RecoveredFrame found[2];
+            int n = resolver->resolve(recorder.burst(), now_ms, found, 2);
+            for (int k = 0; k < n; k++) keep(out, t, found[k].data, found[k].len);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint32_t sensorKey(const uint8_t* data) {
+    return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+}
+
+struct SensorRow {
+    uint64_t expected = 0;
+    uint64_t got[NUM_DECODERS] = {};
+};
+
+int main(int argc, char** argv) {
+    std::vector<const char*> traces;
+    int numSensors = 16;
+    double hours = 2, drift = 0.04, jitter = 20, noise = 20;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++) {
+        bool hasArg = i + 1 < argc;
+        if (!strcmp(argv[i], "--trace") && hasArg) traces.push_back(argv[++i]);
+        else if (!strcmp(argv[i], "--sensors") && hasArg) numSensors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hours") && hasArg) hours = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--drift") && hasArg) drift = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--jitter") && hasArg) jitter = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--noise") && hasArg) noise = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasArg) seed = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: yield-bench [--trace FILE ...] [--sensors S] [--hours H] [--drift F] [--jitter U] [--noise B] [--seed N]\n");
+            return 2;
+        }
+    }
+
+    // Each capture is decoded separately, and the counts added up
+    std::vector<std::vector<uint32_t>> captures;
+    // Synthetic: what was sent, per sensor key, and when each cycle started
+    std::map<uint32_t, std::vector<std::pair<uint64_t, SynthReading>>> sent;
+    bool synthetic = traces.empty();
+    if (synthetic) {
+        std::mt19937_64 rng(seed);
+        uint64_t duration_us = uint64_t(hours * 3600e6);
+        std::vector<OnInterval> on, quiet;
+        for (int s = 0; s < numSensors; s++) {
+            bool thn132 = s % 4 == 3;
+            uint8_t channel = uint8_t(1 + s % 3);
+            SynthReading r = { uint16_t(thn132 ? 0xec40 : 0x1d20), channel, uint8_t(0x11 + s * 7), int16_t(50 + rng() % 250),
+                               uint8_t(30 + rng() % 50), true };
+            uint8_t data[12];
+            encodeOregonBytes(r, data);
+            uint32_t key = sensorKey(data);
+            double d = 1.0 + drift * (int(rng() % 2001) - 1000) / 1000.0;
+            uint64_t period_us = uint64_t((39000000 + (channel - 1) * 2000000) * d);
+            for (uint64_t start = rng() % period_us; start + 500000 < duration_us; start += period_us) {
+                r.temp = int16_t(r.temp + int(rng() % 3) - 1);
+                if (r.temp < 10) r.temp = 10;
+                uint64_t end = appendPair(r, start, d, jitter, rng, on);
+                quiet.push_back({ start, end + 3000 });
+                sent[key].push_back({ start, r });
+            }
+        }
+        std::sort(quiet.begin(), quiet.end(), [](const OnInterval& a, const OnInterval& b) { return a.start_us < b.start_us; });
+        appendNoise(0, duration_us, noise, rng, on, &quiet);
+        std::vector<uint64_t> edges;
+        intervalsToEdges(on, edges);
+        // From t=0, so the times line up with what was sent; the first width is a gap then
+        std::vector<uint32_t> widths = { uint32_t(edges[0]) };
+        for (size_t i = 0; i + 1 < edges.size(); i++) widths.push_back(uint32_t(std::min<uint64_t>(edges[i + 1] - edges[i], 10000000)));
+        widths.push_back(100000);
+        captures.push_back(widths);
+    } else {
+        for (const char* path : traces) {
+            std::vector<uint32_t> widths;
+            if (!readWidthTrace(path, widths)) {
+                fprintf(stderr, "yield-bench: can't read %s\n", path);
+                return 1;
+            }
+            widths.push_back(100000);
+            captures.push_back(widths);
+        }
+    }
+
+    std::map<uint32_t, SensorRow> rows;
+    uint64_t falseReadings[NUM_DECODERS] = {};
+    double cpu_ms[NUM_DECODERS] = {};
+    uint64_t irqs[NUM_DECODERS] = {};
+    uint64_t totalWidths = 0;
+    for (auto& widths : captures) {
+        totalWidths += widths.size();
+        // Which widths are carrier: the long ones are nearly all gaps (noise is short, frames are under 2ms)
+        bool firstHigh = true;
+        if (!synthetic) {
+            uint64_t longEven = 0, longOdd = 0;
+            for (size_t i = 0; i < widths.size(); i++) {
+                if (widths[i] > REF_RESET_US) ((i & 1) ? longOdd : longEven)++;
+            }
+            firstHigh = longOdd >= longEven;
+        } else {
+            firstHigh = false;
+        }
+        uint64_t end_us = 0;
+        for (uint32_t w : widths) end_us += w;
+        std::map<uint32_t, uint64_t> accounted[NUM_DECODERS];
+        for (int d = 0; d < NUM_DECODERS; d++) {
+            std::vector<Frame> frames;
+            cpu_ms[d] += runDecoder(d, widths, firstHigh, frames, irqs[d]);
+            // Readings: one per sensor per cycle, the pair is one
+            std::set<std::pair<uint32_t, uint64_t>> got;
+            std::map<uint32_t, uint64_t> seen;
+            SensorStats stats;
+            for (auto& f : frames) {
+                seen[sensorKey(f.data)]++;
+                stats.frame(f.data, f.len, true, 0xff, uint32_t(f.t_us / 1000));
+            }
+            for (auto& f : frames) {
+                uint32_t key = sensorKey(f.data);
+                if (synthetic) {
+                    auto it = sent.find(key);
+                    bool ok = false;
+                    SynthReading r;
+                    if (it != sent.end() && decodeTempHumidity(f.data, f.len, r.type, r.channel, r.rollingCode, r.temp, r.hum, r.battOK)) {
+                        for (size_t k = 0; k < it->second.size(); k++) {
+                            auto& c = it->second[k];
+                            if (c.first <= f.t_us && f.t_us < c.first + 1000000 && c.second.temp == r.temp) {
+                                got.insert({ key, k });
+                                ok = true;
+                                break;
+                            }
+                        }
+                    }
+                    if (!ok) falseReadings[d]++;
+                } else if (seen[key] < 3) {
+                    falseReadings[d]++;
+                } else {
+                    // Cycle number, near enough: the pair is well inside a second
+                    got.insert({ key, f.t_us / 1000000 });
+                }
+            }
+            // Close copies of the pair within a second can land either side of a second boundary
+            std::map<uint32_t, uint64_t> lastSecond;
+            for (auto& g : got) {
+                auto it = lastSecond.find(g.first);
+                if (!synthetic && it != lastSecond.end() && g.second - it->second <= 1) continue;
+                lastSecond[g.first] = g.second;
+                rows[g.first].got[d]++;
+            }
+            if (!synthetic) {
+                stats.forEach([&](const SensorStats::Sensor& s) {
+                    uint32_t key = s.key;
+                    if (seen[key] >= 3) accounted[d][key] = s.received + SensorStats::missedNow(s, uint32_t(end_us / 1000));
+                });
+            }
+        }
+        if (!synthetic) {
+            for (auto& row : rows) {
+                uint64_t most = 0;
+                for (int d = 0; d < NUM_DECODERS; d++) {
+                    auto it = accounted[d].find(row.first);
+                    if (it != accounted[d].end()) most = std::max(most, it->second);
+                    most = std::max(most, row.second.got[d]);
+                }
+                row.second.expected += most;
+            }
+        }
+    }
+    if (synthetic) {
+        for (auto& s : sent) rows[s.first].expected = s.second.size();
+    }
+
+    if (synthetic) {
+        printf("%d synthetic sensors, %.1f h, crystals within %.0f%%, jitter %.0fus, noise %.0f bursts/s\n", numSensors, hours,
+            drift * 100, jitter, noise);
+    } else {
+        printf("%zu traces, %llu widths\n", traces.size(), (unsigned long long)totalWidths);
+    }
+    printf("\nsensor          expected");
+    for (int d = 0; d < NUM_DECODERS; d++) printf("  %14s", decoderNames[d]);
+    printf("\n");
+    uint64_t expectedTotal = 0, gotTotal[NUM_DECODERS] = {};
+    for (auto& row : rows) {
+        if (!row.second.expected) continue;
+        SensorStats::Sensor s = {};
+        s.key = row.first;
+        uint16_t type;
+        uint8_t channel, rollingCode;
+        SensorStats::identity(s, type, channel, rollingCode);
+        printf("%04x,%d,%02x  %10llu", type, channel, rollingCode, (unsigned long long)row.second.expected);
+        expectedTotal += row.second.expected;
+        for (int k = 0; k < NUM_DECODERS; k++) {
+            gotTotal[k] += row.second.got[k];
+            printf("  %6llu %5.1f%%", (unsigned long long)row.second.got[k], 100.0 * row.second.got[k] / row.second.expected);
+        }
+        printf("\n");
+    }
+    printf("total        %10llu", (unsigned long long)expectedTotal);
+    for (int k = 0; k < NUM_DECODERS; k++) {
+        printf("  %6llu %5.1f%%", (unsigned long long)gotTotal[k], expectedTotal ? 100.0 * gotTotal[k] / expectedTotal : 0.0);
+    }
+    printf("\nfalse                  ");
+    for (int k = 0; k < NUM_DECODERS; k++) printf("  %14llu", (unsigned long long)falseReadings[k]);
+    printf("\ncpu ms                 ");
+    for (int k = 0; k < NUM_DECODERS; k++) printf("  %14.1f", cpu_ms[k]);
+    printf("\nns per width           ");
+    for (int k = 0; k < NUM_DECODERS; k++) printf("  %14.1f", totalWidths ? cpu_ms[k] * 1e6 / totalWidths : 0.0);
+    printf("\ninterrupts             ");
+    for (int k = 0; k < NUM_DECODERS; k++) printf("  %14llu", (unsigned long long)irqs[k]);
+    printf("\n");
+    return 0;
+}